@@ -0,0 +1,87 @@
+"""
+Benchmark of ``numba.typed.ConcurrentDict.merge()`` inside a ``prange`` loop.
+
+Each iteration counts a key into a shared histogram, so the loop is dominated
+by the hashing, the locking of a shard and the update of its dictionary.  The
+throughput is reported for 1 to N threads, for the default number of shards
+and for a single shard, i.e. one lock for the whole dictionary.  Ideally the
+former scales linearly while the latter does not scale at all.
+
+Usage::
+
+    python contrib/concurrent_dict_bench.py [--max-threads N] [--n N]
+                                            [--nkeys N]
+
+Set NUMBA_NUM_THREADS to measure up to 64 threads on a machine with fewer
+cores.  Fewer keys (``--nkeys``) make the threads meet on the same keys, and
+so on the same shards, more often.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import numba
+from numba import njit, prange, types
+from numba.typed import ConcurrentDict
+
+
+@njit
+def add(a, b):
+    return a + b
+
+
+@njit(parallel=True)
+def histogram(cd, keys):
+    for i in prange(keys.size):
+        cd.merge(keys[i], 1, add)
+
+
+def measure(nthreads, nshards, keys, repeat):
+    numba.set_num_threads(nthreads)
+    best = float('inf')
+    for _ in range(repeat):
+        cd = ConcurrentDict.empty(types.int64, types.int64, nshards)
+        start = time.perf_counter()
+        histogram(cd, keys)
+        best = min(best, time.perf_counter() - start)
+    return keys.size / best
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--max-threads', type=int,
+                        default=numba.config.NUMBA_NUM_THREADS)
+    parser.add_argument('--n', type=int, default=4000000)
+    parser.add_argument('--nkeys', type=int, default=100000)
+    parser.add_argument('--repeat', type=int, default=5)
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(0)
+    keys = rng.integers(0, args.nkeys, size=args.n).astype(np.int64)
+
+    # Compile and start the threading layer
+    histogram(ConcurrentDict.empty(types.int64, types.int64), keys[:10])
+    nshards = ConcurrentDict.empty(types.int64, types.int64).nshards()
+    print("threading layer: %s, n=%d, nkeys=%d"
+          % (numba.threading_layer(), args.n, args.nkeys))
+    print("%8s %16s %8s %16s %8s" % ("threads",
+                                     "merges/s (%d)" % nshards, "speedup",
+                                     "merges/s (1)", "speedup"))
+    nthreads = 1
+    base = None
+    while True:
+        rate = measure(nthreads, 0, keys, args.repeat)
+        rate1 = measure(nthreads, 1, keys, args.repeat)
+        if base is None:
+            base = rate, rate1
+        print("%8d %16.0f %8.2f %16.0f %8.2f"
+              % (nthreads, rate, rate / base[0], rate1, rate1 / base[1]))
+        if nthreads >= args.max_threads:
+            break
+        nthreads = min(nthreads * 2, args.max_threads)
+
+
+if __name__ == '__main__':
+    main()
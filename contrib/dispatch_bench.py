@@ -0,0 +1,63 @@
+"""
+Microbenchmark of the overhead of calling a jitted function from Python.
+
+The functions do no work, so each call is dominated by the dispatch: typing
+the arguments, selecting the overload and calling the compiled wrapper.  The
+rate is reported for 0, 1, 4 and 16 arguments, passed positionally and, for
+comparison, by keyword, which does not take the vectorcall fast path.
+
+Usage::
+
+    python contrib/dispatch_bench.py [--calls N] [--repeat N]
+"""
+
+import argparse
+import time
+
+from numba import njit
+
+
+def make_function(nargs):
+    names = ['a%d' % i for i in range(nargs)]
+    src = "def f(%s):\n    return None\n" % ', '.join(names)
+    ns = {}
+    exec(src, ns)
+    return njit(ns['f']), names
+
+
+def best_of(fn, repeat):
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def measure(fn, args, kwargs, calls, repeat):
+    def loop():
+        for _ in range(calls):
+            fn(*args, **kwargs)
+    return calls / best_of(loop, repeat)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--calls', type=int, default=1000000)
+    parser.add_argument('--repeat', type=int, default=5)
+    args = parser.parse_args()
+
+    print("%6s %16s %16s" % ("nargs", "positional/s", "keyword/s"))
+    for nargs in (0, 1, 4, 16):
+        fn, names = make_function(nargs)
+        values = tuple(range(nargs))
+        # Compile
+        fn(*values)
+        positional = measure(fn, values, {}, args.calls, args.repeat)
+        keyword = measure(fn, (), dict(zip(names, values)), args.calls,
+                          args.repeat)
+        print("%6d %16.0f %16.0f" % (nargs, positional, keyword))
+
+
+if __name__ == '__main__':
+    main()
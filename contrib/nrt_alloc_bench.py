@@ -0,0 +1,73 @@
+"""
+Microbenchmark of NRT allocation throughput inside a ``prange`` loop.
+
+Each iteration allocates and frees a small temporary array, so the loop is
+dominated by NRT_MemInfo_alloc / NRT_MemInfo_release and their statistics
+counters.  The throughput is reported for 1 to N threads; ideally it scales
+linearly.
+
+Usage::
+
+    python contrib/nrt_alloc_bench.py [--max-threads N] [--iters N]
+
+Set NUMBA_NRT_SLAB_ALLOCATOR to compare with the slab allocator.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import numba
+from numba import njit, prange
+from numba.core.runtime import rtsys
+
+
+@njit(parallel=True)
+def alloc_loop(n):
+    acc = np.zeros(n)
+    for i in prange(n):
+        tmp = np.empty(i % 8 + 1)
+        tmp[0] = i
+        acc[i] = tmp[0]
+    return acc.sum()
+
+
+def measure(nthreads, iters, repeat):
+    numba.set_num_threads(nthreads)
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        alloc_loop(iters)
+        best = min(best, time.perf_counter() - start)
+    return iters / best
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--max-threads', type=int,
+                        default=numba.config.NUMBA_NUM_THREADS)
+    parser.add_argument('--iters', type=int, default=2000000)
+    parser.add_argument('--repeat', type=int, default=5)
+    args = parser.parse_args()
+
+    # Compile and start the threading layer
+    alloc_loop(10)
+    print("threading layer: %s, NRT statistics: %s"
+          % (numba.threading_layer(),
+             "on" if rtsys.stats_enabled else "off"))
+    print("%8s %16s %8s" % ("threads", "allocs/s", "speedup"))
+    nthreads = 1
+    base = None
+    while True:
+        rate = measure(nthreads, args.iters, args.repeat)
+        if base is None:
+            base = rate
+        print("%8d %16.0f %8.2f" % (nthreads, rate, rate / base))
+        if nthreads >= args.max_threads:
+            break
+        nthreads = min(nthreads * 2, args.max_threads)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,92 @@
+"""
+Benchmark of the per-element overhead of a parallel ``guvectorize`` kernel.
+
+The kernel does a single multiply per outer iteration, so the time is
+dominated by how the threading layer calls it: once per element, or once per
+contiguous range of elements.  Each available threading layer is timed in its
+own process and the cost per element is reported, together with the serial
+``cpu`` target as a baseline.
+
+Usage::
+
+    python contrib/parallel_gufunc_bench.py [--layers tbb,omp,workqueue]
+                                            [--threads N] [--n N]
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+import numba
+from numba import guvectorize
+
+
+def scale(x, out):
+    out[0] = 2. * x[0]
+
+
+scale_parallel = guvectorize(['void(float64[:], float64[:])'], '(m)->(m)',
+                             target='parallel')(scale)
+scale_cpu = guvectorize(['void(float64[:], float64[:])'], '(m)->(m)',
+                        target='cpu')(scale)
+
+
+def best_of(fn, repeat):
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def run_layer(n, repeat):
+    x = np.ones((n, 1))
+    out = np.empty_like(x)
+    # Compile and start the threading layer
+    scale_parallel(x[:10], out[:10])
+    results = {'layer': numba.threading_layer()}
+    results['parallel'] = best_of(lambda: scale_parallel(x, out), repeat) / n
+    results['cpu'] = best_of(lambda: scale_cpu(x, out), repeat) / n
+    print(json.dumps(results))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--layers', default='tbb,omp,workqueue')
+    parser.add_argument('--threads', type=int,
+                        default=numba.config.NUMBA_NUM_THREADS)
+    parser.add_argument('--n', type=int, default=10000000)
+    parser.add_argument('--repeat', type=int, default=5)
+    parser.add_argument('--child', action='store_true', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.child:
+        run_layer(args.n, args.repeat)
+        return
+
+    print("%d threads, n=%d" % (args.threads, args.n))
+    print("%-10s %16s %16s" % ("layer", "parallel (ns)", "cpu (ns)"))
+    for layer in args.layers.split(','):
+        env = os.environ.copy()
+        env['NUMBA_THREADING_LAYER'] = layer
+        env['NUMBA_NUM_THREADS'] = str(args.threads)
+        cmd = [sys.executable, __file__, '--child', '--n', str(args.n),
+               '--repeat', str(args.repeat)]
+        proc = subprocess.run(cmd, env=env, stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE)
+        if proc.returncode != 0:
+            print("%-10s %16s" % (layer, "unavailable"))
+            continue
+        res = json.loads(proc.stdout.decode().strip().splitlines()[-1])
+        print("%-10s %16.3f %16.3f" % (res['layer'], res['parallel'] * 1e9,
+                                       res['cpu'] * 1e9))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,64 @@
+"""
+Microbenchmark of the launch overhead of a parallel region.
+
+Each call runs a ``prange`` loop with a single trivial iteration per thread, so
+the time per call is dominated by waking the workers and waiting for them to
+finish.  The overhead is reported for 1 to N threads (at most 64).
+
+Usage::
+
+    python contrib/parallel_launch_bench.py [--max-threads N] [--calls N]
+
+Set NUMBA_THREADING_LAYER to compare the threading layers.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import numba
+from numba import njit, prange
+
+
+@njit(parallel=True)
+def empty_region(out):
+    for i in prange(out.shape[0]):
+        out[i] = i
+
+
+def measure(nthreads, calls, repeat):
+    numba.set_num_threads(nthreads)
+    out = np.empty(nthreads)
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        for _ in range(calls):
+            empty_region(out)
+        best = min(best, time.perf_counter() - start)
+    return best / calls
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--max-threads', type=int,
+                        default=min(64, numba.config.NUMBA_NUM_THREADS))
+    parser.add_argument('--calls', type=int, default=10000)
+    parser.add_argument('--repeat', type=int, default=5)
+    args = parser.parse_args()
+
+    # Compile and start the threading layer
+    empty_region(np.empty(1))
+    print("threading layer: %s" % numba.threading_layer())
+    print("%8s %16s" % ("threads", "us per region"))
+    nthreads = 1
+    while True:
+        overhead = measure(nthreads, args.calls, args.repeat)
+        print("%8d %16.2f" % (nthreads, overhead * 1e6))
+        if nthreads >= args.max_threads:
+            break
+        nthreads = min(nthreads * 2, args.max_threads)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,110 @@
+"""
+Benchmark of the threading layers on a ``prange`` loop with skewed
+per-iteration cost.
+
+The cost of an iteration grows quadratically with its index, so a static
+schedule leaves most threads idle while the last one finishes its chunk.  Each
+available threading layer is timed in its own process, both with the default
+schedule and with a small parallel chunk size, together with a
+``guvectorize`` kernel whose outer loop has the same skew.
+
+Usage::
+
+    python contrib/parallel_skew_bench.py [--layers tbb,omp,workqueue]
+                                          [--threads N] [--n N]
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+import numba
+from numba import guvectorize, njit, prange
+
+
+@njit(parallel=True)
+def skewed_loop(n):
+    out = np.empty(n)
+    for i in prange(n):
+        acc = 0.
+        for j in range(i * i // n):
+            acc += np.sqrt(j)
+        out[i] = acc
+    return out
+
+
+@guvectorize(['void(int64[:], float64[:])'], '(m)->()', target='parallel')
+def skewed_gufunc(row, out):
+    acc = 0.
+    n = row[1]
+    for j in range(row[0] * row[0] // n):
+        acc += np.sqrt(j)
+    out[0] = acc
+
+
+def best_of(fn, repeat):
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def run_layer(n, chunksize, repeat):
+    rows = np.stack([np.arange(n), np.full(n, n)], axis=1)
+    # Compile and start the threading layer
+    skewed_loop(10)
+    skewed_gufunc(rows[:10])
+    results = {'layer': numba.threading_layer()}
+    results['prange'] = best_of(lambda: skewed_loop(n), repeat)
+    with numba.parallel_chunksize(chunksize):
+        results['prange_chunked'] = best_of(lambda: skewed_loop(n), repeat)
+    results['gufunc'] = best_of(lambda: skewed_gufunc(rows), repeat)
+    print(json.dumps(results))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--layers', default='tbb,omp,workqueue')
+    parser.add_argument('--threads', type=int,
+                        default=numba.config.NUMBA_NUM_THREADS)
+    parser.add_argument('--n', type=int, default=20000)
+    parser.add_argument('--chunksize', type=int, default=16)
+    parser.add_argument('--repeat', type=int, default=5)
+    parser.add_argument('--child', action='store_true', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.child:
+        run_layer(args.n, args.chunksize, args.repeat)
+        return
+
+    print("%d threads, n=%d, chunksize=%d"
+          % (args.threads, args.n, args.chunksize))
+    print("%-10s %12s %16s %12s" % ("layer", "prange (s)", "chunked (s)",
+                                     "gufunc (s)"))
+    for layer in args.layers.split(','):
+        env = os.environ.copy()
+        env['NUMBA_THREADING_LAYER'] = layer
+        env['NUMBA_NUM_THREADS'] = str(args.threads)
+        cmd = [sys.executable, __file__, '--child', '--n', str(args.n),
+               '--chunksize', str(args.chunksize),
+               '--repeat', str(args.repeat)]
+        proc = subprocess.run(cmd, env=env, stdout=subprocess.PIPE,
+                              stderr=subprocess.PIPE)
+        if proc.returncode != 0:
+            print("%-10s %12s" % (layer, "unavailable"))
+            continue
+        res = json.loads(proc.stdout.decode().strip().splitlines()[-1])
+        print("%-10s %12.4f %16.4f %12.4f" % (res['layer'], res['prange'],
+                                             res['prange_chunked'],
+                                             res['gufunc']))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,109 @@
+"""
+Benchmark of insertion and lookup in a ``numba.typed.Dict`` with int64 keys.
+
+The keys are plain data, so by default they are compared inline and are not
+reference counted.  For comparison, the dict is also built without the
+POD_KEYS flag, in which case every key comparison goes through the generic
+comparison of the C dict.  The batch ``insert_many()`` and ``lookup_many()``
+methods are timed as well, for both hashtable layouts.
+
+Usage::
+
+    python contrib/typed_dict_bench.py [--n N] [--repeat N]
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+from numba import njit, types
+from numba.typed import dictobject
+
+
+int64 = types.int64
+
+
+@njit
+def new_dict(flags):
+    dp = dictobject._dict_new_minsize(int64, int64, flags)
+    dictobject._dict_set_method_table(dp, int64, int64)
+    return dictobject._make_dict(int64, int64, dp)
+
+
+@njit
+def fill(d, keys):
+    for i in range(keys.size):
+        d[keys[i]] = i
+
+
+@njit
+def lookup(d, keys):
+    hits = 0
+    for i in range(keys.size):
+        if keys[i] in d:
+            hits += 1
+    return hits
+
+
+@njit
+def fill_many(d, keys):
+    d.insert_many(keys, np.arange(keys.size))
+
+
+@njit
+def lookup_many(d, keys):
+    return d.lookup_many(keys)[1].sum()
+
+
+def best_of(fn, repeat):
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def measure(flags, keys, probes, repeat, batch=False):
+    fill_fn, lookup_fn = (fill_many, lookup_many) if batch else (fill, lookup)
+    insert = best_of(lambda: fill_fn(new_dict(flags), keys), repeat)
+    d = new_dict(flags)
+    fill_fn(d, keys)
+    search = best_of(lambda: lookup_fn(d, probes), repeat)
+    return insert / keys.size, search / probes.size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--n', type=int, default=1000000)
+    parser.add_argument('--repeat', type=int, default=5)
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(0)
+    keys = rng.permutation(args.n).astype(np.int64) * 2654435761
+    # half of the probes are hits
+    probes = rng.permutation(2 * args.n).astype(np.int64) * 2654435761
+
+    # Compile
+    fill(new_dict(0), keys[:10])
+    lookup(new_dict(0), probes[:10])
+    fill_many(new_dict(0), keys[:10])
+    lookup_many(new_dict(0), probes[:10])
+
+    flags = dictobject.DictFlags
+    print("n=%d" % args.n)
+    print("%-10s %-6s %14s %14s" % ("layout", "keys", "insert (ns)",
+                                    "lookup (ns)"))
+    for layout, layout_flags in (('compact', 0), ('grouped', flags.GROUPED)):
+        for kind, key_flags, batch in (('memcmp', 0, False),
+                                       ('pod', flags.POD_KEYS, False),
+                                       ('batch', flags.POD_KEYS, True)):
+            insert, search = measure(layout_flags | key_flags, keys, probes,
+                                     args.repeat, batch)
+            print("%-10s %-6s %14.1f %14.1f" % (layout, kind, insert * 1e9,
+                                                search * 1e9))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,86 @@
+"""
+Microbenchmark of the typing of array arguments when calling a jitted
+function from Python.
+
+A jitted function of one argument that does no work is called with arrays of
+several dtypes and shapes, so each call is dominated by the dispatch and by
+the typing of the argument.  Basic numeric dtypes of up to 5 dimensions hit
+the direct typecode table, while the others go through the typecode cache of
+_typeof.c.  The cost of a call is reported per kind of array, next to the
+one of a float64 vector for reference.
+
+Usage::
+
+    python contrib/typeof_bench.py [--calls N] [--repeat N]
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+from numba import njit
+from numba.core.errors import NumbaError
+
+
+@njit
+def take(a):
+    return None
+
+
+def arrays():
+    readonly = np.zeros(4)
+    readonly.flags.writeable = False
+    unaligned = np.zeros(33, dtype=np.uint8)[1:].view(np.float64)
+    record = np.dtype([('x', np.int32), ('y', np.float64)])
+    return [
+        ("float64 1d", np.zeros(4)),
+        ("bool 1d", np.zeros(4, dtype=np.bool_)),
+        ("float16 1d", np.zeros(4, dtype=np.float16)),
+        ("datetime64 1d", np.zeros(4, dtype='M8[ns]')),
+        ("record 1d", np.zeros(4, dtype=record)),
+        ("float64 6d", np.zeros((1,) * 6)),
+        ("float64 readonly", readonly),
+        ("float64 unaligned", unaligned),
+    ]
+
+
+def best_of(fn, repeat):
+    best = float('inf')
+    for _ in range(repeat):
+        start = time.perf_counter()
+        fn()
+        best = min(best, time.perf_counter() - start)
+    return best
+
+
+def measure(arr, calls, repeat):
+    def loop():
+        for _ in range(calls):
+            take(arr)
+    return best_of(loop, repeat) / calls
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--calls', type=int, default=1000000)
+    parser.add_argument('--repeat', type=int, default=5)
+    args = parser.parse_args()
+
+    print("%-20s %12s %8s" % ("argument", "call (ns)", "ratio"))
+    base = None
+    for name, arr in arrays():
+        try:
+            # Compile
+            take(arr)
+        except NumbaError:
+            print("%-20s %12s" % (name, "unsupported"))
+            continue
+        cost = measure(arr, args.calls, args.repeat)
+        if base is None:
+            base = cost
+        print("%-20s %12.1f %8.2f" % (name, cost * 1e9, cost / base))
+
+
+if __name__ == '__main__':
+    main()
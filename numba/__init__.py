@@ -42,7 +42,8 @@ from numba.core.decorators import (cfunc, generated_jit, jit, njit, stencil,
 from numba.np.ufunc import (vectorize, guvectorize, threading_layer,
                             get_num_threads, set_num_threads,
                             set_parallel_chunksize, get_parallel_chunksize,
-                            get_thread_id)
+                            set_parallel_schedule, get_parallel_schedule,
+                            submit_parallel, get_thread_id)
 
 # Re-export Numpy helpers
 from numba.np.numpy_support import carray, farray, from_dtype
@@ -55,6 +56,9 @@ import numba.core.withcontexts
 from numba.core.withcontexts import objmode_context as objmode
 from numba.core.withcontexts import parallel_chunksize
 
+# NRT arena allocation scope
+from numba.core.runtime import nrt_arena
+
 # Initialize target extensions
 import numba.core.target_extension
 
@@ -90,6 +94,10 @@ __all__ = """
     set_parallel_chunksize
     get_parallel_chunksize
     parallel_chunksize
+    set_parallel_schedule
+    get_parallel_schedule
+    submit_parallel
+    nrt_arena
     """.split() + types.__all__ + errors.__all__
 
 
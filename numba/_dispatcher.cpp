@@ -10,6 +10,26 @@
 #include "core/typeconv/typeconv.hpp"
 #include "_devicearray.h"
 
+/*
+ * The vectorcall protocol (PEP 590) is available from Python 3.8, the type
+ * flag lost its leading underscore in Python 3.9.
+ */
+#if PY_VERSION_HEX >= 0x03080000
+#define NUMBA_HAVE_VECTORCALL 1
+#if PY_VERSION_HEX >= 0x03090000
+#define NUMBA_TPFLAGS_HAVE_VECTORCALL Py_TPFLAGS_HAVE_VECTORCALL
+#else
+#define NUMBA_TPFLAGS_HAVE_VECTORCALL _Py_TPFLAGS_HAVE_VECTORCALL
+#endif
+#else
+#define NUMBA_HAVE_VECTORCALL 0
+#endif
+
+/* The signature of compiled wrappers, which are METH_FASTCALL | METH_KEYWORDS
+   functions (see numba/core/callwrapper.py) */
+typedef PyObject *(*fastcall_cfunc)(PyObject *, PyObject *const *,
+                                    Py_ssize_t, PyObject *);
+
 /*
  * Notes on the C_TRACE macro:
  *
@@ -279,6 +299,21 @@ else                                                            \
 typedef std::vector<Type> TypeTable;
 typedef std::vector<PyObject*> Functions;
 
+/* Number of entries in the overload resolution cache of a dispatcher */
+#define RESOLVE_CACHE_SIZE 4
+/* Maximum number of arguments for which resolutions are cached */
+#define RESOLVE_CACHE_MAX_ARGS 8
+
+/* An entry of the overload resolution cache: the argument typecodes and
+   selection flags of a call, mapped to the overload they resolved to. */
+struct ResolveCacheEntry {
+    Type sig[RESOLVE_CACHE_MAX_ARGS];
+    bool allow_unsafe;
+    bool exact_match_required;
+    /* Borrowed reference, NULL for an unused entry */
+    PyObject *callable;
+};
+
 /* The Dispatcher class is the base class of all dispatchers in the CPU and
    CUDA targets. Its main responsibilities are:
 
@@ -320,6 +355,20 @@ public:
     /* A flattened array of argument types to all overloads
      * (invariant: sizeof(overloads) == argct * sizeof(functions)) */
     TypeTable overloads;
+    /* A small cache of recent resolve() results, so that call sites always
+       passing the same argument types don't need to rate every overload */
+    ResolveCacheEntry resolve_cache[RESOLVE_CACHE_SIZE];
+    /* The cache entry to be replaced next (round-robin) */
+    int resolve_cache_next;
+    /* The TypeManager version the cached resolutions were made with */
+    unsigned int resolve_cache_version;
+    /* Statistics */
+    Py_ssize_t resolve_cache_hits;
+    Py_ssize_t resolve_cache_misses;
+#if NUMBA_HAVE_VECTORCALL
+    /* Vectorcall entry point, see Dispatcher_vectorcall() */
+    vectorcallfunc vectorcall;
+#endif
 
     /* Add a new overload. Parameters:
 
@@ -331,6 +380,48 @@ public:
             overloads.push_back(args[i]);
         }
         functions.push_back(callable);
+        /* The new overload may be a better match for cached signatures */
+        clearResolveCache();
+    }
+
+    /* Forget all cached overload resolutions */
+    void clearResolveCache() {
+        for (int i = 0; i < RESOLVE_CACHE_SIZE; ++i) {
+            resolve_cache[i].callable = NULL;
+        }
+        resolve_cache_next = 0;
+    }
+
+    /* Return the cached resolution of the given signature, or NULL. */
+    PyObject* lookupResolveCache(const Type sig[], bool allow_unsafe,
+                                 bool exact_match_required) {
+        if (resolve_cache_version != tm->getVersion()) {
+            /* New conversions may change the outcome of a resolution */
+            clearResolveCache();
+            resolve_cache_version = tm->getVersion();
+            return NULL;
+        }
+        for (int i = 0; i < RESOLVE_CACHE_SIZE; ++i) {
+            const ResolveCacheEntry &entry = resolve_cache[i];
+            if (entry.callable != NULL &&
+                entry.allow_unsafe == allow_unsafe &&
+                entry.exact_match_required == exact_match_required &&
+                memcmp(entry.sig, sig, argct * sizeof(Type)) == 0) {
+                return entry.callable;
+            }
+        }
+        return NULL;
+    }
+
+    /* Cache the resolution of the given signature to callable */
+    void storeResolveCache(const Type sig[], bool allow_unsafe,
+                           bool exact_match_required, PyObject *callable) {
+        ResolveCacheEntry &entry = resolve_cache[resolve_cache_next];
+        memcpy(entry.sig, sig, argct * sizeof(Type));
+        entry.allow_unsafe = allow_unsafe;
+        entry.exact_match_required = exact_match_required;
+        entry.callable = callable;
+        resolve_cache_next = (resolve_cache_next + 1) % RESOLVE_CACHE_SIZE;
     }
 
     /* Given a list of types, find the overloads that have a matching signature.
@@ -347,8 +438,9 @@ public:
                                overloads that would require a type conversion
                                can also be matched. */
     PyObject* resolve(Type sig[], int &matches, bool allow_unsafe,
-                      bool exact_match_required) const {
+                      bool exact_match_required) {
         const int ovct = functions.size();
+        const bool cacheable = argct <= RESOLVE_CACHE_MAX_ARGS;
         int selected;
         matches = 0;
         if (0 == ovct) {
@@ -361,9 +453,23 @@ public:
             selected = 0;
         }
         else {
+            if (cacheable) {
+                PyObject *cached = lookupResolveCache(sig, allow_unsafe,
+                                                      exact_match_required);
+                if (cached != NULL) {
+                    resolve_cache_hits++;
+                    matches = 1;
+                    return cached;
+                }
+                resolve_cache_misses++;
+            }
             matches = tm->selectOverload(sig, &overloads[0], selected, argct,
                                          ovct, allow_unsafe,
                                          exact_match_required);
+            if (matches == 1 && cacheable) {
+                storeResolveCache(sig, allow_unsafe, exact_match_required,
+                                  functions[selected]);
+            }
         }
         if (matches == 1) {
             return functions[selected];
@@ -375,6 +481,7 @@ public:
     void clear() {
         functions.clear();
         overloads.clear();
+        clearResolveCache();
     }
 
 };
@@ -397,6 +504,15 @@ Dispatcher_dealloc(Dispatcher *self)
 }
 
 
+static PyObject*
+Dispatcher_call(Dispatcher *self, PyObject *args, PyObject *kws);
+
+#if NUMBA_HAVE_VECTORCALL
+static PyObject*
+Dispatcher_vectorcall(PyObject *callable, PyObject *const *args,
+                      size_t nargsf, PyObject *kwnames);
+#endif
+
 static int
 Dispatcher_init(Dispatcher *self, PyObject *args, PyObject *kwds)
 {
@@ -427,6 +543,19 @@ Dispatcher_init(Dispatcher *self, PyObject *args, PyObject *kwds)
     self->fallbackdef = NULL;
     self->has_stararg = has_stararg;
     self->exact_match_required = exact_match_required;
+    self->clearResolveCache();
+    self->resolve_cache_version = self->tm->getVersion();
+#if NUMBA_HAVE_VECTORCALL
+    self->vectorcall = Dispatcher_vectorcall;
+    /* Heap types (i.e. the Python subclasses of Dispatcher) don't inherit
+       the vectorcall flag before Python 3.12, even though they inherit
+       tp_vectorcall_offset.  Opt them in unless they override __call__. */
+    PyTypeObject *tp = Py_TYPE(self);
+    if (tp->tp_call == (ternaryfunc) Dispatcher_call &&
+        !(tp->tp_flags & NUMBA_TPFLAGS_HAVE_VECTORCALL)) {
+        tp->tp_flags |= NUMBA_TPFLAGS_HAVE_VECTORCALL;
+    }
+#endif
     return 0;
 }
 
@@ -550,16 +679,19 @@ int search_new_conversions(PyObject *dispatcher, PyObject *args, PyObject *kws)
 }
 
 
-/* A custom, fast, inlinable version of PyCFunction_Call() */
+/* A custom, fast, inlinable version of PyCFunction_Call().  The positional
+   arguments are passed as a borrowed C array, as in the vectorcall protocol,
+   and keyword arguments must already have been folded into them. */
 static PyObject *
-call_cfunc(Dispatcher *self, PyObject *cfunc, PyObject *args, PyObject *kws, PyObject *locals)
+call_cfunc(Dispatcher *self, PyObject *cfunc, PyObject *const *args,
+           Py_ssize_t nargs, PyObject *locals)
 {
-    PyCFunctionWithKeywords fn;
+    fastcall_cfunc fn;
     PyThreadState *tstate;
 
     assert(PyCFunction_Check(cfunc));
-    assert(PyCFunction_GET_FLAGS(cfunc) == (METH_VARARGS | METH_KEYWORDS));
-    fn = (PyCFunctionWithKeywords) PyCFunction_GET_FUNCTION(cfunc);
+    assert(PyCFunction_GET_FLAGS(cfunc) == (METH_FASTCALL | METH_KEYWORDS));
+    fn = (fastcall_cfunc) PyCFunction_GET_FUNCTION(cfunc);
     tstate = PyThreadState_GET();
 
 #if (PY_MAJOR_VERSION >= 3) && (PY_MINOR_VERSION >= 10)
@@ -622,7 +754,7 @@ call_cfunc(Dispatcher *self, PyObject *cfunc, PyObject *args, PyObject *kws, PyO
         /* Populate the 'fast locals' in `frame` */
         PyFrame_LocalsToFast(frame, 0);
         tstate->frame = frame;
-        C_TRACE(result, fn(PyCFunction_GET_SELF(cfunc), args, kws));
+        C_TRACE(result, fn(PyCFunction_GET_SELF(cfunc), args, nargs, NULL));
         /* write changes back to locals? */
         PyFrame_FastToLocals(frame);
         tstate->frame = frame->f_back;
@@ -635,7 +767,7 @@ call_cfunc(Dispatcher *self, PyObject *cfunc, PyObject *args, PyObject *kws, PyO
     }
     else
     {
-        return fn(PyCFunction_GET_SELF(cfunc), args, kws);
+        return fn(PyCFunction_GET_SELF(cfunc), args, nargs, NULL);
     }
 }
 
@@ -659,7 +791,8 @@ compile_and_invoke(Dispatcher *self, PyObject *args, PyObject *kws, PyObject *lo
         return NULL;
 
     if (PyObject_TypeCheck(cfunc, &PyCFunction_Type)) {
-        retval = call_cfunc(self, cfunc, args, kws, locals);
+        retval = call_cfunc(self, cfunc, PySequence_Fast_ITEMS(args),
+                            PyTuple_GET_SIZE(args), locals);
     } else {
         /* Re-enter interpreter */
         retval = PyObject_Call(cfunc, args, kws);
@@ -927,14 +1060,16 @@ Dispatcher_call(Dispatcher *self, PyObject *args, PyObject *kws)
     }
     if (matches == 1) {
         /* Definition is found */
-        retval = call_cfunc(self, cfunc, args, kws, locals);
+        retval = call_cfunc(self, cfunc, PySequence_Fast_ITEMS(args), argct,
+                            locals);
     } else if (matches == 0) {
         /* No matching definition */
         if (self->can_compile) {
             retval = compile_and_invoke(self, args, kws, locals);
         } else if (self->fallbackdef) {
             /* Have object fallback */
-            retval = call_cfunc(self, self->fallbackdef, args, kws, locals);
+            retval = call_cfunc(self, self->fallbackdef,
+                                PySequence_Fast_ITEMS(args), argct, locals);
         } else {
             /* Raise TypeError */
             explain_matching_error((PyObject *) self, args, kws);
@@ -957,6 +1092,93 @@ CLEANUP:
     return retval;
 }
 
+#if NUMBA_HAVE_VECTORCALL
+/* Call the dispatcher's tp_call with an argument tuple and keyword
+   dictionary rebuilt from vectorcall arguments. */
+static PyObject*
+vectorcall_via_tp_call(PyObject *callable, PyObject *const *args,
+                       Py_ssize_t nargs, PyObject *kwnames)
+{
+    PyObject *argtuple, *kws = NULL, *retval;
+    Py_ssize_t i, nkws = (kwnames != NULL) ? PyTuple_GET_SIZE(kwnames) : 0;
+
+    argtuple = PyTuple_New(nargs);
+    if (argtuple == NULL)
+        return NULL;
+    for (i = 0; i < nargs; i++) {
+        Py_INCREF(args[i]);
+        PyTuple_SET_ITEM(argtuple, i, args[i]);
+    }
+    if (nkws) {
+        kws = PyDict_New();
+        if (kws == NULL) {
+            Py_DECREF(argtuple);
+            return NULL;
+        }
+        for (i = 0; i < nkws; i++) {
+            if (PyDict_SetItem(kws, PyTuple_GET_ITEM(kwnames, i),
+                               args[nargs + i])) {
+                Py_DECREF(kws);
+                Py_DECREF(argtuple);
+                return NULL;
+            }
+        }
+    }
+    retval = Py_TYPE(callable)->tp_call(callable, argtuple, kws);
+    Py_XDECREF(kws);
+    Py_DECREF(argtuple);
+    return retval;
+}
+
+/* The vectorcall (PEP 590) entry point of the dispatcher.
+
+   The common case of a call with exactly one positional argument per
+   parameter, which resolves to a single compiled overload, is dispatched
+   straight from the caller's argument array and doesn't allocate.  Anything
+   else (named arguments, defaults, *args, tracing, compilation, errors...)
+   goes through Dispatcher_call(). */
+static PyObject*
+Dispatcher_vectorcall(PyObject *callable, PyObject *const *args,
+                      size_t nargsf, PyObject *kwnames)
+{
+    Dispatcher *self = (Dispatcher *) callable;
+    Py_ssize_t nargs = PyVectorcall_NARGS(nargsf);
+    int tys[24];
+    int matches;
+    int i;
+    PyObject *cfunc;
+
+    if (Py_TYPE(callable)->tp_call != (ternaryfunc) Dispatcher_call
+        || use_tls_target_stack
+        || (kwnames != NULL && PyTuple_GET_SIZE(kwnames) != 0)
+        || nargs != self->argct
+        || nargs >= (Py_ssize_t) (sizeof(tys) / sizeof(int))
+        || (self->fold_args && self->has_stararg)
+        || PyThreadState_Get()->c_profilefunc != NULL) {
+        return vectorcall_via_tp_call(callable, args, nargs, kwnames);
+    }
+
+    for (i = 0; i < nargs; ++i) {
+        tys[i] = typeof_typecode(callable, args[i]);
+        if (tys[i] == -1) {
+            /* Let the generic path handle (or report) the failure */
+            PyErr_Clear();
+            return vectorcall_via_tp_call(callable, args, nargs, kwnames);
+        }
+    }
+
+    /* If compilation is enabled, ensure that an exact match is found and if
+     * not compile one */
+    int exact_match_required = self->can_compile ? 1 : self->exact_match_required;
+    cfunc = self->resolve(tys, matches, !self->can_compile,
+                          exact_match_required);
+    if (matches != 1) {
+        return vectorcall_via_tp_call(callable, args, nargs, kwnames);
+    }
+    return call_cfunc(self, cfunc, args, nargs, NULL);
+}
+#endif
+
 /* Based on Dispatcher_call above, with the following differences:
    1. It does not invoke the definition of the function.
    2. It returns the definition, instead of a value returned by the function.
@@ -1051,7 +1273,8 @@ Dispatcher_cuda_call(Dispatcher *self, PyObject *args, PyObject *kws)
             retval = cuda_compile_only(self, args, kws, locals);
         } else if (self->fallbackdef) {
             /* Have object fallback */
-            retval = call_cfunc(self, self->fallbackdef, args, kws, locals);
+            retval = call_cfunc(self, self->fallbackdef,
+                                PySequence_Fast_ITEMS(args), argct, locals);
         } else {
             /* Raise TypeError */
             explain_matching_error((PyObject *) self, args, kws);
@@ -1102,6 +1325,10 @@ static PyMethodDef Dispatcher_methods[] = {
 
 static PyMemberDef Dispatcher_members[] = {
     {(char*)"_can_compile", T_BOOL, offsetof(Dispatcher, can_compile), 0, NULL },
+    {(char*)"_resolve_cache_hits", T_PYSSIZET,
+     offsetof(Dispatcher, resolve_cache_hits), READONLY, NULL },
+    {(char*)"_resolve_cache_misses", T_PYSSIZET,
+     offsetof(Dispatcher, resolve_cache_misses), READONLY, NULL },
     {NULL}  /* Sentinel */
 };
 
@@ -1112,7 +1339,11 @@ static PyTypeObject DispatcherType = {
     sizeof(Dispatcher),                          /* tp_basicsize */
     0,                                           /* tp_itemsize */
     (destructor)Dispatcher_dealloc,              /* tp_dealloc */
+#if NUMBA_HAVE_VECTORCALL
+    offsetof(Dispatcher, vectorcall),            /* tp_vectorcall_offset */
+#else
     0,                                           /* tp_print */
+#endif
     0,                                           /* tp_getattr */
     0,                                           /* tp_setattr */
     0,                                           /* tp_compare */
@@ -1126,7 +1357,11 @@ static PyTypeObject DispatcherType = {
     0,                                           /* tp_getattro*/
     0,                                           /* tp_setattro*/
     0,                                           /* tp_as_buffer*/
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC, /* tp_flags*/
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC
+#if NUMBA_HAVE_VECTORCALL
+        | NUMBA_TPFLAGS_HAVE_VECTORCALL
+#endif
+    ,                                            /* tp_flags*/
     "Dispatcher object",                         /* tp_doc */
     (traverseproc) Dispatcher_traverse,          /* tp_traverse */
     0,                                           /* tp_clear */
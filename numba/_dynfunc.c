@@ -293,7 +293,9 @@ closure_new(PyObject *name, PyObject *doc, PyCFunction fnaddr,
         return NULL;
     }
     clo->def.ml_meth = fnaddr;
-    clo->def.ml_flags = METH_VARARGS | METH_KEYWORDS;
+    /* Compiled wrappers use the vectorcall convention
+       (see numba/core/callwrapper.py) */
+    clo->def.ml_flags = METH_FASTCALL | METH_KEYWORDS;
     clo->def.ml_doc = dup_string(doc);
     if (!clo->def.ml_doc) {
         Py_DECREF(clo);
@@ -132,18 +132,27 @@ build_c_helpers_dict(void)
     /* for dictionary support */
     declmethod(test_dict);
     declmethod(dict_new_minsize);
+    declmethod(dict_new_flags);
+    declmethod(dict_flags);
     declmethod(dict_set_method_table);
     declmethod(dict_free);
     declmethod(dict_length);
     declmethod(dict_lookup);
     declmethod(dict_insert);
     declmethod(dict_insert_ez);
+    declmethod(dict_insert_many);
+    declmethod(dict_lookup_many);
     declmethod(dict_delitem);
     declmethod(dict_popitem);
     declmethod(dict_iter_sizeof);
     declmethod(dict_iter);
     declmethod(dict_iter_next);
     declmethod(dict_dump);
+    declmethod(concurrent_dict_new);
+    declmethod(concurrent_dict_free);
+    declmethod(concurrent_dict_nshards);
+    declmethod(concurrent_dict_shard_at);
+    declmethod(concurrent_dict_shard);
 
     /* for list support */
     declmethod(test_list);
@@ -37,7 +37,6 @@ static int tc_intp;
 static PyObject *omittedarg_type;
 
 static PyObject *typecache;
-static PyObject *ndarray_typecache;
 static PyObject *structured_dtypes;
 
 static PyObject *str_typeof_pyval = NULL;
@@ -51,11 +50,29 @@ void **DeviceArray_API;
  * Type fingerprint computation.
  */
 
+/* What a string writer does with the bytes written to it.  In all modes,
+   a running hash of the bytes is maintained. */
+enum writer_mode {
+    /* Append the bytes to the buffer */
+    WRITER_BUFFER,
+    /* Only hash the bytes, nothing is stored */
+    WRITER_HASH,
+    /* Compare the bytes with the existing (read-only) buffer contents */
+    WRITER_COMPARE
+};
+
 typedef struct {
-    /* A buffer the fingerprint will be written to */
+    int mode;
+    /* A buffer the fingerprint will be written to (or compared with) */
     char *buf;
     size_t n;
     size_t allocated;
+    /* The running hash of the first n bytes */
+    Py_uhash_t hash;
+    /* WRITER_COMPARE: whether the bytes differ from the buffer */
+    int mismatch;
+    /* WRITER_HASH: the value the fingerprint is computed for (borrowed) */
+    PyObject *val;
     /* A preallocated buffer, sufficient to fit the fingerprint for most types */
     char static_buf[40];
 } string_writer_t;
@@ -63,23 +80,51 @@ typedef struct {
 static void
 string_writer_init(string_writer_t *w)
 {
+    w->mode = WRITER_BUFFER;
     w->buf = w->static_buf;
     w->n = 0;
     w->allocated = sizeof(w->static_buf) / sizeof(unsigned char);
+    w->hash = 0;
+    w->mismatch = 0;
+    w->val = NULL;
+}
+
+/* Initialize a writer that only hashes the fingerprint of *val*. */
+static void
+string_writer_init_hash(string_writer_t *w, PyObject *val)
+{
+    string_writer_init(w);
+    w->mode = WRITER_HASH;
+    w->val = val;
+}
+
+/* Initialize a writer that compares a fingerprint with the one held
+   by *ref*. */
+static void
+string_writer_init_compare(string_writer_t *w, const string_writer_t *ref)
+{
+    string_writer_init(w);
+    w->mode = WRITER_COMPARE;
+    w->buf = ref->buf;
+    w->allocated = ref->n;
 }
 
 static void
 string_writer_clear(string_writer_t *w)
 {
-    if (w->buf != w->static_buf)
+    if (w->mode == WRITER_BUFFER && w->buf != w->static_buf)
         free(w->buf);
 }
 
 static void
 string_writer_move(string_writer_t *dest, const string_writer_t *src)
 {
+    dest->mode = src->mode;
     dest->n = src->n;
     dest->allocated = src->allocated;
+    dest->hash = src->hash;
+    dest->mismatch = src->mismatch;
+    dest->val = NULL;
     if (src->buf == src->static_buf) {
         dest->buf = dest->static_buf;
         memcpy(dest->buf, src->buf, src->n);
@@ -115,44 +160,71 @@ string_writer_ensure(string_writer_t *w, size_t bytes)
 }
 
 static int
-string_writer_put_char(string_writer_t *w, unsigned char c)
+string_writer_put_bytes(string_writer_t *w, const char *s, size_t len)
 {
-    if (string_writer_ensure(w, 1))
-        return -1;
-    w->buf[w->n++] = c;
+    size_t i;
+    Py_uhash_t x = w->hash;
+
+    /* The old FNV algorithm used by Python 2, computed incrementally */
+    for (i = 0; i < len; i++) {
+        unsigned char c = (unsigned char) s[i];
+        if (w->n + i == 0)
+            x = (Py_uhash_t) c << 7;
+        x = (1000003 * x) ^ c;
+    }
+    w->hash = x;
+
+    switch (w->mode) {
+    case WRITER_BUFFER:
+        if (string_writer_ensure(w, len))
+            return -1;
+        memcpy(w->buf + w->n, s, len);
+        break;
+    case WRITER_COMPARE:
+        if (!w->mismatch &&
+            (w->n + len > w->allocated || memcmp(w->buf + w->n, s, len)))
+            w->mismatch = 1;
+        break;
+    default:
+        break;
+    }
+    w->n += len;
     return 0;
 }
 
+static int
+string_writer_put_char(string_writer_t *w, unsigned char c)
+{
+    char b = (char) c;
+    return string_writer_put_bytes(w, &b, 1);
+}
+
 static int
 string_writer_put_int32(string_writer_t *w, unsigned int v)
 {
-    if (string_writer_ensure(w, 4))
-        return -1;
-    w->buf[w->n] = v & 0xff;
-    w->buf[w->n + 1] = (v >> 8) & 0xff;
-    w->buf[w->n + 2] = (v >> 16) & 0xff;
-    w->buf[w->n + 3] = (v >> 24) & 0xff;
-    w->n += 4;
-    return 0;
+    char b[4];
+    b[0] = v & 0xff;
+    b[1] = (v >> 8) & 0xff;
+    b[2] = (v >> 16) & 0xff;
+    b[3] = (v >> 24) & 0xff;
+    return string_writer_put_bytes(w, b, 4);
 }
 
 static int
 string_writer_put_intp(string_writer_t *w, npy_intp v)
 {
-    if (string_writer_ensure(w, NPY_SIZEOF_PY_INTPTR_T))
-        return -1;
-    w->buf[w->n] = v & 0xff;
-    w->buf[w->n + 1] = (v >> 8) & 0xff;
-    w->buf[w->n + 2] = (v >> 16) & 0xff;
-    w->buf[w->n + 3] = (v >> 24) & 0xff;
+    char b[NPY_SIZEOF_PY_INTPTR_T];
+    b[0] = v & 0xff;
+    b[1] = (v >> 8) & 0xff;
+    b[2] = (v >> 16) & 0xff;
+    b[3] = (v >> 24) & 0xff;
 #if NPY_SIZEOF_PY_INTPTR_T == 8
-    w->buf[w->n + 4] = (v >> 32) & 0xff;
-    w->buf[w->n + 5] = (v >> 40) & 0xff;
-    w->buf[w->n + 6] = (v >> 48) & 0xff;
-    w->buf[w->n + 7] = (v >> 56) & 0xff;
+    b[4] = (v >> 32) & 0xff;
+    b[5] = (v >> 40) & 0xff;
+    b[6] = (v >> 48) & 0xff;
+    b[7] = (v >> 56) & 0xff;
 #endif
-    w->n += NPY_SIZEOF_PY_INTPTR_T;
-    return 0;
+    return string_writer_put_bytes(w, b, NPY_SIZEOF_PY_INTPTR_T);
 }
 
 static int
@@ -162,12 +234,7 @@ string_writer_put_string(string_writer_t *w, const char *s)
         return string_writer_put_char(w, 0);
     }
     else {
-        size_t N = strlen(s) + 1;
-        if (string_writer_ensure(w, N))
-            return -1;
-        memcpy(w->buf + w->n, s, N);
-        w->n += N;
-        return 0;
+        return string_writer_put_bytes(w, s, strlen(s) + 1);
     }
 }
 
@@ -560,7 +627,9 @@ int typecode_fallback_keep_ref(PyObject *dispatcher, PyObject *val) {
 }
 
 
-/* A cache mapping fingerprints (string_writer_t *) to typecodes (int). */
+/* A cache mapping fingerprints (string_writer_t *) to typecodes (int).
+ * Keys stored in the table hold the fingerprint bytes; lookups are done
+ * with WRITER_HASH keys, which only hold the fingerprint's hash. */
 static _Numba_hashtable_t *fingerprint_hashtable = NULL;
 
 static Py_uhash_t
@@ -569,14 +638,8 @@ hash_writer(const void *key)
     string_writer_t *writer = (string_writer_t *) key;
     Py_uhash_t x = 0;
 
-    /* The old FNV algorithm used by Python 2 */
     if (writer->n > 0) {
-        unsigned char *p = (unsigned char *) writer->buf;
-        Py_ssize_t len = writer->n;
-        x ^= *p << 7;
-        while (--len >= 0)
-            x = (1000003*x) ^ *p++;
-        x ^= writer->n;
+        x = writer->hash ^ writer->n;
         if (x == (Py_uhash_t) -1)
             x = -2;
     }
@@ -590,9 +653,53 @@ compare_writer(const void *key, const _Numba_hashtable_entry_t *entry)
     string_writer_t *w = (string_writer_t *) entry->key;
     if (v->n != w->n)
         return 0;
+    if (v->mode == WRITER_HASH) {
+        /* The hashes match: check the fingerprint against the stored one
+           by computing it again, without storing it. */
+        string_writer_t cmp;
+        string_writer_init_compare(&cmp, w);
+        if (compute_fingerprint(&cmp, v->val)) {
+            PyErr_Clear();
+            return 0;
+        }
+        return !cmp.mismatch && cmp.n == w->n;
+    }
     return memcmp(v->buf, w->buf, v->n) == 0;
 }
 
+/*
+ * Types whose instances can't be fingerprinted but provide their Numba type
+ * through "_numba_type_" (e.g. typed.List and typed.Dict, whose Numba type
+ * depends on the instance).  Fingerprinting is skipped for them.
+ * The table owns references to the types, so that their addresses can't be
+ * reused.
+ */
+#define N_NUMBA_TYPE_TYPES 16
+static PyTypeObject *numba_type_types[N_NUMBA_TYPE_TYPES];
+static int n_numba_type_types = 0;
+
+static int
+is_numba_type_type(PyTypeObject *tyobj)
+{
+    int i;
+    for (i = 0; i < n_numba_type_types; i++) {
+        if (numba_type_types[i] == tyobj)
+            return 1;
+    }
+    return 0;
+}
+
+static void
+maybe_add_numba_type_type(PyTypeObject *tyobj)
+{
+    if (n_numba_type_types == N_NUMBA_TYPE_TYPES)
+        return;
+    if (!PyObject_HasAttr((PyObject *) tyobj, str_numba_type))
+        return;
+    Py_INCREF(tyobj);
+    numba_type_types[n_numba_type_types++] = tyobj;
+}
+
 /* Try to compute *val*'s typecode using its fingerprint and the
  * fingerprint->typecode cache.
  */
@@ -602,26 +709,37 @@ typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
     int typecode;
     string_writer_t w;
 
-    string_writer_init(&w);
+    if (is_numba_type_type(Py_TYPE(val)))
+        return typecode_fallback(dispatcher, val);
+
+    /* First only hash the fingerprint, which doesn't allocate */
+    string_writer_init_hash(&w, val);
 
     if (compute_fingerprint(&w, val)) {
-        string_writer_clear(&w);
         if (PyErr_ExceptionMatches(PyExc_NotImplementedError)) {
             /* Can't compute a type fingerprint for the given value,
                fall back on typeof() without caching. */
             PyErr_Clear();
+            maybe_add_numba_type_type(Py_TYPE(val));
             return typecode_fallback(dispatcher, val);
         }
         return -1;
     }
     if (_Numba_HASHTABLE_GET(fingerprint_hashtable, &w, typecode) > 0) {
         /* Cache hit */
-        string_writer_clear(&w);
         return typecode;
     }
 
-    /* Not found in cache: invoke pure Python typeof() and cache result.
-     * Note we have to keep the type alive forever as explained
+    /* Not found in cache: compute the actual fingerprint to be used as
+     * a key, invoke pure Python typeof() and cache result.
+     */
+    string_writer_init(&w);
+    if (compute_fingerprint(&w, val)) {
+        string_writer_clear(&w);
+        return -1;
+    }
+
+    /* Note we have to keep the type alive forever as explained
      * above in _typecode_fallback().
      */
     typecode = typecode_fallback_keep_ref(dispatcher, val);
@@ -642,6 +760,9 @@ typecode_using_fingerprint(PyObject *dispatcher, PyObject *val)
             return -1;
         }
     }
+    else {
+        string_writer_clear(&w);
+    }
     return typecode;
 }
 
@@ -719,35 +840,76 @@ void cache_typecode(PyArray_Descr* descr, int typecode) {
     Py_DECREF(value);
 }
 
+/*
+ * A cache of typecodes for the arrays that aren't handled by
+ * cached_arycode: other dtypes, higher dimensions, read-only or unaligned
+ * arrays.  It is a set-associative table keyed by the array's
+ * (ndim, layout, dtype, readonly, aligned), so that a lookup only does
+ * pointer comparisons and never allocates.  Each entry owns a reference to
+ * its dtype, ensuring the dtype's address can't be reused by another dtype
+ * while the entry is alive.
+ */
+
+#define N_NDARRAY_CACHE_SETS 256    /* Must be a power of two */
+#define N_NDARRAY_CACHE_WAYS 4
+
+typedef struct {
+    /* Owned reference, NULL for an unused entry */
+    PyArray_Descr *descr;
+    int ndim;
+    char layout;
+    char readonly;
+    char aligned;
+    int typecode;
+} ndarray_cache_entry_t;
+
+static ndarray_cache_entry_t
+ndarray_typecode_cache[N_NDARRAY_CACHE_SETS][N_NDARRAY_CACHE_WAYS];
+
 static
-PyObject* ndarray_key(int ndim, int layout, PyArray_Descr* descr) {
-    PyObject* tmpndim = PyLong_FromLong(ndim);
-    PyObject* tmplayout = PyLong_FromLong(layout);
-    PyObject* key = PyTuple_Pack(3, tmpndim, tmplayout, descr);
-    Py_DECREF(tmpndim);
-    Py_DECREF(tmplayout);
-    return key;
+ndarray_cache_entry_t *ndarray_cache_set(int ndim, int layout,
+                                         PyArray_Descr *descr,
+                                         int readonly, int aligned) {
+    size_t h = (size_t) descr >> 4;
+    h ^= (size_t) ndim * 0x9E3779B1u;
+    h ^= (size_t) ((layout << 2) | (readonly << 1) | aligned) << 7;
+    h ^= h >> 11;
+    return ndarray_typecode_cache[h & (N_NDARRAY_CACHE_SETS - 1)];
 }
 
 static
-int get_cached_ndarray_typecode(int ndim, int layout, PyArray_Descr* descr) {
-    PyObject* key = ndarray_key(ndim, layout, descr);
-    PyObject *tmpobject = PyDict_GetItem(ndarray_typecache, key);
-    if (tmpobject == NULL)
-        return -1;
-
-    Py_DECREF(key);
-    return PyLong_AsLong(tmpobject);
+int get_cached_ndarray_typecode(int ndim, int layout, PyArray_Descr *descr,
+                                int readonly, int aligned) {
+    ndarray_cache_entry_t *set = ndarray_cache_set(ndim, layout, descr,
+                                                   readonly, aligned);
+    int i;
+    for (i = 0; i < N_NDARRAY_CACHE_WAYS; i++) {
+        ndarray_cache_entry_t *entry = &set[i];
+        if (entry->descr == descr && entry->ndim == ndim &&
+            entry->layout == layout && entry->readonly == readonly &&
+            entry->aligned == aligned)
+            return entry->typecode;
+    }
+    return -1;
 }
 
 static
-void cache_ndarray_typecode(int ndim, int layout, PyArray_Descr* descr,
-                            int typecode) {
-    PyObject* key = ndarray_key(ndim, layout, descr);
-    PyObject* value = PyLong_FromLong(typecode);
-    PyDict_SetItem(ndarray_typecache, key, value);
-    Py_DECREF(key);
-    Py_DECREF(value);
+void cache_ndarray_typecode(int ndim, int layout, PyArray_Descr *descr,
+                            int readonly, int aligned, int typecode) {
+    ndarray_cache_entry_t *set = ndarray_cache_set(ndim, layout, descr,
+                                                   readonly, aligned);
+    /* Entries are kept in insertion order, evict the oldest one */
+    PyArray_Descr *evicted = set[N_NDARRAY_CACHE_WAYS - 1].descr;
+    memmove(&set[1], &set[0],
+            (N_NDARRAY_CACHE_WAYS - 1) * sizeof(ndarray_cache_entry_t));
+    Py_INCREF(descr);
+    set[0].descr = descr;
+    set[0].ndim = ndim;
+    set[0].layout = layout;
+    set[0].readonly = readonly;
+    set[0].aligned = aligned;
+    set[0].typecode = typecode;
+    Py_XDECREF(evicted);
 }
 
 static
@@ -756,6 +918,7 @@ int typecode_ndarray(PyObject *dispatcher, PyArrayObject *ary) {
     int dtype;
     int ndim = PyArray_NDIM(ary);
     int layout = 0;
+    int readonly, aligned;
 
     /* The order in which we check for the right contiguous-ness is important.
        The order must match the order by numba.numpy_support.map_layout.
@@ -792,17 +955,18 @@ int typecode_ndarray(PyObject *dispatcher, PyArrayObject *ary) {
 
 FALLBACK:
     /* Slower path, for non-trivial array types */
-
-    /* If this isn't a structured array then we can't use the cache */
-    if (PyArray_TYPE(ary) != NPY_VOID)
-        return typecode_using_fingerprint(dispatcher, (PyObject *) ary);
+    readonly = !PyArray_ISWRITEABLE(ary);
+    aligned = PyArray_ISALIGNED(ary) ? 1 : 0;
 
     /* Check type cache */
-    typecode = get_cached_ndarray_typecode(ndim, layout, PyArray_DESCR(ary));
+    typecode = get_cached_ndarray_typecode(ndim, layout, PyArray_DESCR(ary),
+                                           readonly, aligned);
     if (typecode == -1) {
         /* First use of this type, use fallback and populate the cache */
         typecode = typecode_fallback_keep_ref(dispatcher, (PyObject*)ary);
-        cache_ndarray_typecode(ndim, layout, PyArray_DESCR(ary), typecode);
+        if (typecode != -1)
+            cache_ndarray_typecode(ndim, layout, PyArray_DESCR(ary),
+                                   readonly, aligned, typecode);
     }
     return typecode;
 }
@@ -1104,10 +1268,8 @@ typeof_init(PyObject *self, PyObject *args)
     #undef UNWRAP_TYPE
 
     typecache = PyDict_New();
-    ndarray_typecache = PyDict_New();
     structured_dtypes = PyDict_New();
-    if (typecache == NULL || ndarray_typecache == NULL ||
-        structured_dtypes == NULL) {
+    if (typecache == NULL || structured_dtypes == NULL) {
         PyErr_SetString(PyExc_RuntimeError, "failed to create type cache");
         return NULL;
     }
@@ -53,6 +53,27 @@ DK_ENTRIES(dk) can be used to get pointer to entries.
 NOTE: Since negative value is used for DKIX_EMPTY and DKIX_DUMMY, type of
 dk_indices entry is signed integer and int16 is used for table which
 dk_size == 256.
+
+(Numba dev notes: grouped layout)
+
+A dict created with the NB_DICT_GROUPED flag has an array of dk_size control
+bytes between dk_indices and dk_entries:
+
++---------------+
+| dk_indices    |
++---------------+
+| dk_ctrl       |
++---------------+
+| dk_entries    |
++---------------+
+
+A control byte is CTRL_EMPTY, CTRL_DELETED, or 7 bits of the hash of the
+entry in the slot.  Lookups compare the control bytes of a group of
+GROUP_WIDTH slots with the hash bits at once, and only read dk_indices and
+dk_entries for the slots that match, instead of reading them for every slot
+of the probe sequence.  The slot state is held by the control byte, so
+dk_indices entries are only meaningful for slots in use.  Entries and their
+insertion order are the same as in the default layout.
 */
 
 
@@ -276,6 +297,8 @@ int mem_cmp_zeros(void *obj, size_t n){
 #endif
 
 #define D_MASK(dk) ((dk)->size-1)
+#define D_GROUPED(dk) ((dk)->flags & NB_DICT_GROUPED)
+#define D_POD_KEYS(dk) ((dk)->flags & NB_DICT_POD_KEYS)
 #define D_GROWTH_RATE(d) ((d)->used*3)
 
 static int
@@ -357,6 +380,190 @@ set_index(NB_DictKeys *dk, Py_ssize_t i, Py_ssize_t ix)
 }
 
 
+/* Grouped layout, see the notes at the top.
+
+Groups are aligned runs of GROUP_WIDTH slots, probed in the triangular
+sequence g, g+1, g+3, g+6, ... which visits every group of a table of a
+power of two number of groups.  The starting group and the control byte
+come from a multiplicative mix of the hash, so that the regular hashes of
+ints spread over both.
+*/
+
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY ((int8_t)-1)
+#define CTRL_DELETED ((int8_t)-128)
+
+#if SIZEOF_VOID_P > 4
+#define GROUP_MIX_MULTIPLIER ((size_t)0x9e3779b97f4a7c15ULL)
+#else
+#define GROUP_MIX_MULTIPLIER ((size_t)0x9e3779b9UL)
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GROUP_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Bit mask of the slots of a group, bit i for slot i */
+typedef unsigned int group_mask_t;
+
+static int8_t *
+get_ctrl(NB_DictKeys *dk) {
+    return (int8_t*)(dk->indices + dk->entry_offset - dk->size);
+}
+
+static size_t
+group_mix(Py_hash_t hash) {
+    return (size_t)hash * GROUP_MIX_MULTIPLIER;
+}
+
+/* Index of the first slot of the first group to probe */
+static size_t
+group_start(NB_DictKeys *dk, size_t mix) {
+    return (mix ^ (mix >> (4 * sizeof(size_t)))) & D_MASK(dk)
+           & ~(size_t)(GROUP_WIDTH - 1);
+}
+
+/* The control byte of a slot in use, 0 to 0x7f */
+static int8_t
+group_h2(size_t mix) {
+    return (int8_t)(mix >> (8 * sizeof(size_t) - 7));
+}
+
+/* Slots of the group at ctrl whose control byte is h */
+static group_mask_t
+group_match(const int8_t *ctrl, int8_t h) {
+#ifdef GROUP_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (group_mask_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8(h)));
+#else
+    group_mask_t mask = 0;
+    int i;
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (group_mask_t)(ctrl[i] == h) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Slots of the group at ctrl that are not in use, i.e. CTRL_EMPTY or
+   CTRL_DELETED, which are the control bytes with the high bit set */
+static group_mask_t
+group_match_free(const int8_t *ctrl) {
+#ifdef GROUP_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (group_mask_t)_mm_movemask_epi8(group);
+#else
+    group_mask_t mask = 0;
+    int i;
+    for (i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (group_mask_t)(ctrl[i] < 0) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Index of the lowest slot of a non-empty mask */
+static int
+group_first(group_mask_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (int)i;
+#else
+    int i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/* Slot of the entry at index ix, or DKIX_EMPTY if it is not in the table */
+static Py_ssize_t
+group_find_index(NB_DictKeys *dk, Py_hash_t hash, Py_ssize_t ix) {
+    int8_t *ctrl = get_ctrl(dk);
+    size_t mix = group_mix(hash);
+    size_t mask = D_MASK(dk);
+    size_t pos = group_start(dk, mix);
+    size_t step = 0;
+    int8_t h2 = group_h2(mix);
+
+    for (;;) {
+        group_mask_t match = group_match(ctrl + pos, h2);
+        while (match) {
+            size_t i = pos + group_first(match);
+            if (get_index(dk, i) == ix) {
+                return i;
+            }
+            match &= match - 1;
+        }
+        if (group_match(ctrl + pos, CTRL_EMPTY)) {
+            return DKIX_EMPTY;
+        }
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+    assert(0 && "unreachable");
+}
+
+/* First slot not in use of the probe sequence of hash */
+static Py_ssize_t
+group_find_free(NB_DictKeys *dk, Py_hash_t hash) {
+    int8_t *ctrl = get_ctrl(dk);
+    size_t mix = group_mix(hash);
+    size_t mask = D_MASK(dk);
+    size_t pos = group_start(dk, mix);
+    size_t step = 0;
+
+    for (;;) {
+        group_mask_t avail = group_match_free(ctrl + pos);
+        if (avail) {
+            return pos + group_first(avail);
+        }
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+    assert(0 && "unreachable");
+}
+
+/* Point the slot at hashpos to the entry at index ix */
+static void
+fill_slot(NB_DictKeys *dk, Py_ssize_t hashpos, Py_hash_t hash, Py_ssize_t ix) {
+    set_index(dk, hashpos, ix);
+    if (D_GROUPED(dk)) {
+        get_ctrl(dk)[hashpos] = group_h2(group_mix(hash));
+    }
+}
+
+/* Mark the slot at hashpos as deleted */
+static void
+clear_slot(NB_DictKeys *dk, Py_ssize_t hashpos) {
+    if (D_GROUPED(dk)) {
+        int8_t *ctrl = get_ctrl(dk);
+        size_t group = hashpos & ~(size_t)(GROUP_WIDTH - 1);
+        /* A group with an empty slot never was full, so no probe sequence
+           goes on past it and the slot can be made empty again. */
+        if (group_match(ctrl + group, CTRL_EMPTY)) {
+            ctrl[hashpos] = CTRL_EMPTY;
+        } else {
+            ctrl[hashpos] = CTRL_DELETED;
+        }
+    } else {
+        set_index(dk, hashpos, DKIX_DUMMY);
+    }
+}
+
+
 /* USABLE_FRACTION is the maximum dictionary load.
  * Increasing this ratio makes dictionaries more dense resulting in more
  * collisions.  Decreasing it improves sparseness at the expense of spreading
@@ -421,9 +628,48 @@ copy_val(NB_DictKeys *dk, char *dst, const char *src){
     memcpy(dst, src, dk->val_size);
 }
 
+/* Bytewise comparison of keys of key_size bytes, inlined for the sizes of
+   scalars.  The fixed size memcpy() are plain (unaligned) loads. */
+static int
+pod_key_equal(const char *lhs, const char *rhs, Py_ssize_t key_size) {
+    switch (key_size) {
+    case 1:
+        return *lhs == *rhs;
+    case 2: {
+        uint16_t a, b;
+        memcpy(&a, lhs, 2);
+        memcpy(&b, rhs, 2);
+        return a == b;
+    }
+    case 4: {
+        uint32_t a, b;
+        memcpy(&a, lhs, 4);
+        memcpy(&b, rhs, 4);
+        return a == b;
+    }
+    case 8: {
+        uint64_t a, b;
+        memcpy(&a, lhs, 8);
+        memcpy(&b, rhs, 8);
+        return a == b;
+    }
+    case 16: {
+        uint64_t a[2], b[2];
+        memcpy(a, lhs, 16);
+        memcpy(b, rhs, 16);
+        return ((a[0] ^ b[0]) | (a[1] ^ b[1])) == 0;
+    }
+    default:
+        return memcmp(lhs, rhs, key_size) == 0;
+    }
+}
+
 /* Returns -1 for error; 0 for not equal; 1 for equal */
 static int
 key_equal(NB_DictKeys *dk, const char *lhs, const char *rhs) {
+    if ( D_POD_KEYS(dk) ) {
+        return pod_key_equal(lhs, rhs, dk->key_size);
+    }
     if ( dk->methods.key_equal ) {
         return dk->methods.key_equal(lhs, rhs);
     } else {
@@ -447,14 +693,14 @@ entry_get_val(NB_DictKeys *dk, NB_DictEntry* entry) {
 
 static void
 dk_incref_key(NB_DictKeys *dk, const char *key) {
-    if ( dk->methods.key_incref ) {
+    if ( !D_POD_KEYS(dk) && dk->methods.key_incref ) {
         dk->methods.key_incref(key);
     }
 }
 
 static void
 dk_decref_key(NB_DictKeys *dk, const char *key) {
-    if ( dk->methods.key_decref ) {
+    if ( !D_POD_KEYS(dk) && dk->methods.key_decref ) {
         dk->methods.key_decref(key);
     }
 }
@@ -507,14 +753,24 @@ numba_dict_length(NB_Dict *d) {
 Adapted from CPython's new_keys_object().
 */
 int
-numba_dictkeys_new(NB_DictKeys **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t val_size) {
-    Py_ssize_t usable = USABLE_FRACTION(size);
-    Py_ssize_t index_size = ix_size(size);
-    Py_ssize_t entry_size = aligned_size(sizeof(NB_DictEntry) + aligned_size(key_size) + aligned_size(val_size));
-    Py_ssize_t entry_offset = aligned_size(index_size * size);
-    Py_ssize_t alloc_size = sizeof(NB_DictKeys) + entry_offset + entry_size * usable;
-
-    NB_DictKeys *dk = malloc(aligned_size(alloc_size));
+numba_dictkeys_new(NB_DictKeys **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t val_size, int flags) {
+    Py_ssize_t usable, index_size, entry_size, entry_offset, alloc_size;
+    NB_DictKeys *dk;
+
+    if ((flags & NB_DICT_GROUPED) && size < GROUP_WIDTH) {
+        size = GROUP_WIDTH;
+    }
+    usable = USABLE_FRACTION(size);
+    index_size = ix_size(size);
+    entry_size = aligned_size(sizeof(NB_DictEntry) + aligned_size(key_size) + aligned_size(val_size));
+    entry_offset = aligned_size(index_size * size);
+    if (flags & NB_DICT_GROUPED) {
+        /* control bytes, the size is a multiple of the alignment */
+        entry_offset += size;
+    }
+    alloc_size = sizeof(NB_DictKeys) + entry_offset + entry_size * usable;
+
+    dk = malloc(aligned_size(alloc_size));
     if (!dk) return ERR_NO_MEMORY;
 
     assert ( size >= D_MINSIZE );
@@ -526,11 +782,13 @@ numba_dictkeys_new(NB_DictKeys **out, Py_ssize_t size, Py_ssize_t key_size, Py_s
     dk->val_size = val_size;
     dk->entry_offset = entry_offset;
     dk->entry_size = entry_size;
+    dk->flags = flags;
 
     assert (aligned_pointer(dk->indices) == dk->indices );
     /* Ensure that the method table is all nulls */
     memset(&dk->methods, 0x00, sizeof(type_based_methods_table));
-    /* Ensure hash is (-1) for empty entry */
+    /* Ensure hash is (-1) for empty entry, and control bytes are
+       CTRL_EMPTY */
     memset(dk->indices, 0xff, entry_offset + entry_size * usable);
 
     *out = dk;
@@ -541,9 +799,19 @@ numba_dictkeys_new(NB_DictKeys **out, Py_ssize_t size, Py_ssize_t key_size, Py_s
 /* Allocate new dictionary */
 int
 numba_dict_new(NB_Dict **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t val_size) {
+    return numba_dict_new_flags(out, size, key_size, val_size, 0);
+}
+
+int
+numba_dict_new_flags(NB_Dict **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t val_size, int flags) {
     NB_DictKeys* dk;
     NB_Dict *d;
-    int status = numba_dictkeys_new(&dk, size, key_size, val_size);
+    int status;
+
+    if (size < D_MINSIZE) {
+        size = D_MINSIZE;
+    }
+    status = numba_dictkeys_new(&dk, size, key_size, val_size, flags);
     if (status != OK) return status;
 
     d = malloc(sizeof(NB_Dict));
@@ -558,6 +826,11 @@ numba_dict_new(NB_Dict **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t v
     return OK;
 }
 
+int
+numba_dict_flags(NB_Dict *d) {
+    return (int)d->keys->flags;
+}
+
 /*
 Adapted from CPython lookdict_index().
 
@@ -570,6 +843,9 @@ lookdict_index(NB_DictKeys *dk, Py_hash_t hash, Py_ssize_t index)
     size_t perturb = (size_t)hash;
     size_t i = (size_t)hash & mask;
 
+    if (D_GROUPED(dk)) {
+        return group_find_index(dk, hash, index);
+    }
     for (;;) {
         Py_ssize_t ix = get_index(dk, i);
         if (ix == index) {
@@ -611,6 +887,50 @@ lookdict_unicode_nodummy is further specialized for string keys that cannot be
 the <dummy> value.
 For both, when the key isn't found a DKIX_EMPTY is returned.
 */
+
+/*
+Lookup of the grouped layout, see numba_dict_lookup().
+*/
+static Py_ssize_t
+group_lookup(NB_DictKeys *dk, const char *key_bytes, Py_hash_t hash, char *oldval_bytes)
+{
+    int8_t *ctrl = get_ctrl(dk);
+    size_t mix = group_mix(hash);
+    size_t mask = D_MASK(dk);
+    size_t pos = group_start(dk, mix);
+    size_t step = 0;
+    int8_t h2 = group_h2(mix);
+
+    for (;;) {
+        group_mask_t match = group_match(ctrl + pos, h2);
+        while (match) {
+            Py_ssize_t ix = get_index(dk, pos + group_first(match));
+            NB_DictEntry *ep = get_entry(dk, ix);
+            if (ep->hash == hash) {
+                int cmp = key_equal(dk, entry_get_key(dk, ep), key_bytes);
+                if (cmp < 0) {
+                    // error'ed in comparison
+                    memset(oldval_bytes, 0, dk->val_size);
+                    return DKIX_ERROR;
+                }
+                if (cmp > 0) {
+                    // key is equal; retrieve the value.
+                    copy_val(dk, oldval_bytes, entry_get_val(dk, ep));
+                    return ix;
+                }
+            }
+            match &= match - 1;
+        }
+        if (group_match(ctrl + pos, CTRL_EMPTY)) {
+            zero_val(dk, oldval_bytes);
+            return DKIX_EMPTY;
+        }
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+    assert(0 && "unreachable");
+}
+
 Py_ssize_t
 numba_dict_lookup(NB_Dict *d, const char *key_bytes, Py_hash_t hash, char *oldval_bytes)
 {
@@ -619,6 +939,9 @@ numba_dict_lookup(NB_Dict *d, const char *key_bytes, Py_hash_t hash, char *oldva
     size_t perturb = hash;
     size_t i = (size_t)hash & mask;
 
+    if (D_GROUPED(dk)) {
+        return group_lookup(dk, key_bytes, hash, oldval_bytes);
+    }
     for (;;) {
         Py_ssize_t ix = get_index(dk, i);
         if (ix == DKIX_EMPTY) {
@@ -665,6 +988,9 @@ find_empty_slot(NB_DictKeys *dk, Py_hash_t hash){
 
     assert(dk != NULL);
 
+    if (D_GROUPED(dk)) {
+        return group_find_free(dk, hash);
+    }
     mask = D_MASK(dk);
     i = hash & mask;
     ix = get_index(dk, i);
@@ -714,7 +1040,7 @@ numba_dict_insert(
         }
         hashpos = find_empty_slot(dk, hash);
         ep = get_entry(dk, dk->nentries);
-        set_index(dk, hashpos, dk->nentries);
+        fill_slot(dk, hashpos, hash, dk->nentries);
         copy_key(dk, entry_get_key(dk, ep), key_bytes);
         assert ( hash != -1 );
         ep->hash = hash;
@@ -750,6 +1076,13 @@ void
 build_indices(NB_DictKeys *keys, Py_ssize_t n) {
     size_t mask = (size_t)D_MASK(keys);
     Py_ssize_t ix;
+    if (D_GROUPED(keys)) {
+        for (ix = 0; ix != n; ix++) {
+            Py_hash_t hash = get_entry(keys, ix)->hash;
+            fill_slot(keys, group_find_free(keys, hash), hash, ix);
+        }
+        return;
+    }
     for (ix = 0; ix != n; ix++) {
         size_t perturb;
         Py_hash_t hash = get_entry(keys, ix)->hash;
@@ -798,7 +1131,8 @@ numba_dict_resize(NB_Dict *d, Py_ssize_t minsize) {
 
     /* Allocate a new table. */
     status = numba_dictkeys_new(
-        &d->keys, newsize, oldkeys->key_size, oldkeys->val_size
+        &d->keys, newsize, oldkeys->key_size, oldkeys->val_size,
+        (int)oldkeys->flags
     );
     if (status != OK) {
         d->keys = oldkeys;
@@ -852,6 +1186,31 @@ numba_dict_resize(NB_Dict *d, Py_ssize_t minsize) {
     return OK;
 }
 
+/*
+Deletions leave holes in the entries, which lookups do not see but iteration
+steps over, and the table is only resized, which drops them, when an
+insertion runs out of usable entries.  So a deletion resizes the table for
+the items, as an insertion does, when the holes outnumber the items (and
+D_MINSIZE), or when the items fill less than D_SHRINK_FRACTION of the table,
+so that the memory and the iteration cost follow the number of items.  The
+resize costs O(holes + items) and comes after at least as many deletions.
+*/
+#define D_SHRINK_FRACTION(n) ((n) >> 3)
+
+static void
+deletion_resize(NB_Dict *d)
+{
+    NB_DictKeys *dk = d->keys;
+    Py_ssize_t holes = dk->nentries - d->used;
+    Py_ssize_t minsize = D_GROUPED(dk) ? GROUP_WIDTH : D_MINSIZE;
+
+    if ((holes > d->used && holes >= D_MINSIZE) ||
+        (dk->size > minsize && d->used < D_SHRINK_FRACTION(dk->size))) {
+        /* The table is kept as it is if the allocation fails */
+        numba_dict_resize(d, D_GROWTH_RATE(d));
+    }
+}
+
 /*
     Adapted from CPython delitem_common
  */
@@ -867,7 +1226,7 @@ numba_dict_delitem(NB_Dict *d, Py_hash_t hash, Py_ssize_t ix)
 
     d->used -= 1;
     ep = get_entry(dk, ix);
-    set_index(dk, hashpos, DKIX_DUMMY);
+    clear_slot(dk, hashpos);
 
     /* decref */
     dk_decref_key(dk, entry_get_key(dk, ep));
@@ -878,6 +1237,7 @@ numba_dict_delitem(NB_Dict *d, Py_hash_t hash, Py_ssize_t ix)
     zero_val(dk, entry_get_val(dk, ep));
     ep->hash = DKIX_EMPTY; // to mark it as empty;
 
+    deletion_resize(d);
     return OK;
 }
 
@@ -907,7 +1267,7 @@ numba_dict_popitem(NB_Dict *d, char *key_bytes, char *val_bytes)
     j = lookdict_index(d->keys, ep->hash, i);
     assert(j >= 0);
     assert(get_index(d->keys, j) == i);
-    set_index(d->keys, j, DKIX_DUMMY);
+    clear_slot(d->keys, j);
 
     key_ptr = entry_get_key(d->keys, ep);
     val_ptr = entry_get_val(d->keys, ep);
@@ -922,6 +1282,7 @@ numba_dict_popitem(NB_Dict *d, char *key_bytes, char *val_bytes)
     d->keys->nentries = i;
     d->used--;
 
+    deletion_resize(d);
     return OK;
 }
 
@@ -1005,6 +1366,144 @@ numba_dict_insert_ez(
     return numba_dict_insert(d, key_bytes, hash, val_bytes, old);
 }
 
+/* Bulk operations
+
+They do the insertions and lookups of a batch of keys one by one, but first
+prefetch the probes of the keys ahead, so that the cache misses of several
+keys overlap: the first slot of a key PREFETCH_DISTANCE * 2 ahead, and the
+entry that slot points to for the key PREFETCH_DISTANCE ahead, by which time
+the slot has been loaded.  Tables smaller than PREFETCH_MIN_SIZE likely
+fit in the cache and are not prefetched.
+*/
+
+#define PREFETCH_DISTANCE 8
+#define PREFETCH_MIN_SIZE (1 << 16)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
+
+/* Prefetch the first slot probed for hash */
+static void
+prefetch_slot(NB_DictKeys *dk, Py_hash_t hash) {
+    size_t i;
+    if (D_GROUPED(dk)) {
+        i = group_start(dk, group_mix(hash));
+        PREFETCH(get_ctrl(dk) + i);
+    } else {
+        i = (size_t)hash & D_MASK(dk);
+    }
+    PREFETCH(dk->indices + i * ix_size(dk->size));
+}
+
+/* Prefetch the entry of the first slot probed for hash, if it may hold
+   the key */
+static void
+prefetch_entry(NB_DictKeys *dk, Py_hash_t hash) {
+    Py_ssize_t ix;
+    if (D_GROUPED(dk)) {
+        size_t mix = group_mix(hash);
+        size_t pos = group_start(dk, mix);
+        group_mask_t match = group_match(get_ctrl(dk) + pos, group_h2(mix));
+        if (!match) {
+            return;
+        }
+        ix = get_index(dk, pos + group_first(match));
+    } else {
+        ix = get_index(dk, (size_t)hash & D_MASK(dk));
+    }
+    if (ix >= 0) {
+        PREFETCH(get_entry(dk, ix));
+    }
+}
+
+static void
+prefetch_ahead(NB_DictKeys *dk, const Py_hash_t *hashes, Py_ssize_t i, Py_ssize_t n) {
+    if (dk->size < PREFETCH_MIN_SIZE) {
+        return;
+    }
+    if (i + 2 * PREFETCH_DISTANCE < n) {
+        prefetch_slot(dk, hashes[i + 2 * PREFETCH_DISTANCE]);
+    }
+    if (i + PREFETCH_DISTANCE >= 0 && i + PREFETCH_DISTANCE < n) {
+        prefetch_entry(dk, hashes[i + PREFETCH_DISTANCE]);
+    }
+}
+
+int
+numba_dict_insert_many(
+    NB_Dict         *d,
+    const char      *keys,
+    const Py_hash_t *hashes,
+    const char      *vals,
+    Py_ssize_t       n
+    )
+{
+    Py_ssize_t i;
+    Py_ssize_t key_size = d->keys->key_size;
+    Py_ssize_t val_size = d->keys->val_size;
+    STACK_ALLOC(char, old, val_size);
+
+    if (n <= 0) {
+        return OK;
+    }
+    /* Presize for n new keys, so that the table is resized at most once */
+    if (d->keys->usable < n) {
+        int status = numba_dict_resize(d, ((d->used + n) * 3 + 1) >> 1);
+        if (status != OK) {
+            return status;
+        }
+    }
+    for (i = -2 * PREFETCH_DISTANCE; i < 0; i++) {
+        prefetch_ahead(d->keys, hashes, i, n);
+    }
+    for (i = 0; i < n; i++) {
+        int status;
+        prefetch_ahead(d->keys, hashes, i, n);
+        status = numba_dict_insert(d, keys + i * key_size, hashes[i],
+                                   vals + i * val_size, old);
+        if (status < 0) {
+            return status;
+        }
+    }
+    return OK;
+}
+
+Py_ssize_t
+numba_dict_lookup_many(
+    NB_Dict         *d,
+    const char      *keys,
+    const Py_hash_t *hashes,
+    char            *out_vals,
+    char            *out_found,
+    Py_ssize_t       n
+    )
+{
+    NB_DictKeys *dk = d->keys;
+    Py_ssize_t i;
+    Py_ssize_t nfound = 0;
+
+    for (i = -2 * PREFETCH_DISTANCE; i < 0; i++) {
+        prefetch_ahead(dk, hashes, i, n);
+    }
+    for (i = 0; i < n; i++) {
+        Py_ssize_t ix;
+        prefetch_ahead(dk, hashes, i, n);
+        ix = numba_dict_lookup(d, keys + i * dk->key_size, hashes[i],
+                               out_vals + i * dk->val_size);
+        if (ix == DKIX_ERROR) {
+            return ERR_CMP_FAILED;
+        }
+        out_found[i] = ix >= 0;
+        nfound += ix >= 0;
+    }
+    return nfound;
+}
+
 int
 numba_dict_new_minsize(NB_Dict **out, Py_ssize_t key_size, Py_ssize_t val_size)
 {
@@ -1015,6 +1514,92 @@ void
 numba_dict_set_method_table(NB_Dict *d, type_based_methods_table *methods)
 {
     memcpy(&d->keys->methods, methods, sizeof(type_based_methods_table));
+    /* Keys with methods are not plain data */
+    if (methods->key_equal || methods->key_incref || methods->key_decref) {
+        d->keys->flags &= ~NB_DICT_POD_KEYS;
+    }
+}
+
+
+/* Concurrent dict
+
+A concurrent dict is a fixed number of shards, each a plain dict with a
+spinlock.  The shard of a key is taken from the bits of its mixed hash
+right below the ones of group_h2(), which the grouped layout stores in the
+control bytes, so that the keys of a shard keep their spread over its own
+hashtable.  The locks are taken and released by the jitted code around
+each operation on the dict of a shard.
+*/
+
+static NB_DictShard *
+shard_at(NB_ConcurrentDict *cd, Py_ssize_t i) {
+    return (NB_DictShard*)(cd->shards + i * NB_DICT_SHARD_STRIDE);
+}
+
+void
+numba_concurrent_dict_free(NB_ConcurrentDict *cd) {
+    Py_ssize_t i;
+    for (i = 0; i < cd->nshards; i++) {
+        /* NULL for the shards left unallocated by an allocation failure */
+        if (shard_at(cd, i)->dict) {
+            numba_dict_free(shard_at(cd, i)->dict);
+        }
+    }
+    free(cd->shards_mem);
+    free(cd);
+}
+
+int
+numba_concurrent_dict_new(NB_ConcurrentDict **out, Py_ssize_t nshards, Py_ssize_t key_size, Py_ssize_t val_size, int flags) {
+    NB_ConcurrentDict *cd;
+    Py_ssize_t i;
+    int log2n = 0;
+
+    if (nshards > NB_DICT_MAX_SHARDS) {
+        nshards = NB_DICT_MAX_SHARDS;
+    }
+    while (((Py_ssize_t)1 << log2n) < nshards) {
+        log2n++;
+    }
+
+    cd = malloc(sizeof(NB_ConcurrentDict));
+    if (!cd) return ERR_NO_MEMORY;
+    cd->nshards = (Py_ssize_t)1 << log2n;
+    cd->shift = 8 * sizeof(size_t) - 7 - log2n;
+    /* One more stride to align the shards on it */
+    cd->shards_mem = calloc(cd->nshards + 1, NB_DICT_SHARD_STRIDE);
+    if (!cd->shards_mem) {
+        free(cd);
+        return ERR_NO_MEMORY;
+    }
+    cd->shards = (char*)(((size_t)cd->shards_mem + NB_DICT_SHARD_STRIDE - 1)
+                         & ~(size_t)(NB_DICT_SHARD_STRIDE - 1));
+    for (i = 0; i < cd->nshards; i++) {
+        int status = numba_dict_new_flags(&shard_at(cd, i)->dict, D_MINSIZE,
+                                          key_size, val_size, flags);
+        if (status != OK) {
+            numba_concurrent_dict_free(cd);
+            return status;
+        }
+    }
+    *out = cd;
+    return OK;
+}
+
+Py_ssize_t
+numba_concurrent_dict_nshards(NB_ConcurrentDict *cd) {
+    return cd->nshards;
+}
+
+NB_DictShard *
+numba_concurrent_dict_shard_at(NB_ConcurrentDict *cd, Py_ssize_t i) {
+    return shard_at(cd, i);
+}
+
+NB_DictShard *
+numba_concurrent_dict_shard(NB_ConcurrentDict *cd, Py_hash_t hash) {
+    size_t i = (group_mix(hash) >> cd->shift) & (size_t)(cd->nshards - 1);
+    return shard_at(cd, (Py_ssize_t)i);
 }
 
 
@@ -1028,10 +1613,13 @@ numba_dict_set_method_table(NB_Dict *d, type_based_methods_table *methods)
 int
 numba_test_dict(void) {
     NB_Dict *d;
+    NB_ConcurrentDict *cd;
+    NB_DictShard *shard;
     int status;
     Py_ssize_t ix;
     Py_ssize_t usable;
     Py_ssize_t it_count;
+    Py_ssize_t i, size;
     const char *it_key, *it_val;
     NB_DictIter iter;
 
@@ -1184,6 +1772,88 @@ numba_test_dict(void) {
     CHECK(d->used == it_count);
 
     numba_dict_free(d);
+
+    // Test that deletions shrink the table and drop the holes
+    status = numba_dict_new(&d, D_MINSIZE, 8, 8);
+    CHECK(status == OK);
+    for (i = 0; i < 1000; i++) {
+        status = numba_dict_insert_ez(d, (char*)&i, i, (char*)&i);
+        CHECK(status == OK);
+    }
+    size = d->keys->size;
+    for (i = 0; i < 990; i++) {
+        ix = numba_dict_lookup(d, (char*)&i, i, got_value);
+        CHECK(ix >= 0);
+        status = numba_dict_delitem(d, i, ix);
+        CHECK(status == OK);
+        CHECK(d->keys->nentries - d->used <= d->used ||
+              d->keys->nentries - d->used < D_MINSIZE);
+    }
+    CHECK(d->used == 10);
+    CHECK(d->keys->size < size / 16);
+    for (i = 990; i < 1000; i++) {
+        ix = numba_dict_lookup(d, (char*)&i, i, got_value);
+        CHECK(ix >= 0);
+        CHECK(memcmp(got_value, &i, 8) == 0);
+    }
+
+    // Test that a sliding window keeps the size of the table
+    for (i = 1000; i < 100000; i++) {
+        Py_ssize_t old = i - 10;
+        status = numba_dict_insert_ez(d, (char*)&i, i, (char*)&i);
+        CHECK(status == OK);
+        ix = numba_dict_lookup(d, (char*)&old, old, got_value);
+        CHECK(ix >= 0);
+        status = numba_dict_delitem(d, old, ix);
+        CHECK(status == OK);
+        CHECK(d->keys->size <= 64);
+    }
+    CHECK(d->used == 10);
+
+    // Test that popitem shrinks the table
+    while (d->used) {
+        status = numba_dict_popitem(d, got_value, got_value);
+        CHECK(status == OK);
+    }
+    CHECK(d->keys->size == D_MINSIZE);
+
+    numba_dict_free(d);
+
+    // Test the shards of a concurrent dict
+    status = numba_concurrent_dict_new(&cd, 5, 8, 8, 0);
+    CHECK(status == OK);
+    CHECK(numba_concurrent_dict_nshards(cd) == 8);
+    for (i = 0; i < 8; i++) {
+        shard = numba_concurrent_dict_shard_at(cd, i);
+        CHECK(((size_t)shard & (NB_DICT_SHARD_STRIDE - 1)) == 0);
+        CHECK(shard->lock == 0);
+        CHECK(shard->dict->used == 0);
+    }
+    for (i = 0; i < 1000; i++) {
+        shard = numba_concurrent_dict_shard(cd, i);
+        CHECK(shard == numba_concurrent_dict_shard(cd, i));
+        status = numba_dict_insert_ez(shard->dict, (char*)&i, i, (char*)&i);
+        CHECK(status == OK);
+    }
+    for (i = 0; i < 8; i++) {
+        // the keys are spread over all the shards
+        shard = numba_concurrent_dict_shard_at(cd, i);
+        CHECK(shard->dict->used > 1000 / 16);
+    }
+    for (i = 0; i < 1000; i++) {
+        shard = numba_concurrent_dict_shard(cd, i);
+        ix = numba_dict_lookup(shard->dict, (char*)&i, i, got_value);
+        CHECK(ix >= 0);
+        CHECK(memcmp(got_value, &i, 8) == 0);
+    }
+    numba_concurrent_dict_free(cd);
+
+    status = numba_concurrent_dict_new(&cd, 0, 8, 8, NB_DICT_GROUPED);
+    CHECK(status == OK);
+    CHECK(numba_concurrent_dict_nshards(cd) == 1);
+    CHECK(numba_concurrent_dict_shard(cd, 12345) ==
+          numba_concurrent_dict_shard_at(cd, 0));
+    numba_concurrent_dict_free(cd);
     return 0;
 
 }
@@ -26,6 +26,11 @@ typedef struct {
 } type_based_methods_table;
 
 
+/* Flags of a dict, see numba_dict_new_flags() */
+#define NB_DICT_GROUPED 0x1
+#define NB_DICT_POD_KEYS 0x2
+
+
 typedef struct {
    /* hash table size */
     Py_ssize_t      size;
@@ -42,6 +47,8 @@ typedef struct {
     Py_ssize_t      key_size, val_size, entry_size;
     /* Byte offset from indices to the first entry. */
     Py_ssize_t      entry_offset;
+    /* NB_DICT_* flags of the dict */
+    Py_ssize_t      flags;
 
     /* Method table for type-dependent operations. */
     type_based_methods_table methods;
@@ -70,6 +77,36 @@ typedef struct {
 } NB_DictIter;
 
 
+/* A shard of a concurrent dict */
+typedef struct {
+    /* 1 while the shard is locked, 0 otherwise.  Only accessed atomically,
+       by the jitted code. */
+    int              lock;
+    /* Moved on by every update of the dict, under the lock.  Only accessed
+       by the jitted code. */
+    unsigned int     version;
+    NB_Dict         *dict;
+} NB_DictShard;
+
+
+/* Shards of a concurrent dict are this many bytes apart, a cache line, so
+   that the locks of two shards never share a line. */
+#define NB_DICT_SHARD_STRIDE 64
+/* Maximum number of shards of a concurrent dict */
+#define NB_DICT_MAX_SHARDS 4096
+
+
+typedef struct {
+    /* number of shards, a power of two */
+    Py_ssize_t       nshards;
+    /* the shard of a hash is (mixed hash >> shift) & (nshards - 1) */
+    int              shift;
+    /* the shards, NB_DICT_SHARD_STRIDE bytes apart */
+    char            *shards;
+    /* the allocation of the shards */
+    void            *shards_mem;
+} NB_ConcurrentDict;
+
 
 /* A test function for the dict
 Returns 0 for OK; 1 for failure.
@@ -91,6 +128,31 @@ Parameters
 NUMBA_EXPORT_FUNC(int)
 numba_dict_new(NB_Dict **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t val_size);
 
+/* Allocate a new dict with the given flags
+Parameters
+- NB_Dict **out
+    Output for the new dictionary.
+- Py_ssize_t size
+    Hashtable size. Must be power of two, it is rounded up to the smallest
+    size of the layout.
+- Py_ssize_t key_size
+    Size of a key entry.
+- Py_ssize_t val_size
+    Size of a value entry.
+- int flags
+    NB_DICT_* flags.  NB_DICT_GROUPED probes the hashtable in groups of
+    slots, through a byte of hash bits per slot, instead of slot by slot.
+    NB_DICT_POD_KEYS declares keys that are plain data: they are compared
+    bytewise inline and have no reference counting.  It is cleared if a
+    method table with key methods is set.
+*/
+NUMBA_EXPORT_FUNC(int)
+numba_dict_new_flags(NB_Dict **out, Py_ssize_t size, Py_ssize_t key_size, Py_ssize_t val_size, int flags);
+
+/* Returns the NB_DICT_* flags of a dict */
+NUMBA_EXPORT_FUNC(int)
+numba_dict_flags(NB_Dict *d);
+
 /* Free a dict */
 NUMBA_EXPORT_FUNC(void)
 numba_dict_free(NB_Dict *d);
@@ -158,6 +220,53 @@ numba_dict_insert(NB_Dict *d, const char *key_bytes, Py_hash_t hash, const char
 NUMBA_EXPORT_FUNC(int)
 numba_dict_insert_ez(NB_Dict *d, const char *key_bytes, Py_hash_t hash, const char *val_bytes);
 
+/* Insert a batch of keys and values to the dict, in order, as
+numba_dict_insert() does.  The table is first resized to hold all the keys
+as if they were new.
+
+Parameters
+- NB_Dict *d
+    The dictionary object.
+- const char *keys
+    The keys, as n contiguous byte buffers of the key size.
+- const Py_hash_t *hashes
+    The precomputed hashes of the keys.
+- const char *vals
+    The values, as n contiguous byte buffers of the value size.
+- Py_ssize_t n
+    The number of keys.
+
+Returns
+- < 0 for error; the keys before the failing one are inserted.
+- 0 for ok
+*/
+NUMBA_EXPORT_FUNC(int)
+numba_dict_insert_many(NB_Dict *d, const char *keys, const Py_hash_t *hashes, const char *vals, Py_ssize_t n);
+
+/* Lookup a batch of keys, as numba_dict_lookup() does.
+
+Parameters
+- NB_Dict *d
+    The dictionary object.
+- const char *keys
+    The keys, as n contiguous byte buffers of the key size.
+- const Py_hash_t *hashes
+    The precomputed hashes of the keys.
+- char *out_vals
+    Output for the n values, as contiguous byte buffers of the value size.
+    The value of a missing key is zeroed.
+- char *out_found
+    Output. 1 for the keys that are found, 0 for the others.
+- Py_ssize_t n
+    The number of keys.
+
+Returns
+- ERR_CMP_FAILED for error in a key comparison.
+- the number of keys found otherwise.
+*/
+NUMBA_EXPORT_FUNC(Py_ssize_t)
+numba_dict_lookup_many(NB_Dict *d, const char *keys, const Py_hash_t *hashes, char *out_vals, char *out_found, Py_ssize_t n);
+
 /* Delete an entry from the dict
 Parameters
 - NB_Dict *d
@@ -215,6 +324,45 @@ Returns
 NUMBA_EXPORT_FUNC(int)
 numba_dict_iter_next(NB_DictIter *it, const char **key_ptr, const char **val_ptr);
 
+/* Allocate a new concurrent dict: a fixed number of shards, each a dict
+of the minimal size and a lock.  A key belongs to the shard of its hash.
+The locks are taken by the callers, see numba_concurrent_dict_shard().
+
+Parameters
+- NB_ConcurrentDict **out
+    Output for the new dictionary.
+- Py_ssize_t nshards
+    Number of shards.  It is rounded up to a power of two, and clamped
+    to [1, NB_DICT_MAX_SHARDS].
+- Py_ssize_t key_size
+    Size of a key entry.
+- Py_ssize_t val_size
+    Size of a value entry.
+- int flags
+    NB_DICT_* flags of the dict of each shard.
+*/
+NUMBA_EXPORT_FUNC(int)
+numba_concurrent_dict_new(NB_ConcurrentDict **out, Py_ssize_t nshards, Py_ssize_t key_size, Py_ssize_t val_size, int flags);
+
+/* Free a concurrent dict and the dicts of its shards */
+NUMBA_EXPORT_FUNC(void)
+numba_concurrent_dict_free(NB_ConcurrentDict *cd);
+
+/* Returns the number of shards of a concurrent dict */
+NUMBA_EXPORT_FUNC(Py_ssize_t)
+numba_concurrent_dict_nshards(NB_ConcurrentDict *cd);
+
+/* Returns the shard of index i of a concurrent dict */
+NUMBA_EXPORT_FUNC(NB_DictShard *)
+numba_concurrent_dict_shard_at(NB_ConcurrentDict *cd, Py_ssize_t i);
+
+/* Returns the shard of a concurrent dict holding the keys of the
+precomputed hash.  The dict of the shard must only be used while holding
+the lock of the shard.
+*/
+NUMBA_EXPORT_FUNC(NB_DictShard *)
+numba_concurrent_dict_shard(NB_ConcurrentDict *cd, Py_hash_t hash);
+
 
 NUMBA_EXPORT_FUNC(void)
 numba_dict_dump(NB_Dict *);
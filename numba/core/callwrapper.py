@@ -101,42 +101,64 @@ class PyCallWrapper(object):
     def build(self):
         wrapname = self.fndesc.llvm_cpython_wrapper_name
 
-        # This is the signature of PyCFunctionWithKeywords
-        # (see CPython's methodobject.h)
+        # This is the signature of a METH_FASTCALL | METH_KEYWORDS function
+        # (_PyCFunctionFastWithKeywords, see CPython's methodobject.h), i.e.
+        # the vectorcall calling convention of PEP 590.
         pyobj = self.context.get_argument_type(types.pyobject)
-        wrapty = llvmlite.ir.FunctionType(pyobj, [pyobj, pyobj, pyobj])
+        py_ssize_t = self.context.get_value_type(types.intp)
+        wrapty = llvmlite.ir.FunctionType(pyobj, [pyobj, pyobj.as_pointer(),
+                                                  py_ssize_t, pyobj])
         wrapper = llvmlite.ir.Function(self.module, wrapty, name=wrapname)
 
         builder = IRBuilder(wrapper.append_basic_block('entry'))
 
         # - `closure` will receive the `self` pointer stored in the
         #   PyCFunction object (see _dynfunc.c)
-        # - `args` and `kws` will receive the tuple and dict objects
-        #   of positional and keyword arguments, respectively.
-        closure, args, kws = wrapper.args
+        # - `args` and `nargs` will receive the C array of positional
+        #   arguments and its length.
+        # - `kwnames` will receive the tuple of keyword argument names, or
+        #   NULL if there are none.
+        closure, args, nargs, kwnames = wrapper.args
         closure.name = 'py_closure'
         args.name = 'py_args'
-        kws.name = 'py_kws'
+        nargs.name = 'py_nargs'
+        kwnames.name = 'py_kwnames'
 
         api = self.context.get_python_api(builder)
-        self.build_wrapper(api, builder, closure, args, kws)
+        self.build_wrapper(api, builder, closure, args, nargs, kwnames)
 
         return wrapper, api
 
-    def build_wrapper(self, api, builder, closure, args, kws):
-        nargs = len(self.fndesc.argtypes)
-
-        objs = [api.alloca_obj() for _ in range(nargs)]
-        parseok = api.unpack_tuple(args, self.fndesc.qualname,
-                                   nargs, nargs, *objs)
-
-        pred = builder.icmp_unsigned(
-            '==',
-            parseok,
-            Constant(parseok.type, None))
+    def build_wrapper(self, api, builder, closure, args, nargs, kwnames):
+        nargs_expected = len(self.fndesc.argtypes)
+
+        # Keyword arguments are folded into positional ones by the
+        # dispatcher before the wrapper is called.
+        with cgutils.if_unlikely(builder,
+                                 cgutils.is_not_null(builder, kwnames)):
+            nkws = api.tuple_size(kwnames)
+            pred = builder.icmp_signed('!=', nkws, Constant(nkws.type, 0))
+            with cgutils.if_unlikely(builder, pred):
+                api.err_format("PyExc_TypeError",
+                               "%s() takes no keyword arguments",
+                               self.context.insert_const_string(
+                                   builder.module, self.fndesc.qualname))
+                builder.ret(api.get_null_object())
+
+        pred = builder.icmp_signed('!=', nargs,
+                                   Constant(nargs.type, nargs_expected))
         with cgutils.if_unlikely(builder, pred):
+            api.err_format("PyExc_TypeError",
+                           "%s expected %zd arguments, got %zd",
+                           self.context.insert_const_string(
+                               builder.module, self.fndesc.qualname),
+                           Constant(nargs.type, nargs_expected), nargs)
             builder.ret(api.get_null_object())
 
+        # References in the argument array are borrowed from the caller
+        objs = [builder.load(cgutils.gep_inbounds(builder, args, i))
+                for i in range(nargs_expected)]
+
         # Block that returns after erroneous argument unboxing/cleanup
         endblk = builder.append_basic_block("arg.end")
         with builder.goto_block(endblk):
@@ -146,7 +168,7 @@ class PyCallWrapper(object):
         env_manager = self.get_env(api, builder)
 
         cleanup_manager = _ArgManager(self.context, builder, api,
-                                      env_manager, endblk, nargs)
+                                      env_manager, endblk, nargs_expected)
 
         # Compute the arguments to the compiled Numba function.
         innerargs = []
@@ -155,7 +177,7 @@ class PyCallWrapper(object):
                 # It's an omitted value => ignore dummy Python object
                 innerargs.append(None)
             else:
-                val = cleanup_manager.add_arg(builder.load(obj), ty)
+                val = cleanup_manager.add_arg(obj, ty)
                 innerargs.append(val)
 
         if self.release_gil:
@@ -223,6 +223,27 @@ class _EnvReloader(object):
         # Enable debug prints in nrtdynmod and use of "safe" API functions
         DEBUG_NRT = _readenv("NUMBA_DEBUG_NRT", int, 0)
 
+        # Serve NRT allocations up to this many bytes from the thread-caching
+        # slab allocator, 0 disables it
+        NRT_SLAB_ALLOCATOR = _readenv("NUMBA_NRT_SLAB_ALLOCATOR", int, 0)
+
+        # Instrument compiled functions so that the NRT allocation profiler
+        # can attribute allocations to them
+        NRT_PROFILE = _readenv("NUMBA_NRT_PROFILE", int, 0)
+
+        # Map NRT allocations of at least this many bytes directly from the
+        # OS (Linux only), 0 disables it
+        NRT_LARGE_ALLOC_THRESHOLD = _readenv("NUMBA_NRT_LARGE_ALLOC_THRESHOLD",
+                                             int, 0)
+
+        # Use transparent huge pages for the large NRT allocations
+        NRT_LARGE_ALLOC_HUGEPAGES = _readenv("NUMBA_NRT_LARGE_ALLOC_HUGEPAGES",
+                                             int, 1)
+
+        # Interleave the pages of the large NRT allocations over NUMA nodes
+        NRT_LARGE_ALLOC_INTERLEAVE = _readenv(
+            "NUMBA_NRT_LARGE_ALLOC_INTERLEAVE", int, 0)
+
         # How many recently deserialized functions to retain regardless
         # of external references
         FUNCTION_CACHE_SIZE = _readenv("NUMBA_FUNCTION_CACHE_SIZE", int, 128)
@@ -355,6 +376,14 @@ class _EnvReloader(object):
         )
         THREADING_LAYER = _readenv("NUMBA_THREADING_LAYER", str, 'default')
 
+        # pin the threading layer workers to CPUs: 'compact', 'scatter' or a
+        # list of CPUs such as '0-3,8'. Empty leaves placement to the OS.
+        THREAD_AFFINITY = _readenv("NUMBA_THREAD_AFFINITY", str, '')
+
+        # record the busy time and chunks of each worker of the parallel
+        # regions, see numba.np.ufunc.parallel.get_parallel_profile()
+        PARALLEL_PROFILE = _readenv("NUMBA_PARALLEL_PROFILE", int, 0)
+
         CAPTURED_ERRORS = _readenv("NUMBA_CAPTURED_ERRORS",
                                    _validate_captured_errors_style,
                                    'old_style')
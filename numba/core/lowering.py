@@ -49,6 +49,10 @@ class BaseLower(object):
         self.varmap = {}
         self.firstblk = min(self.blocks.keys())
         self.loc = -1
+        # Site name for the NRT allocation profiler, see pre_lower()
+        self.nrt_profile_site = None
+        # (function, previous site) to restore on exit, see pre_lower()
+        self.nrt_profile_exits = []
 
         # Specializes the target context as seen inside the Lowerer
         # This adds:
@@ -120,6 +124,34 @@ class BaseLower(object):
                                        argnames=self.fndesc.args,
                                        argtypes=self.fndesc.argtypes,
                                        line=self.defn_loc.line)
+        # Attribute the NRT allocations made by this function for the NRT
+        # allocation profiler, until it returns.  Numba's own implementation
+        # functions are left out, so that their allocations are attributed to
+        # the caller.
+        self.nrt_profile_site = None
+        if config.NRT_PROFILE and self.context.enable_nrt:
+            modname = self.fndesc.modname or ''
+            if not modname.startswith('numba.'):
+                self.nrt_profile_site = "%s (%s:%s)" % (
+                    self.fndesc.qualname, self.defn_loc.filename,
+                    self.defn_loc.line)
+                prev = self.context.nrt.profile_site(self.builder,
+                                                     self.nrt_profile_site)
+                self.nrt_profile_exits.append((self.function, prev))
+
+    def restore_nrt_profile_sites(self):
+        """
+        Restore the NRT allocation profiler site of the caller before every
+        return of the functions instrumented by pre_lower().  This runs once
+        all of them are complete, as generators add exits after post_lower().
+        """
+        for function, prev in self.nrt_profile_exits:
+            for bb in function.blocks:
+                if isinstance(bb.terminator, llvmlite.ir.instructions.Ret):
+                    builder = IRBuilder(bb)
+                    builder.position_before(bb.terminator)
+                    self.context.nrt.profile_restore_site(builder, prev)
+        self.nrt_profile_exits = []
 
     def post_lower(self):
         """
@@ -174,6 +206,7 @@ class BaseLower(object):
             self.genlower.lower_next_func(self)
             if self.gentype.has_finalizer:
                 self.genlower.lower_finalize_func(self)
+        self.restore_nrt_profile_sites()
 
         if config.DUMP_LLVM:
             print(("LLVM DUMP %s" % self.fndesc).center(80, '-'))
@@ -1 +1 @@
-from .nrt import rtsys
+from .nrt import rtsys, nrt_arena
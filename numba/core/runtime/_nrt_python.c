@@ -334,6 +334,8 @@ NRT_adapt_ndarray_to_python_acqref(arystruct_t* arystruct, PyTypeObject *retty,
 {
     PyArrayObject *array;
     MemInfoObject *miobj = NULL;
+    NRT_MemInfo *meminfo;
+    void *data = arystruct->data;
     PyObject *args;
     npy_intp *shape, *strides;
     int flags = 0;
@@ -359,17 +361,30 @@ NRT_adapt_ndarray_to_python_acqref(arystruct_t* arystruct, PyTypeObject *retty,
     }
 
     if (arystruct->meminfo) {
+        /* An array carved out of an arena is copied out of it, so that it
+           does not keep the whole arena chunk alive from Python, unless it
+           is still referenced elsewhere: it then pins its chunk, so that
+           both sides keep sharing the data.  The copy comes with the
+           reference the MemInfoObject steals. */
+        meminfo = NRT_Arena_promote(arystruct->meminfo);
+        if (meminfo != NULL) {
+            data = (char *)NRT_MemInfo_data(meminfo) +
+                ((char *)arystruct->data -
+                 (char *)NRT_MemInfo_data(arystruct->meminfo));
+        } else {
+            meminfo = arystruct->meminfo;
+            NRT_MemInfo_acquire(meminfo);
+        }
         /* wrap into MemInfoObject */
         miobj = PyObject_New(MemInfoObject, &MemInfoType);
         args = PyTuple_New(1);
         /* SETITEM steals reference */
-        PyTuple_SET_ITEM(args, 0, PyLong_FromVoidPtr(arystruct->meminfo));
+        PyTuple_SET_ITEM(args, 0, PyLong_FromVoidPtr(meminfo));
         NRT_Debug(nrt_debug_print("NRT_adapt_ndarray_to_python arystruct->meminfo=%p\n", arystruct->meminfo));
         /*  Note: MemInfo_init() does not incref.  This function steals the
-         *        NRT reference, which we need to acquire.
+         *        NRT reference, which was acquired above.
          */
         NRT_Debug(nrt_debug_print("NRT_adapt_ndarray_to_python_acqref created MemInfo=%p\n", miobj));
-        NRT_MemInfo_acquire(arystruct->meminfo);
         if (MemInfo_init(miobj, args, NULL)) {
             NRT_Debug(nrt_debug_print("MemInfo_init failed.\n"));
             return NULL;
@@ -381,7 +396,7 @@ NRT_adapt_ndarray_to_python_acqref(arystruct_t* arystruct, PyTypeObject *retty,
     strides = shape + ndim;
     Py_INCREF((PyObject *) descr);
     array = (PyArrayObject *) PyArray_NewFromDescr(retty, descr, ndim,
-                                                   shape, strides, arystruct->data,
+                                                   shape, strides, data,
                                                    flags, (PyObject *) miobj);
 
     if (array == NULL)
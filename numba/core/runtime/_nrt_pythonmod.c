@@ -17,6 +17,74 @@ memsys_use_cpython_allocator(PyObject *self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
+static PyObject *
+memsys_set_slab_allocator(PyObject *self, PyObject *args) {
+    Py_ssize_t max_size;
+    if (!PyArg_ParseTuple(args, "n", &max_size)) {
+        return NULL;
+    }
+    if (max_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "max_size must be non-negative");
+        return NULL;
+    }
+    if (NRT_MemSys_set_slab_allocator((size_t)max_size)) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "cannot change the slab allocator while NRT blocks "
+                        "are allocated");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+memsys_set_large_alloc_policy(PyObject *self, PyObject *args) {
+    Py_ssize_t threshold;
+    int hugepages, interleave;
+    if (!PyArg_ParseTuple(args, "npp", &threshold, &hugepages, &interleave)) {
+        return NULL;
+    }
+    if (threshold < 0) {
+        PyErr_SetString(PyExc_ValueError, "threshold must be non-negative");
+        return NULL;
+    }
+    if (NRT_MemSys_set_large_alloc_policy(
+            (size_t)threshold,
+            (hugepages ? NRT_LARGE_HUGEPAGES : 0) |
+            (interleave ? NRT_LARGE_INTERLEAVE : 0))) {
+        PyErr_SetString(PyExc_NotImplementedError,
+                        "large allocation policy is not supported on this "
+                        "platform");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+memsys_get_slab_stats(PyObject *self, PyObject *args) {
+    NRT_SlabStats stats[NRT_SLAB_NUM_CLASSES];
+    size_t i, n;
+    PyObject *out;
+
+    n = NRT_MemSys_get_slab_stats(stats, NRT_SLAB_NUM_CLASSES);
+    out = PyList_New(n);
+    if (out == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; ++i) {
+        PyObject *item = Py_BuildValue("(nnnn)",
+                                       (Py_ssize_t) stats[i].block_size,
+                                       (Py_ssize_t) stats[i].alloc,
+                                       (Py_ssize_t) stats[i].free,
+                                       (Py_ssize_t) stats[i].chunks);
+        if (item == NULL) {
+            Py_DECREF(out);
+            return NULL;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+    return out;
+}
+
 static PyObject *
 memsys_set_atomic_inc_dec(PyObject *self, PyObject *args) {
     PyObject *addr_inc_obj, *addr_dec_obj;
@@ -66,6 +134,178 @@ memsys_get_stats_mi_free(PyObject *self, PyObject *args) {
 }
 
 
+static PyObject *
+arena_new(PyObject *self, PyObject *args) {
+    Py_ssize_t chunk_size;
+    NRT_Arena *arena;
+    if (!PyArg_ParseTuple(args, "n", &chunk_size)) {
+        return NULL;
+    }
+    if (chunk_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk_size must be positive");
+        return NULL;
+    }
+    arena = NRT_Arena_new((size_t)chunk_size);
+    if (arena == NULL) {
+        return PyErr_NoMemory();
+    }
+    return PyLong_FromVoidPtr(arena);
+}
+
+static PyObject *
+arena_push(PyObject *self, PyObject *args) {
+    PyObject *arena_obj;
+    void *arena;
+    if (!PyArg_ParseTuple(args, "O", &arena_obj)) {
+        return NULL;
+    }
+    arena = PyLong_AsVoidPtr(arena_obj);
+    if (PyErr_Occurred())
+        return NULL;
+    NRT_Arena_push((NRT_Arena *)arena);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+arena_pop(PyObject *self, PyObject *args) {
+    return PyLong_FromVoidPtr(NRT_Arena_pop());
+}
+
+static PyObject *
+arena_get_stats(PyObject *self, PyObject *args) {
+    PyObject *arena_obj;
+    void *arena;
+    NRT_ArenaStats stats;
+    if (!PyArg_ParseTuple(args, "O", &arena_obj)) {
+        return NULL;
+    }
+    arena = PyLong_AsVoidPtr(arena_obj);
+    if (PyErr_Occurred())
+        return NULL;
+    NRT_Arena_get_stats((NRT_Arena *)arena, &stats);
+    return Py_BuildValue("(nnn)", (Py_ssize_t) stats.alloc,
+                         (Py_ssize_t) stats.bytes,
+                         (Py_ssize_t) stats.chunks);
+}
+
+static PyObject *
+arena_get_live_chunks(PyObject *self, PyObject *args) {
+    return PyLong_FromSize_t(NRT_Arena_get_live_chunks());
+}
+
+static PyObject *
+arena_free(PyObject *self, PyObject *args) {
+    PyObject *arena_obj;
+    void *arena;
+    if (!PyArg_ParseTuple(args, "O", &arena_obj)) {
+        return NULL;
+    }
+    arena = PyLong_AsVoidPtr(arena_obj);
+    if (PyErr_Occurred())
+        return NULL;
+    NRT_Arena_free((NRT_Arena *)arena);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+profile_start(PyObject *self, PyObject *args) {
+    Py_ssize_t sample_interval;
+    if (!PyArg_ParseTuple(args, "n", &sample_interval)) {
+        return NULL;
+    }
+    if (sample_interval < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "sample_interval must be non-negative");
+        return NULL;
+    }
+    NRT_Profile_start((size_t)sample_interval);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+profile_stop(PyObject *self, PyObject *args) {
+    NRT_Profile_stop();
+    Py_RETURN_NONE;
+}
+
+/*
+ * Returns a list of (name, alloc, alloc_bytes, free, free_bytes, lifetime)
+ */
+static PyObject *
+profile_get_sites(PyObject *self, PyObject *args) {
+    NRT_ProfileSite *sites;
+    size_t i, n, navail;
+    PyObject *out = NULL;
+
+    n = NRT_Profile_get_sites(NULL, 0);
+    sites = PyMem_Malloc((n + 1) * sizeof(NRT_ProfileSite));
+    if (sites == NULL) {
+        return PyErr_NoMemory();
+    }
+    /* Sites added meanwhile are ignored */
+    navail = NRT_Profile_get_sites(sites, n);
+    if (navail < n) {
+        n = navail;
+    }
+    out = PyList_New(n);
+    if (out == NULL) {
+        goto error;
+    }
+    for (i = 0; i < n; ++i) {
+        PyObject *item = Py_BuildValue("(snnnnd)", sites[i].name,
+                                       (Py_ssize_t) sites[i].alloc,
+                                       (Py_ssize_t) sites[i].alloc_bytes,
+                                       (Py_ssize_t) sites[i].free,
+                                       (Py_ssize_t) sites[i].free_bytes,
+                                       sites[i].lifetime);
+        if (item == NULL) {
+            Py_CLEAR(out);
+            goto error;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+error:
+    PyMem_Free(sites);
+    return out;
+}
+
+/*
+ * Returns a list of (site, size, age) for the live sampled allocations
+ */
+static PyObject *
+profile_snapshot(PyObject *self, PyObject *args) {
+    NRT_ProfileAlloc *allocs;
+    size_t i, n, navail;
+    PyObject *out = NULL;
+
+    n = NRT_Profile_snapshot(NULL, 0);
+    allocs = PyMem_Malloc((n + 1) * sizeof(NRT_ProfileAlloc));
+    if (allocs == NULL) {
+        return PyErr_NoMemory();
+    }
+    navail = NRT_Profile_snapshot(allocs, n);
+    if (navail < n) {
+        n = navail;
+    }
+    out = PyList_New(n);
+    if (out == NULL) {
+        goto error;
+    }
+    for (i = 0; i < n; ++i) {
+        PyObject *item = Py_BuildValue("(snd)", allocs[i].site,
+                                       (Py_ssize_t) allocs[i].size,
+                                       allocs[i].age);
+        if (item == NULL) {
+            Py_CLEAR(out);
+            goto error;
+        }
+        PyList_SET_ITEM(out, i, item);
+    }
+error:
+    PyMem_Free(allocs);
+    return out;
+}
+
 /*
  * Create a new MemInfo with a owner PyObject
  */
@@ -119,12 +359,25 @@ static PyMethodDef ext_methods[] = {
 #define declmethod_noargs(func) { #func , ( PyCFunction )func , METH_NOARGS, NULL }
     declmethod_noargs(memsys_use_cpython_allocator),
     declmethod_noargs(memsys_shutdown),
+    declmethod(memsys_set_slab_allocator),
+    declmethod_noargs(memsys_get_slab_stats),
+    declmethod(memsys_set_large_alloc_policy),
     declmethod(memsys_set_atomic_inc_dec),
     declmethod(memsys_set_atomic_cas),
     declmethod_noargs(memsys_get_stats_alloc),
     declmethod_noargs(memsys_get_stats_free),
     declmethod_noargs(memsys_get_stats_mi_alloc),
     declmethod_noargs(memsys_get_stats_mi_free),
+    declmethod(arena_new),
+    declmethod(arena_push),
+    declmethod_noargs(arena_pop),
+    declmethod(arena_get_stats),
+    declmethod_noargs(arena_get_live_chunks),
+    declmethod(arena_free),
+    declmethod(profile_start),
+    declmethod_noargs(profile_stop),
+    declmethod_noargs(profile_get_sites),
+    declmethod_noargs(profile_snapshot),
     declmethod(meminfo_new),
     declmethod(meminfo_alloc),
     declmethod(meminfo_alloc_safe),
@@ -179,6 +432,7 @@ declmethod(MemInfo_release);
 declmethod(Allocate);
 declmethod(Free);
 declmethod(get_api);
+declmethod(Profile_set_site);
 
 
 #undef declmethod
@@ -203,6 +457,7 @@ MOD_INIT(_nrt_python) {
     PyModule_AddObject(m, "_MemInfo", (PyObject *) (&MemInfoType));
 
     PyModule_AddObject(m, "c_helpers", build_c_helpers_dict());
+    PyModule_AddIntConstant(m, "STATS_ENABLED", NRT_ENABLE_STATS);
 
     return MOD_SUCCESS_VAL(m);
 }
@@ -324,6 +324,28 @@ class NRTContext(object):
         fn.return_value.add_attribute("noalias")
         return builder.call(fn, [meminfo, size])
 
+    def profile_site(self, builder, name):
+        """
+        Attribute the following NRT MemInfo allocations made by the current
+        thread to the site *name* (a str), for the NRT allocation profiler.
+        Returns the previous site, to be passed to profile_restore_site().
+        """
+        mod = builder.module
+        site = self._context.insert_const_string(mod, name)
+        return self.profile_restore_site(builder, site)
+
+    def profile_restore_site(self, builder, site):
+        """
+        Make *site*, as returned by profile_site(), the current site of the
+        NRT allocation profiler again.
+        """
+        self._require_nrt()
+
+        mod = builder.module
+        fnty = ir.FunctionType(cgutils.voidptr_t, [cgutils.voidptr_t])
+        fn = cgutils.get_or_insert_function(mod, fnty, "NRT_Profile_set_site")
+        return builder.call(fn, [site])
+
     def meminfo_data(self, builder, meminfo):
         """
         Given a MemInfo pointer, return a pointer to the allocated data
@@ -1,8 +1,40 @@
 #include <stdarg.h>
 #include <string.h> /* for memset */
+#include <stddef.h> /* for offsetof */
+#include <stdint.h>
 #include "nrt.h"
 #include "assert.h"
 
+#ifdef _MSC_VER
+#include <windows.h>
+#define THREAD_LOCAL(ty) __declspec(thread) ty
+#define NRT_CACHE_ALIGNED __declspec(align(64))
+typedef SRWLOCK nrt_lock_t;
+#define NRT_LOCK_INIT SRWLOCK_INIT
+#define nrt_lock_acquire(l) AcquireSRWLockExclusive(l)
+#define nrt_lock_release(l) ReleaseSRWLockExclusive(l)
+#else
+#include <pthread.h>
+#include <time.h>
+/* Non-standard C99 extension that's understood by gcc and clang */
+#define THREAD_LOCAL(ty) __thread ty
+#define NRT_CACHE_ALIGNED __attribute__((aligned(64)))
+typedef pthread_mutex_t nrt_lock_t;
+#define NRT_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+#define nrt_lock_acquire(l) pthread_mutex_lock(l)
+#define nrt_lock_release(l) pthread_mutex_unlock(l)
+#endif
+
+/* Page mapping for large allocations */
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define NRT_HAVE_MMAP 1
+#else
+#define NRT_HAVE_MMAP 0
+#endif
+
 
 typedef int (*atomic_meminfo_cas_func)(void **ptr, void *cmp,
                                        void *repl, void **oldptr);
@@ -38,6 +70,28 @@ static void nrt_fatal_error(const char *msg)
  * Global resources.
  */
 
+/*
+ * The allocation counters are sharded so that threads allocating
+ * concurrently do not all hit the same cache line.  Each thread is assigned
+ * a shard on first use and the NRT_MemSys_get_stats_*() functions sum them.
+ * Threads only share a shard once there are more than NRT_STATS_SHARDS of
+ * them, so the increments stay atomic.
+ */
+#define NRT_STATS_SHARDS 64
+
+typedef struct {
+    size_t alloc, free, mi_alloc, mi_free;
+    /* Per size class counters of the slab allocator */
+    size_t slab_alloc[NRT_SLAB_NUM_CLASSES];
+    size_t slab_free[NRT_SLAB_NUM_CLASSES];
+} nrt_stats_counters;
+
+/* Start on a cache line and span a whole number of them */
+typedef union NRT_CACHE_ALIGNED {
+    nrt_stats_counters c;
+    char _pad[(sizeof(nrt_stats_counters) + 63) / 64 * 64];
+} nrt_stats_shard;
+
 struct MemSys {
     /* Atomic increment and decrement function */
     NRT_atomic_inc_dec_func atomic_inc, atomic_dec;
@@ -45,8 +99,14 @@ struct MemSys {
     atomic_meminfo_cas_func atomic_cas;
     /* Shutdown flag */
     int shutting;
+#if NRT_ENABLE_STATS
     /* Stats */
-    size_t stats_alloc, stats_free, stats_mi_alloc, stats_mi_free;
+    size_t stats_next_shard;
+    nrt_stats_shard stats[NRT_STATS_SHARDS];
+#else
+    /* Set once anything has been allocated */
+    int allocated;
+#endif
     /* System allocation functions */
     struct {
         NRT_malloc_func malloc;
@@ -58,6 +118,57 @@ struct MemSys {
 /* The Memory System object */
 static NRT_MemSys TheMSys;
 
+#if NRT_ENABLE_STATS
+
+static THREAD_LOCAL(nrt_stats_counters *) nrt_stats_tshard;
+
+static nrt_stats_counters *
+nrt_stats_get_shard(void) {
+    nrt_stats_counters *shard = nrt_stats_tshard;
+    if (shard == NULL) {
+        size_t index = TheMSys.atomic_inc(&TheMSys.stats_next_shard);
+        shard = &TheMSys.stats[index % NRT_STATS_SHARDS].c;
+        nrt_stats_tshard = shard;
+    }
+    return shard;
+}
+
+#define NRT_STATS_INC(field) TheMSys.atomic_inc(&nrt_stats_get_shard()->field)
+
+/* Sum the counter at `offset` in nrt_stats_counters over all the shards */
+static size_t
+nrt_stats_sum(size_t offset) {
+    size_t i, total = 0;
+    for (i = 0; i < NRT_STATS_SHARDS; ++i) {
+        total += *(size_t *)((char *)&TheMSys.stats[i].c + offset);
+    }
+    return total;
+}
+
+#define NRT_STATS_SUM(field) \
+    nrt_stats_sum(offsetof(nrt_stats_counters, field))
+
+#else
+
+#define NRT_STATS_INC(field) ((void)0)
+#define NRT_STATS_SUM(field) ((size_t)0)
+
+#endif  /* NRT_ENABLE_STATS */
+
+/*
+ * Whether any block allocated by NRT may still be alive.
+ */
+static int
+nrt_has_live_blocks(void) {
+#if NRT_ENABLE_STATS
+    return (NRT_MemSys_get_stats_alloc() != NRT_MemSys_get_stats_free() ||
+            NRT_MemSys_get_stats_mi_alloc() != NRT_MemSys_get_stats_mi_free());
+#else
+    /* Without statistics, anything ever allocated may still be alive */
+    return TheMSys.allocated;
+#endif
+}
+
 
 void NRT_MemSys_init(void) {
     memset(&TheMSys, 0, sizeof(NRT_MemSys));
@@ -77,16 +188,20 @@ void NRT_MemSys_shutdown(void) {
     NRT_MemSys_set_atomic_cas_stub();
 }
 
+static void nrt_slab_release_chunks(void);
+
 void NRT_MemSys_set_allocator(NRT_malloc_func malloc_func,
                               NRT_realloc_func realloc_func,
                               NRT_free_func free_func)
 {
-    if ((malloc_func != TheMSys.allocator.malloc ||
-         realloc_func != TheMSys.allocator.realloc ||
-         free_func != TheMSys.allocator.free) &&
-         (TheMSys.stats_alloc != TheMSys.stats_free ||
-          TheMSys.stats_mi_alloc != TheMSys.stats_mi_free)) {
-        nrt_fatal_error("cannot change allocator while blocks are allocated");
+    if (malloc_func != TheMSys.allocator.malloc ||
+        realloc_func != TheMSys.allocator.realloc ||
+        free_func != TheMSys.allocator.free) {
+        if (nrt_has_live_blocks()) {
+            nrt_fatal_error("cannot change allocator while blocks are allocated");
+        }
+        /* Slab chunks must go back to the allocator they came from */
+        nrt_slab_release_chunks();
     }
     TheMSys.allocator.malloc = malloc_func;
     TheMSys.allocator.realloc = realloc_func;
@@ -105,19 +220,19 @@ void NRT_MemSys_set_atomic_cas(NRT_atomic_cas_func cas) {
 }
 
 size_t NRT_MemSys_get_stats_alloc() {
-    return TheMSys.stats_alloc;
+    return NRT_STATS_SUM(alloc);
 }
 
 size_t NRT_MemSys_get_stats_free() {
-    return TheMSys.stats_free;
+    return NRT_STATS_SUM(free);
 }
 
 size_t NRT_MemSys_get_stats_mi_alloc() {
-    return TheMSys.stats_mi_alloc;
+    return NRT_STATS_SUM(mi_alloc);
 }
 
 size_t NRT_MemSys_get_stats_mi_free() {
-    return TheMSys.stats_mi_free;
+    return NRT_STATS_SUM(mi_free);
 }
 
 static
@@ -162,6 +277,1161 @@ void NRT_MemSys_set_atomic_cas_stub(void) {
 }
 
 
+/*
+ * Thread-caching slab allocator.
+ *
+ * An optional front-end to the system allocator for small blocks.  Requests
+ * up to `max_size` bytes are rounded up to a power-of-two size class and
+ * served from a per-thread free list, so the common case takes no lock and
+ * never reaches malloc().  Empty free lists are refilled from a shared depot
+ * of returned blocks or, failing that, by carving a new slab chunk obtained
+ * from the system allocator.  A thread whose cache overflows hands half of
+ * it back to the depot.  Larger requests go straight to the system
+ * allocator.
+ *
+ * Every block is preceded by a header recording its size class, so that
+ * NRT_Free() and NRT_Reallocate() can route it without any lookup.  Slab
+ * chunks are only returned to the system when the slab allocator is
+ * reconfigured, which is only allowed while no NRT block is alive.
+ *
+ * The cache of a thread is handed back to the depot when the thread exits,
+ * through a thread-specific key destructor (a fiber local storage callback
+ * on Windows), so that short-lived threads do not strand their blocks.
+ */
+
+#define NRT_SLAB_MIN_SHIFT      4       /* smallest class: 16 bytes */
+#define NRT_SLAB_CHUNK_SIZE     (256 * 1024)
+#define NRT_SLAB_CACHE_MAX      256     /* blocks per class per thread */
+#define NRT_SLAB_LARGE          ((size_t)-1)
+
+typedef struct {
+    size_t size_class;  /* index into the size classes or NRT_SLAB_LARGE */
+    size_t capacity;    /* usable bytes after the header */
+} nrt_slab_header;
+
+typedef struct nrt_slab_chunk {
+    struct nrt_slab_chunk *next;
+    size_t _pad;        /* keep the carved blocks aligned like the header */
+} nrt_slab_chunk;
+
+typedef struct {
+    size_t generation;
+    int exit_registered;    /* the thread exit hook knows the cache */
+    nrt_slab_header *head[NRT_SLAB_NUM_CLASSES];
+    size_t count[NRT_SLAB_NUM_CLASSES];
+} nrt_slab_cache;
+
+static struct {
+    int enabled;
+    size_t max_size;
+    /* Bumped whenever the chunks are released, so that stale per-thread
+       caches are dropped on their next use. */
+    size_t generation;
+    nrt_lock_t lock;
+    /* The following are protected by `lock` */
+    nrt_slab_chunk *chunks;
+    nrt_slab_header *depot[NRT_SLAB_NUM_CLASSES];
+    size_t depot_count[NRT_SLAB_NUM_CLASSES];
+    /* Stats, the alloc and free counts live in the sharded counters */
+    NRT_SlabStats stats[NRT_SLAB_NUM_CLASSES];
+} TheSlab = { 0, 0, 0, NRT_LOCK_INIT };
+
+static THREAD_LOCAL(nrt_slab_cache) nrt_slab_tcache;
+
+/* Key whose destructor drains the cache of an exiting thread */
+#ifdef _MSC_VER
+static DWORD nrt_slab_exit_key = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t nrt_slab_exit_key;
+static int nrt_slab_exit_key_created = 0;
+#endif
+
+/* The free list link lives in the payload, right after the header */
+#define NRT_SLAB_NEXT(hdr) (*(nrt_slab_header **)((hdr) + 1))
+
+static size_t
+nrt_slab_block_size(size_t size_class) {
+    return (size_t)1 << (size_class + NRT_SLAB_MIN_SHIFT);
+}
+
+static size_t
+nrt_slab_size_class(size_t size) {
+    size_t size_class = 0;
+    while (nrt_slab_block_size(size_class) < size) {
+        size_class++;
+    }
+    return size_class;
+}
+
+/*
+ * Hand all the blocks of `cache` back to the depot.
+ */
+static void
+nrt_slab_flush_cache(nrt_slab_cache *cache) {
+    size_t i;
+
+    nrt_lock_acquire(&TheSlab.lock);
+    /* The blocks of a previous configuration are gone */
+    if (cache->generation == TheSlab.generation) {
+        for (i = 0; i < NRT_SLAB_NUM_CLASSES; ++i) {
+            nrt_slab_header *tail = cache->head[i];
+            if (tail == NULL) {
+                continue;
+            }
+            while (NRT_SLAB_NEXT(tail) != NULL) {
+                tail = NRT_SLAB_NEXT(tail);
+            }
+            NRT_SLAB_NEXT(tail) = TheSlab.depot[i];
+            TheSlab.depot[i] = cache->head[i];
+            TheSlab.depot_count[i] += cache->count[i];
+        }
+    }
+    nrt_lock_release(&TheSlab.lock);
+    memset(cache, 0, sizeof(nrt_slab_cache));
+}
+
+#ifdef _MSC_VER
+static void WINAPI
+nrt_slab_thread_exit(void *cache) {
+#else
+static void
+nrt_slab_thread_exit(void *cache) {
+#endif
+    if (cache != NULL) {
+        nrt_slab_flush_cache((nrt_slab_cache *)cache);
+    }
+}
+
+/*
+ * Create the thread exit key, once, when the slab allocator is enabled.
+ */
+static void
+nrt_slab_create_exit_key(void) {
+#ifdef _MSC_VER
+    if (nrt_slab_exit_key == FLS_OUT_OF_INDEXES) {
+        nrt_slab_exit_key = FlsAlloc(nrt_slab_thread_exit);
+    }
+#else
+    if (!nrt_slab_exit_key_created) {
+        nrt_slab_exit_key_created =
+            pthread_key_create(&nrt_slab_exit_key, nrt_slab_thread_exit) == 0;
+    }
+#endif
+}
+
+/*
+ * Arrange for `cache` to be drained when the calling thread exits.
+ */
+static void
+nrt_slab_register_exit(nrt_slab_cache *cache) {
+#ifdef _MSC_VER
+    if (nrt_slab_exit_key != FLS_OUT_OF_INDEXES) {
+        FlsSetValue(nrt_slab_exit_key, cache);
+    }
+#else
+    if (nrt_slab_exit_key_created) {
+        pthread_setspecific(nrt_slab_exit_key, cache);
+    }
+#endif
+    cache->exit_registered = 1;
+}
+
+static nrt_slab_cache *
+nrt_slab_get_cache(void) {
+    nrt_slab_cache *cache = &nrt_slab_tcache;
+    if (cache->generation != TheSlab.generation) {
+        /* The blocks of a previous configuration are gone */
+        memset(cache, 0, sizeof(nrt_slab_cache));
+        cache->generation = TheSlab.generation;
+    }
+    if (!cache->exit_registered) {
+        nrt_slab_register_exit(cache);
+    }
+    return cache;
+}
+
+/*
+ * Fill the empty free list of `size_class` in `cache`.
+ * Returns 0 on success, -1 if the system allocator failed.
+ */
+static int
+nrt_slab_refill(nrt_slab_cache *cache, size_t size_class) {
+    size_t block_size = nrt_slab_block_size(size_class);
+    size_t stride = sizeof(nrt_slab_header) + block_size;
+    size_t nblocks, i;
+    nrt_slab_chunk *chunk;
+    char *p;
+
+    nrt_lock_acquire(&TheSlab.lock);
+    if (TheSlab.depot[size_class] != NULL) {
+        /* Take back up to half a cache worth of returned blocks */
+        nrt_slab_header *head = TheSlab.depot[size_class];
+        nrt_slab_header *tail = head;
+        size_t n = 1;
+        while (n < NRT_SLAB_CACHE_MAX / 2 && NRT_SLAB_NEXT(tail) != NULL) {
+            tail = NRT_SLAB_NEXT(tail);
+            n++;
+        }
+        TheSlab.depot[size_class] = NRT_SLAB_NEXT(tail);
+        TheSlab.depot_count[size_class] -= n;
+        nrt_lock_release(&TheSlab.lock);
+        NRT_SLAB_NEXT(tail) = NULL;
+        cache->head[size_class] = head;
+        cache->count[size_class] = n;
+        return 0;
+    }
+
+    nblocks = NRT_SLAB_CHUNK_SIZE / stride;
+    if (nblocks < 4) {
+        nblocks = 4;
+    }
+    chunk = TheMSys.allocator.malloc(sizeof(nrt_slab_chunk) + nblocks * stride);
+    if (chunk == NULL) {
+        nrt_lock_release(&TheSlab.lock);
+        return -1;
+    }
+    chunk->next = TheSlab.chunks;
+    TheSlab.chunks = chunk;
+    TheSlab.stats[size_class].chunks++;
+    nrt_lock_release(&TheSlab.lock);
+
+    NRT_Debug(nrt_debug_print("nrt_slab_refill class=%zu chunk=%p blocks=%zu\n",
+                              size_class, chunk, nblocks));
+    /* Carve the chunk into a free list, lowest address first */
+    p = (char *)(chunk + 1);
+    for (i = 0; i < nblocks; ++i, p += stride) {
+        nrt_slab_header *hdr = (nrt_slab_header *)p;
+        hdr->size_class = size_class;
+        hdr->capacity = block_size;
+        NRT_SLAB_NEXT(hdr) = (i + 1 < nblocks)
+                             ? (nrt_slab_header *)(p + stride) : NULL;
+    }
+    cache->head[size_class] = (nrt_slab_header *)(chunk + 1);
+    cache->count[size_class] = nblocks;
+    return 0;
+}
+
+/*
+ * Hand the older half of an overflowing free list back to the depot.
+ */
+static void
+nrt_slab_spill(nrt_slab_cache *cache, size_t size_class) {
+    size_t keep = NRT_SLAB_CACHE_MAX / 2;
+    size_t i;
+    nrt_slab_header *last = cache->head[size_class];
+    nrt_slab_header *head, *tail;
+    for (i = 1; i < keep; ++i) {
+        last = NRT_SLAB_NEXT(last);
+    }
+    head = NRT_SLAB_NEXT(last);
+    NRT_SLAB_NEXT(last) = NULL;
+    for (tail = head; NRT_SLAB_NEXT(tail) != NULL; tail = NRT_SLAB_NEXT(tail))
+        ;
+
+    nrt_lock_acquire(&TheSlab.lock);
+    NRT_SLAB_NEXT(tail) = TheSlab.depot[size_class];
+    TheSlab.depot[size_class] = head;
+    TheSlab.depot_count[size_class] += cache->count[size_class] - keep;
+    nrt_lock_release(&TheSlab.lock);
+    cache->count[size_class] = keep;
+}
+
+static void *
+nrt_slab_malloc(size_t size) {
+    nrt_slab_header *hdr;
+    nrt_slab_cache *cache;
+    size_t size_class;
+
+    if (size > TheSlab.max_size) {
+        hdr = TheMSys.allocator.malloc(sizeof(nrt_slab_header) + size);
+        if (hdr == NULL) {
+            return NULL;
+        }
+        hdr->size_class = NRT_SLAB_LARGE;
+        hdr->capacity = size;
+        return hdr + 1;
+    }
+    size_class = nrt_slab_size_class(size);
+    cache = nrt_slab_get_cache();
+    if (cache->head[size_class] == NULL && nrt_slab_refill(cache, size_class)) {
+        return NULL;
+    }
+    hdr = cache->head[size_class];
+    cache->head[size_class] = NRT_SLAB_NEXT(hdr);
+    cache->count[size_class]--;
+    NRT_STATS_INC(slab_alloc[size_class]);
+    return hdr + 1;
+}
+
+static void
+nrt_slab_free(void *ptr) {
+    nrt_slab_header *hdr;
+    nrt_slab_cache *cache;
+    size_t size_class;
+
+    if (ptr == NULL) {
+        return;
+    }
+    hdr = (nrt_slab_header *)ptr - 1;
+    size_class = hdr->size_class;
+    if (size_class == NRT_SLAB_LARGE) {
+        TheMSys.allocator.free(hdr);
+        return;
+    }
+    NRT_STATS_INC(slab_free[size_class]);
+    cache = nrt_slab_get_cache();
+    NRT_SLAB_NEXT(hdr) = cache->head[size_class];
+    cache->head[size_class] = hdr;
+    if (++cache->count[size_class] > NRT_SLAB_CACHE_MAX) {
+        nrt_slab_spill(cache, size_class);
+    }
+}
+
+static void *
+nrt_slab_realloc(void *ptr, size_t size) {
+    nrt_slab_header *hdr;
+    void *new_ptr;
+
+    if (ptr == NULL) {
+        return nrt_slab_malloc(size);
+    }
+    hdr = (nrt_slab_header *)ptr - 1;
+    if (hdr->size_class == NRT_SLAB_LARGE) {
+        if (size > TheSlab.max_size) {
+            /* Stays large: let the system allocator move it */
+            hdr = TheMSys.allocator.realloc(hdr, sizeof(nrt_slab_header) + size);
+            if (hdr == NULL) {
+                return NULL;
+            }
+            hdr->capacity = size;
+            return hdr + 1;
+        }
+    } else if (size <= hdr->capacity &&
+               (hdr->size_class == 0 || size > hdr->capacity / 2)) {
+        /* Still the right size class */
+        return ptr;
+    }
+    new_ptr = nrt_slab_malloc(size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, size < hdr->capacity ? size : hdr->capacity);
+    nrt_slab_free(ptr);
+    return new_ptr;
+}
+
+/*
+ * Return all the slab chunks to the system allocator.
+ * Must only be called while no slab block is alive.
+ */
+static void
+nrt_slab_release_chunks(void) {
+    nrt_slab_chunk *chunk, *next;
+    size_t i;
+
+    nrt_lock_acquire(&TheSlab.lock);
+    for (chunk = TheSlab.chunks; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        TheMSys.allocator.free(chunk);
+    }
+    TheSlab.chunks = NULL;
+    for (i = 0; i < NRT_SLAB_NUM_CLASSES; ++i) {
+        TheSlab.depot[i] = NULL;
+        TheSlab.depot_count[i] = 0;
+    }
+    TheSlab.generation++;
+    nrt_lock_release(&TheSlab.lock);
+}
+
+int NRT_MemSys_set_slab_allocator(size_t max_size) {
+    size_t i;
+
+    if (max_size > nrt_slab_block_size(NRT_SLAB_NUM_CLASSES - 1)) {
+        max_size = nrt_slab_block_size(NRT_SLAB_NUM_CLASSES - 1);
+    }
+    if ((max_size != 0) == TheSlab.enabled && max_size == TheSlab.max_size) {
+        return 0;
+    }
+    if (nrt_has_live_blocks()) {
+        /* Live blocks may carry (or lack) a slab header */
+        return -1;
+    }
+    nrt_slab_release_chunks();
+    if (max_size != 0) {
+        nrt_slab_create_exit_key();
+    }
+    TheSlab.enabled = max_size != 0;
+    TheSlab.max_size = max_size;
+    for (i = 0; i < NRT_SLAB_NUM_CLASSES; ++i) {
+        TheSlab.stats[i].block_size = nrt_slab_block_size(i);
+        TheSlab.stats[i].chunks = 0;
+    }
+#if NRT_ENABLE_STATS
+    for (i = 0; i < NRT_STATS_SHARDS; ++i) {
+        nrt_stats_counters *shard = &TheMSys.stats[i].c;
+        memset(shard->slab_alloc, 0, sizeof(shard->slab_alloc));
+        memset(shard->slab_free, 0, sizeof(shard->slab_free));
+    }
+#endif
+    return 0;
+}
+
+size_t NRT_MemSys_get_slab_stats(NRT_SlabStats *out, size_t n) {
+    size_t i, nclasses;
+    if (!TheSlab.enabled) {
+        return 0;
+    }
+    /* Only report the classes that can actually be used */
+    nclasses = nrt_slab_size_class(TheSlab.max_size) + 1;
+    for (i = 0; i < n && i < nclasses; ++i) {
+        out[i] = TheSlab.stats[i];
+#if NRT_ENABLE_STATS
+        out[i].alloc = nrt_stats_sum(offsetof(nrt_stats_counters, slab_alloc)
+                                     + i * sizeof(size_t));
+        out[i].free = nrt_stats_sum(offsetof(nrt_stats_counters, slab_free)
+                                    + i * sizeof(size_t));
+#endif
+    }
+    return i;
+}
+
+
+/*
+ * Arena allocation.
+ *
+ * While an arena is pushed on a thread, the MemInfo allocation functions
+ * called on that thread (NRT_MemInfo_alloc*) carve the MemInfo and its data
+ * out of the arena's current chunk by bumping a pointer, through the
+ * `nrt_arena_allocator` external allocator.  Freeing a block only drops the
+ * live count of its chunk; a chunk goes back to the system allocator in one
+ * go once it is no longer bumped from and all its blocks are dead, and is
+ * rewound in place when all its blocks die while it is still current.
+ *
+ * A block escaping to Python (an array returned out of the jitted code) would
+ * keep its whole chunk alive, so the boxing of arrays copies plain data
+ * blocks out of the arena with NRT_Arena_promote(), when the boxing holds
+ * the only reference to the block.  A block still referenced elsewhere, e.g.
+ * by an array stored in a typed container or by another view being boxed,
+ * can't be copied without breaking the aliasing between the two sides, so
+ * the boxed array pins its chunk until it is released.
+ */
+
+typedef struct {
+    size_t live;        /* live blocks, plus one while the arena bumps it */
+    size_t used;
+    size_t capacity;
+    size_t _pad;        /* keep the blocks 16-byte aligned */
+} nrt_arena_chunk;
+
+typedef struct {
+    nrt_arena_chunk *chunk;
+    size_t size;
+    size_t _pad[2];     /* keep the blocks 16-byte aligned */
+} nrt_arena_block;
+
+struct NRT_Arena {
+    NRT_Arena *prev;    /* the arena pushed before this one */
+    size_t chunk_size;
+    nrt_arena_chunk *current;
+    NRT_ArenaStats stats;
+};
+
+/* The innermost arena pushed on this thread */
+static THREAD_LOCAL(NRT_Arena *) nrt_current_arena;
+
+/* Chunks of all arenas not yet returned to the system */
+static size_t nrt_arena_live_chunks;
+
+#define NRT_ARENA_ROUND(n) (((n) + 15) & ~(size_t)15)
+
+static nrt_arena_chunk *
+nrt_arena_new_chunk(NRT_Arena *arena, size_t capacity, size_t live) {
+    nrt_arena_chunk *chunk;
+    chunk = TheMSys.allocator.malloc(sizeof(nrt_arena_chunk) + capacity);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->live = live;
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    arena->stats.chunks++;
+    TheMSys.atomic_inc(&nrt_arena_live_chunks);
+    return chunk;
+}
+
+static void
+nrt_arena_release_chunk(nrt_arena_chunk *chunk) {
+    if (TheMSys.atomic_dec(&chunk->live) == 0) {
+        NRT_Debug(nrt_debug_print("nrt_arena_release_chunk %p\n", chunk));
+        TheMSys.allocator.free(chunk);
+        TheMSys.atomic_dec(&nrt_arena_live_chunks);
+    }
+}
+
+static void *
+nrt_arena_malloc(size_t size, void *opaque_data) {
+    NRT_Arena *arena = nrt_current_arena;
+    nrt_arena_chunk *chunk;
+    nrt_arena_block *block;
+    size_t need = sizeof(nrt_arena_block) + NRT_ARENA_ROUND(size);
+
+    if (arena == NULL) {
+        return NULL;
+    }
+    if (need > arena->chunk_size / 4) {
+        /* Too large to share a chunk: give it one of its own */
+        chunk = nrt_arena_new_chunk(arena, need, 0);
+    } else {
+        chunk = arena->current;
+        if (chunk != NULL && chunk->live == 1) {
+            /* Every block died, reuse the chunk from the start.
+               Only this thread can raise the count, so this is safe. */
+            chunk->used = 0;
+        }
+        if (chunk == NULL || chunk->used + need > chunk->capacity) {
+            if (chunk != NULL) {
+                arena->current = NULL;
+                nrt_arena_release_chunk(chunk);
+            }
+            chunk = nrt_arena_new_chunk(arena, arena->chunk_size, 1);
+            arena->current = chunk;
+        }
+    }
+    if (chunk == NULL) {
+        return NULL;
+    }
+    block = (nrt_arena_block *)((char *)(chunk + 1) + chunk->used);
+    chunk->used += need;
+    TheMSys.atomic_inc(&chunk->live);
+    block->chunk = chunk;
+    block->size = size;
+    arena->stats.alloc++;
+    arena->stats.bytes += size;
+    return block + 1;
+}
+
+static void
+nrt_arena_free(void *ptr, void *opaque_data) {
+    nrt_arena_block *block = (nrt_arena_block *)ptr - 1;
+    nrt_arena_release_chunk(block->chunk);
+}
+
+static void *
+nrt_arena_realloc(void *ptr, size_t new_size, void *opaque_data) {
+    nrt_arena_block *block = (nrt_arena_block *)ptr - 1;
+    void *new_ptr = nrt_arena_malloc(new_size, opaque_data);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    memcpy(new_ptr, ptr, block->size < new_size ? block->size : new_size);
+    nrt_arena_free(ptr, opaque_data);
+    return new_ptr;
+}
+
+/* Shared by all arenas, as blocks may outlive the arena they came from */
+static NRT_ExternalAllocator nrt_arena_allocator = {
+    nrt_arena_malloc,
+    nrt_arena_realloc,
+    nrt_arena_free,
+    NULL
+};
+
+/*
+ * Large allocations.
+ *
+ * Above a size threshold, MemInfo allocations can bypass malloc and map
+ * their own pages, which allows asking for transparent huge pages (fewer
+ * TLB misses on multi-GB arrays) and spreading the pages over the NUMA
+ * nodes.  Without interleaving, the pages are left untouched so that they
+ * are placed on the node of the thread that first writes them, e.g. the
+ * worker owning a chunk of a parallel loop.
+ *
+ * So that initializing the MemInfo does not touch the first page of the
+ * data (placing it, a whole huge page, on the node of the allocating
+ * thread), the MemInfo lives in a separate header from the system allocator
+ * and the mapping only holds the data, which starts it.  The header records
+ * the mapping so that freeing the MemInfo can unmap it.
+ */
+
+#define NRT_HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+static struct {
+    size_t threshold;           /* 0 disables the large allocator */
+    int flags;                  /* NRT_LARGE_* */
+    unsigned long nodemask;     /* online NUMA nodes, for interleaving */
+} TheLargeAlloc;
+
+#if NRT_HAVE_MMAP
+
+typedef struct {
+    NRT_MemInfo mi;     /* must be first, NRT_dealloc() frees the MemInfo */
+    char *base;         /* the mapping, which starts with the data */
+    size_t length;
+    size_t size;        /* the data size */
+} nrt_large_header;
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+/* Parse /sys/devices/system/node/online, e.g. "0-1,3" */
+static unsigned long
+nrt_numa_online_nodes(void) {
+    unsigned long mask = 0;
+    char buf[256], *p;
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (f == NULL) {
+        return 0;
+    }
+    p = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    while (p != NULL && *p >= '0' && *p <= '9') {
+        unsigned long lo = strtoul(p, &p, 10), hi = lo;
+        if (*p == '-') {
+            hi = strtoul(p + 1, &p, 10);
+        }
+        for (; lo <= hi && lo < 8 * sizeof(unsigned long); ++lo) {
+            mask |= 1UL << lo;
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+    return mask;
+}
+
+/* Map at least `*length_out` bytes and set it to the mapped length */
+static char *
+nrt_large_map(size_t *length_out) {
+    size_t length = *length_out;
+    char *base;
+
+    if (TheLargeAlloc.flags & NRT_LARGE_HUGEPAGES) {
+        /* Map a huge page more and trim, so that the block is huge page
+           aligned */
+        size_t head, mapped;
+        length = (length + NRT_HUGE_PAGE_SIZE - 1) & ~(NRT_HUGE_PAGE_SIZE - 1);
+        mapped = length + NRT_HUGE_PAGE_SIZE;
+        base = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return NULL;
+        }
+        head = (NRT_HUGE_PAGE_SIZE - ((uintptr_t) base & (NRT_HUGE_PAGE_SIZE - 1)))
+               & (NRT_HUGE_PAGE_SIZE - 1);
+        if (head) {
+            munmap(base, head);
+        }
+        if (mapped - head > length) {
+            munmap(base + head + length, mapped - head - length);
+        }
+        base += head;
+#ifdef MADV_HUGEPAGE
+        madvise(base, length, MADV_HUGEPAGE);
+#endif
+    } else {
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return NULL;
+        }
+    }
+#ifdef SYS_mbind
+    if ((TheLargeAlloc.flags & NRT_LARGE_INTERLEAVE) && TheLargeAlloc.nodemask) {
+        /* Best effort, e.g. it is not permitted in some containers */
+        unsigned long nodemask = TheLargeAlloc.nodemask;
+        syscall(SYS_mbind, base, length, MPOL_INTERLEAVE, &nodemask,
+                8 * sizeof(unsigned long) + 1, 0);
+    }
+#endif
+    *length_out = length;
+    return base;
+}
+
+/*
+ * Allocate a block of `size` bytes starting with a MemInfo, see
+ * nrt_allocate_meminfo_and_data().  The returned pointer is the header,
+ * whose `base` holds the rest of the block.
+ */
+static void *
+nrt_large_malloc(size_t size, void *opaque_data) {
+    nrt_large_header *header;
+    size_t data_size = size > sizeof(NRT_MemInfo) ? size - sizeof(NRT_MemInfo)
+                                                  : 0;
+
+    header = TheMSys.allocator.malloc(sizeof(nrt_large_header));
+    if (header == NULL) {
+        return NULL;
+    }
+    header->length = data_size ? data_size : 1;
+    header->base = nrt_large_map(&header->length);
+    if (header->base == NULL) {
+        TheMSys.allocator.free(header);
+        return NULL;
+    }
+    header->size = data_size;
+    NRT_Debug(nrt_debug_print("nrt_large_malloc %p base=%p length=%zu\n",
+                              header, header->base, header->length));
+    return header;
+}
+
+static void
+nrt_large_free(void *ptr, void *opaque_data) {
+    nrt_large_header *header = ptr;
+    munmap(header->base, header->length);
+    TheMSys.allocator.free(header);
+}
+
+static void *
+nrt_large_realloc(void *ptr, size_t new_size, void *opaque_data) {
+    nrt_large_header *header = ptr, *new_header;
+    size_t offset;
+    new_header = nrt_large_malloc(new_size, opaque_data);
+    if (new_header == NULL) {
+        return NULL;
+    }
+    memcpy(new_header->base, header->base,
+           header->size < new_header->size ? header->size : new_header->size);
+    /* The MemInfo moves with the header and must follow the data, which
+       may start past the base of the mapping when it was aligned */
+    offset = (char *)header->mi.data - header->base;
+    new_header->mi = header->mi;
+    if (offset > new_header->size) {
+        offset = new_header->size;
+    }
+    new_header->mi.data = new_header->base + offset;
+    new_header->mi.size = new_header->size - offset;
+    nrt_large_free(ptr, opaque_data);
+    return new_header;
+}
+
+static NRT_ExternalAllocator nrt_large_allocator = {
+    nrt_large_malloc,
+    nrt_large_realloc,
+    nrt_large_free,
+    NULL
+};
+
+#endif  /* NRT_HAVE_MMAP */
+
+int NRT_MemSys_set_large_alloc_policy(size_t threshold, int flags) {
+#if NRT_HAVE_MMAP
+    /* Blocks record their allocator, so this can change at any time */
+    TheLargeAlloc.flags = flags;
+    if ((flags & NRT_LARGE_INTERLEAVE) && TheLargeAlloc.nodemask == 0) {
+        TheLargeAlloc.nodemask = nrt_numa_online_nodes();
+    }
+    TheLargeAlloc.threshold = threshold;
+    return 0;
+#else
+    return threshold == 0 ? 0 : -1;
+#endif
+}
+
+/*
+ * The allocator for a NRT_MemInfo_alloc* request of `size` bytes on this
+ * thread: the arena allocator if an arena is pushed, the large allocator
+ * above its threshold, NULL for the system allocator otherwise.
+ */
+static NRT_ExternalAllocator *
+nrt_default_allocator(size_t size) {
+    if (nrt_current_arena != NULL) {
+        return &nrt_arena_allocator;
+    }
+#if NRT_HAVE_MMAP
+    if (TheLargeAlloc.threshold != 0 && size >= TheLargeAlloc.threshold) {
+        return &nrt_large_allocator;
+    }
+#endif
+    return NULL;
+}
+
+NRT_Arena *NRT_Arena_new(size_t chunk_size) {
+    NRT_Arena *arena = TheMSys.allocator.malloc(sizeof(NRT_Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    memset(arena, 0, sizeof(NRT_Arena));
+    arena->chunk_size = NRT_ARENA_ROUND(chunk_size);
+    NRT_Debug(nrt_debug_print("NRT_Arena_new %p\n", arena));
+    return arena;
+}
+
+void NRT_Arena_push(NRT_Arena *arena) {
+    arena->prev = nrt_current_arena;
+    nrt_current_arena = arena;
+}
+
+NRT_Arena *NRT_Arena_pop(void) {
+    NRT_Arena *arena = nrt_current_arena;
+    if (arena != NULL) {
+        nrt_current_arena = arena->prev;
+        arena->prev = NULL;
+    }
+    return arena;
+}
+
+void NRT_Arena_get_stats(NRT_Arena *arena, NRT_ArenaStats *out) {
+    *out = arena->stats;
+}
+
+size_t NRT_Arena_get_live_chunks(void) {
+    return nrt_arena_live_chunks;
+}
+
+void NRT_Arena_free(NRT_Arena *arena) {
+    NRT_Debug(nrt_debug_print("NRT_Arena_free %p\n", arena));
+    if (arena->current != NULL) {
+        nrt_arena_release_chunk(arena->current);
+    }
+    TheMSys.allocator.free(arena);
+}
+
+
+/*
+ * Allocation profiler.
+ *
+ * When started, a sample of the MemInfo allocations is recorded along with
+ * its size, its site and its allocation time.  The site is the string last
+ * passed to NRT_Profile_set_site() on the allocating thread, which compiled
+ * code calls on entry when built with NUMBA_NRT_PROFILE, restoring the
+ * previous site on exit.  On release, the lifetime of a sampled allocation is
+ * added to its site.  Sites are looked up by the address of their string in
+ * an open-addressing index.
+ *
+ * Sampling is by allocated bytes: each thread counts down a randomized
+ * interval averaging `sample_interval` bytes and samples the allocation that
+ * crosses it, so unsampled allocations only cost a thread-local decrement.
+ * Frees check a small table of per-bucket counts before taking the lock, so
+ * unsampled frees do not contend either.
+ */
+
+#define NRT_PROFILE_BUCKETS 4096
+
+typedef struct {
+    const char *key;        /* the site string as passed in */
+    NRT_ProfileSite stats;  /* `name` is a private copy of `key` */
+} nrt_profile_site;
+
+typedef struct {
+    NRT_MemInfo *mi;        /* NULL for an empty slot */
+    size_t size;
+    size_t site;            /* index into TheProfile.sites */
+    double start;
+} nrt_profile_entry;
+
+static struct {
+    int enabled;
+    size_t sample_interval;
+    nrt_lock_t lock;
+    /* The following are protected by `lock` */
+    nrt_profile_site *sites;
+    size_t nsites, sites_capacity;
+    /* Open-addressing index of `sites` by key, holding index + 1 or 0 */
+    size_t *site_index;
+    size_t site_index_capacity;
+    /* Open-addressing table of the live sampled allocations */
+    nrt_profile_entry *live;
+    size_t nlive, live_capacity;
+    /* Number of live sampled allocations per bucket, read without the lock */
+    unsigned int buckets[NRT_PROFILE_BUCKETS];
+} TheProfile = { 0, 0, NRT_LOCK_INIT };
+
+static THREAD_LOCAL(const char *) nrt_profile_tsite;
+static THREAD_LOCAL(size_t) nrt_profile_countdown;
+static THREAD_LOCAL(uint64_t) nrt_profile_rand;
+
+/* Monotonic time in seconds */
+static double
+nrt_profile_now(void) {
+#ifdef _MSC_VER
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+#endif
+}
+
+static size_t
+nrt_profile_hash(const void *ptr) {
+    uint64_t h = (uint64_t)(uintptr_t) ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t) h;
+}
+
+static size_t
+nrt_profile_bucket(size_t hash) {
+    return (hash >> 7) & (NRT_PROFILE_BUCKETS - 1);
+}
+
+/* A random interval averaging `sample_interval` bytes */
+static size_t
+nrt_profile_next_interval(void) {
+    uint64_t x = nrt_profile_rand;
+    if (x == 0) {
+        x = (uint64_t)(uintptr_t) &nrt_profile_rand ^ 0x2545F4914F6CDD1DULL;
+    }
+    /* xorshift64 */
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    nrt_profile_rand = x;
+    return TheProfile.sample_interval / 2
+           + (size_t)(x % (TheProfile.sample_interval + 1));
+}
+
+static int
+nrt_profile_grow_site_index(void) {
+    size_t capacity = TheProfile.site_index_capacity ?
+                      2 * TheProfile.site_index_capacity : 64;
+    size_t *index = TheMSys.allocator.malloc(capacity * sizeof(size_t));
+    size_t i, j;
+    if (index == NULL) {
+        return -1;
+    }
+    memset(index, 0, capacity * sizeof(size_t));
+    for (i = 0; i < TheProfile.nsites; ++i) {
+        j = nrt_profile_hash(TheProfile.sites[i].key) & (capacity - 1);
+        while (index[j] != 0) {
+            j = (j + 1) & (capacity - 1);
+        }
+        index[j] = i + 1;
+    }
+    TheMSys.allocator.free(TheProfile.site_index);
+    TheProfile.site_index = index;
+    TheProfile.site_index_capacity = capacity;
+    return 0;
+}
+
+/* Find or add the site for `key`. Returns (size_t)-1 if out of memory. */
+static size_t
+nrt_profile_find_site(const char *key) {
+    size_t mask, j;
+    nrt_profile_site *site;
+    const char *name = key != NULL ? key : "<unknown>";
+    if (TheProfile.site_index_capacity != 0) {
+        mask = TheProfile.site_index_capacity - 1;
+        for (j = nrt_profile_hash(key) & mask; TheProfile.site_index[j] != 0;
+             j = (j + 1) & mask) {
+            if (TheProfile.sites[TheProfile.site_index[j] - 1].key == key) {
+                return TheProfile.site_index[j] - 1;
+            }
+        }
+    }
+    if (2 * (TheProfile.nsites + 1) > TheProfile.site_index_capacity &&
+        nrt_profile_grow_site_index()) {
+        return (size_t)-1;
+    }
+    if (TheProfile.nsites == TheProfile.sites_capacity) {
+        size_t capacity = TheProfile.sites_capacity ? 2 * TheProfile.sites_capacity : 16;
+        nrt_profile_site *sites = TheMSys.allocator.realloc(
+            TheProfile.sites, capacity * sizeof(nrt_profile_site));
+        if (sites == NULL) {
+            return (size_t)-1;
+        }
+        TheProfile.sites = sites;
+        TheProfile.sites_capacity = capacity;
+    }
+    site = &TheProfile.sites[TheProfile.nsites];
+    memset(site, 0, sizeof(nrt_profile_site));
+    site->key = key;
+    /* The site string may belong to code that gets unloaded */
+    site->stats.name = TheMSys.allocator.malloc(strlen(name) + 1);
+    if (site->stats.name == NULL) {
+        return (size_t)-1;
+    }
+    strcpy((char *) site->stats.name, name);
+    mask = TheProfile.site_index_capacity - 1;
+    j = nrt_profile_hash(key) & mask;
+    while (TheProfile.site_index[j] != 0) {
+        j = (j + 1) & mask;
+    }
+    TheProfile.site_index[j] = TheProfile.nsites + 1;
+    return TheProfile.nsites++;
+}
+
+static int
+nrt_profile_grow_live(void) {
+    size_t capacity = TheProfile.live_capacity ? 2 * TheProfile.live_capacity : 256;
+    nrt_profile_entry *old = TheProfile.live;
+    size_t old_capacity = TheProfile.live_capacity, i;
+    nrt_profile_entry *live = TheMSys.allocator.malloc(
+        capacity * sizeof(nrt_profile_entry));
+    if (live == NULL) {
+        return -1;
+    }
+    memset(live, 0, capacity * sizeof(nrt_profile_entry));
+    for (i = 0; i < old_capacity; ++i) {
+        if (old[i].mi != NULL) {
+            size_t j = nrt_profile_hash(old[i].mi) & (capacity - 1);
+            while (live[j].mi != NULL) {
+                j = (j + 1) & (capacity - 1);
+            }
+            live[j] = old[i];
+        }
+    }
+    TheMSys.allocator.free(old);
+    TheProfile.live = live;
+    TheProfile.live_capacity = capacity;
+    return 0;
+}
+
+static void
+nrt_profile_alloc(NRT_MemInfo *mi, size_t size) {
+    size_t cost = size + 1, hash, j, site;
+    if (TheProfile.sample_interval > 1) {
+        size_t countdown = nrt_profile_countdown;
+        if (countdown > 2 * TheProfile.sample_interval) {
+            /* Left over from a larger interval */
+            countdown = nrt_profile_next_interval();
+        }
+        if (cost < countdown) {
+            nrt_profile_countdown = countdown - cost;
+            return;
+        }
+        nrt_profile_countdown = nrt_profile_next_interval();
+    }
+
+    nrt_lock_acquire(&TheProfile.lock);
+    if (!TheProfile.enabled) {
+        goto done;
+    }
+    if (2 * (TheProfile.nlive + 1) > TheProfile.live_capacity &&
+        nrt_profile_grow_live()) {
+        goto done;
+    }
+    site = nrt_profile_find_site(nrt_profile_tsite);
+    if (site == (size_t)-1) {
+        goto done;
+    }
+    hash = nrt_profile_hash(mi);
+    j = hash & (TheProfile.live_capacity - 1);
+    while (TheProfile.live[j].mi != NULL) {
+        j = (j + 1) & (TheProfile.live_capacity - 1);
+    }
+    TheProfile.live[j].mi = mi;
+    TheProfile.live[j].size = size;
+    TheProfile.live[j].site = site;
+    TheProfile.live[j].start = nrt_profile_now();
+    TheProfile.nlive++;
+    TheProfile.buckets[nrt_profile_bucket(hash)]++;
+    TheProfile.sites[site].stats.alloc++;
+    TheProfile.sites[site].stats.alloc_bytes += size;
+done:
+    nrt_lock_release(&TheProfile.lock);
+}
+
+static void
+nrt_profile_free(NRT_MemInfo *mi) {
+    size_t hash = nrt_profile_hash(mi);
+    size_t mask, i, j;
+    nrt_profile_entry *entry;
+    NRT_ProfileSite *stats;
+
+    if (TheProfile.buckets[nrt_profile_bucket(hash)] == 0) {
+        /* Not sampled */
+        return;
+    }
+    nrt_lock_acquire(&TheProfile.lock);
+    if (TheProfile.live_capacity == 0) {
+        goto done;
+    }
+    mask = TheProfile.live_capacity - 1;
+    for (i = hash & mask; TheProfile.live[i].mi != mi; i = (i + 1) & mask) {
+        if (TheProfile.live[i].mi == NULL) {
+            /* Another allocation in the same bucket */
+            goto done;
+        }
+    }
+    entry = &TheProfile.live[i];
+    stats = &TheProfile.sites[entry->site].stats;
+    stats->free++;
+    stats->free_bytes += entry->size;
+    stats->lifetime += nrt_profile_now() - entry->start;
+    TheProfile.buckets[nrt_profile_bucket(hash)]--;
+    TheProfile.nlive--;
+    /* Backward-shift deletion keeps the probe sequences intact */
+    for (j = (i + 1) & mask; TheProfile.live[j].mi != NULL; j = (j + 1) & mask) {
+        size_t home = nrt_profile_hash(TheProfile.live[j].mi) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            TheProfile.live[i] = TheProfile.live[j];
+            i = j;
+        }
+    }
+    TheProfile.live[i].mi = NULL;
+done:
+    nrt_lock_release(&TheProfile.lock);
+}
+
+const char *NRT_Profile_set_site(const char *site) {
+    const char *prev = nrt_profile_tsite;
+    nrt_profile_tsite = site;
+    return prev;
+}
+
+void NRT_Profile_start(size_t sample_interval) {
+    size_t i;
+    nrt_lock_acquire(&TheProfile.lock);
+    for (i = 0; i < TheProfile.nsites; ++i) {
+        TheMSys.allocator.free((char *) TheProfile.sites[i].stats.name);
+    }
+    TheMSys.allocator.free(TheProfile.sites);
+    TheMSys.allocator.free(TheProfile.site_index);
+    TheMSys.allocator.free(TheProfile.live);
+    TheProfile.sites = NULL;
+    TheProfile.nsites = TheProfile.sites_capacity = 0;
+    TheProfile.site_index = NULL;
+    TheProfile.site_index_capacity = 0;
+    TheProfile.live = NULL;
+    TheProfile.nlive = TheProfile.live_capacity = 0;
+    memset(TheProfile.buckets, 0, sizeof(TheProfile.buckets));
+    TheProfile.sample_interval = sample_interval;
+    TheProfile.enabled = 1;
+    nrt_lock_release(&TheProfile.lock);
+}
+
+void NRT_Profile_stop(void) {
+    nrt_lock_acquire(&TheProfile.lock);
+    TheProfile.enabled = 0;
+    nrt_lock_release(&TheProfile.lock);
+}
+
+size_t NRT_Profile_get_sites(NRT_ProfileSite *out, size_t n) {
+    size_t i, nsites;
+    nrt_lock_acquire(&TheProfile.lock);
+    nsites = TheProfile.nsites;
+    for (i = 0; i < n && i < nsites; ++i) {
+        out[i] = TheProfile.sites[i].stats;
+    }
+    nrt_lock_release(&TheProfile.lock);
+    return nsites;
+}
+
+size_t NRT_Profile_snapshot(NRT_ProfileAlloc *out, size_t n) {
+    size_t i, k = 0, nlive;
+    double now = nrt_profile_now();
+    nrt_lock_acquire(&TheProfile.lock);
+    nlive = TheProfile.nlive;
+    for (i = 0; i < TheProfile.live_capacity && k < n; ++i) {
+        nrt_profile_entry *entry = &TheProfile.live[i];
+        if (entry->mi != NULL) {
+            out[k].site = TheProfile.sites[entry->site].stats.name;
+            out[k].size = entry->size;
+            out[k].age = now - entry->start;
+            k++;
+        }
+    }
+    nrt_lock_release(&TheProfile.lock);
+    return nlive;
+}
+
+
 /*
  * The MemInfo structure.
  */
@@ -178,7 +1448,10 @@ void NRT_MemInfo_init(NRT_MemInfo *mi,void *data, size_t size,
     mi->external_allocator = external_allocator;
     NRT_Debug(nrt_debug_print("NRT_MemInfo_init mi=%p external_allocator=%p\n", mi, external_allocator));
     /* Update stats */
-    TheMSys.atomic_inc(&TheMSys.stats_mi_alloc);
+    NRT_STATS_INC(mi_alloc);
+    if (TheProfile.enabled) {
+        nrt_profile_alloc(mi, size);
+    }
 }
 
 NRT_MemInfo *NRT_MemInfo_new(void *data, size_t size,
@@ -220,6 +1493,12 @@ void *nrt_allocate_meminfo_and_data(size_t size, NRT_MemInfo **mi_out, NRT_Exter
     }
     mi = (NRT_MemInfo *) base;
     *mi_out = mi;
+#if NRT_HAVE_MMAP
+    if (allocator == &nrt_large_allocator) {
+        /* The data is mapped apart from the MemInfo */
+        return ((nrt_large_header *) base)->base;
+    }
+#endif
     return base + sizeof(NRT_MemInfo);
 }
 
@@ -248,12 +1527,13 @@ void nrt_internal_custom_dtor(void *ptr, size_t size, void *info) {
 
 NRT_MemInfo *NRT_MemInfo_alloc(size_t size) {
     NRT_MemInfo *mi = NULL;
-    void *data = nrt_allocate_meminfo_and_data(size, &mi, NULL);
+    NRT_ExternalAllocator *allocator = nrt_default_allocator(size);
+    void *data = nrt_allocate_meminfo_and_data(size, &mi, allocator);
     if (data == NULL) {
         return NULL; /* return early as allocation failed */
     }
     NRT_Debug(nrt_debug_print("NRT_MemInfo_alloc %p\n", data));
-    NRT_MemInfo_init(mi, data, size, NULL, NULL, NULL);
+    NRT_MemInfo_init(mi, data, size, NULL, NULL, allocator);
     return mi;
 }
 
@@ -274,25 +1554,28 @@ NRT_MemInfo *NRT_MemInfo_alloc_safe(size_t size) {
 
 NRT_MemInfo* NRT_MemInfo_alloc_dtor_safe(size_t size, NRT_dtor_function dtor) {
     NRT_MemInfo *mi = NULL;
-    void *data = nrt_allocate_meminfo_and_data(size, &mi, NULL);
+    NRT_ExternalAllocator *allocator = nrt_default_allocator(size);
+    void *data = nrt_allocate_meminfo_and_data(size, &mi, allocator);
     if (data == NULL) {
         return NULL; /* return early as allocation failed */
     }
     /* Fill region with debug markers */
     memset(data, 0xCB, size);
     NRT_Debug(nrt_debug_print("NRT_MemInfo_alloc_dtor_safe %p %zu\n", data, size));
-    NRT_MemInfo_init(mi, data, size, nrt_internal_custom_dtor_safe, dtor, NULL);
+    NRT_MemInfo_init(mi, data, size, nrt_internal_custom_dtor_safe, dtor,
+                     allocator);
     return mi;
 }
 
 NRT_MemInfo* NRT_MemInfo_alloc_dtor(size_t size, NRT_dtor_function dtor) {
     NRT_MemInfo *mi = NULL;
-    void *data = nrt_allocate_meminfo_and_data(size, &mi, NULL);
+    NRT_ExternalAllocator *allocator = nrt_default_allocator(size);
+    void *data = nrt_allocate_meminfo_and_data(size, &mi, allocator);
     if (data == NULL) {
         return NULL; /* return early as allocation failed */
     }
     NRT_Debug(nrt_debug_print("NRT_MemInfo_alloc_dtor %p %zu\n", data, size));
-    NRT_MemInfo_init(mi, data, size, nrt_internal_custom_dtor, dtor, NULL);
+    NRT_MemInfo_init(mi, data, size, nrt_internal_custom_dtor, dtor, allocator);
     return mi;
 }
 
@@ -329,18 +1612,20 @@ void *nrt_allocate_meminfo_and_data_align(size_t size, unsigned align,
 
 NRT_MemInfo *NRT_MemInfo_alloc_aligned(size_t size, unsigned align) {
     NRT_MemInfo *mi = NULL;
-    void *data = nrt_allocate_meminfo_and_data_align(size, align, &mi, NULL);
+    NRT_ExternalAllocator *allocator = nrt_default_allocator(size);
+    void *data = nrt_allocate_meminfo_and_data_align(size, align, &mi, allocator);
     if (data == NULL) {
         return NULL; /* return early as allocation failed */
     }
     NRT_Debug(nrt_debug_print("NRT_MemInfo_alloc_aligned %p\n", data));
-    NRT_MemInfo_init(mi, data, size, NULL, NULL, NULL);
+    NRT_MemInfo_init(mi, data, size, NULL, NULL, allocator);
     return mi;
 }
 
 NRT_MemInfo *NRT_MemInfo_alloc_safe_aligned(size_t size, unsigned align) {
     NRT_MemInfo *mi = NULL;
-    void *data = nrt_allocate_meminfo_and_data_align(size, align, &mi, NULL);
+    NRT_ExternalAllocator *allocator = nrt_default_allocator(size);
+    void *data = nrt_allocate_meminfo_and_data_align(size, align, &mi, allocator);
     if (data == NULL) {
         return NULL; /* return early as allocation failed */
     }
@@ -348,7 +1633,8 @@ NRT_MemInfo *NRT_MemInfo_alloc_safe_aligned(size_t size, unsigned align) {
     memset(data, 0xCB, size);
     NRT_Debug(nrt_debug_print("NRT_MemInfo_alloc_safe_aligned %p %zu\n",
                               data, size));
-    NRT_MemInfo_init(mi, data, size, nrt_internal_dtor_safe, (void*)size, NULL);
+    NRT_MemInfo_init(mi, data, size, nrt_internal_dtor_safe, (void*)size,
+                     allocator);
     return mi;
 }
 
@@ -367,19 +1653,57 @@ NRT_MemInfo *NRT_MemInfo_alloc_safe_aligned_external(size_t size, unsigned align
     return mi;
 }
 
+NRT_MemInfo *NRT_Arena_promote(NRT_MemInfo *mi) {
+    NRT_MemInfo *copy = NULL;
+    size_t align;
+    void *data;
+
+    if (mi->external_allocator != &nrt_arena_allocator) {
+        return NULL;
+    }
+    /* Other holders of the block (jitted structures or arrays already boxed)
+       would no longer see the writes made to the copy, and the other way
+       round.  With the only reference, nothing else can acquire one. */
+    if (mi->refct != 1) {
+        return NULL;
+    }
+    /* A custom destructor may release references held in the block, which
+       would then be released twice */
+    if (mi->dtor != NULL && mi->dtor != nrt_internal_dtor_safe) {
+        return NULL;
+    }
+    /* Keep the alignment of the original data, up to a cache line */
+    align = (size_t)mi->data & (~(size_t)mi->data + 1);
+    if (align == 0 || align > 64) {
+        align = 64;
+    }
+    data = nrt_allocate_meminfo_and_data_align(mi->size, (unsigned)align,
+                                               &copy, NULL);
+    if (data == NULL) {
+        return NULL;
+    }
+    memcpy(data, mi->data, mi->size);
+    NRT_Debug(nrt_debug_print("NRT_Arena_promote %p -> %p\n", mi, copy));
+    NRT_MemInfo_init(copy, data, mi->size, mi->dtor, mi->dtor_info, NULL);
+    return copy;
+}
+
 void NRT_dealloc(NRT_MemInfo *mi) {
     NRT_Debug(nrt_debug_print("NRT_dealloc meminfo: %p external_allocator: %p\n", mi, mi->external_allocator));
     if (mi->external_allocator) {
         mi->external_allocator->free(mi, mi->external_allocator->opaque_data);
-        TheMSys.atomic_inc(&TheMSys.stats_free);
+        NRT_STATS_INC(free);
     } else {
         NRT_Free(mi);
     }
 }
 
 void NRT_MemInfo_destroy(NRT_MemInfo *mi) {
+    if (TheProfile.enabled) {
+        nrt_profile_free(mi);
+    }
     NRT_dealloc(mi);
-    TheMSys.atomic_inc(&TheMSys.stats_mi_free);
+    NRT_STATS_INC(mi_free);
 }
 
 void NRT_MemInfo_acquire(NRT_MemInfo *mi) {
@@ -519,16 +1843,29 @@ void* NRT_Allocate_External(size_t size, NRT_ExternalAllocator *allocator) {
     if (allocator) {
         ptr = allocator->malloc(size, allocator->opaque_data);
         NRT_Debug(nrt_debug_print("NRT_Allocate_External custom bytes=%zu ptr=%p\n", size, ptr));
+    } else if (TheSlab.enabled) {
+        ptr = nrt_slab_malloc(size);
+        NRT_Debug(nrt_debug_print("NRT_Allocate_External slab bytes=%zu ptr=%p\n", size, ptr));
     } else {
         ptr = TheMSys.allocator.malloc(size);
         NRT_Debug(nrt_debug_print("NRT_Allocate_External bytes=%zu ptr=%p\n", size, ptr));
     }
-    TheMSys.atomic_inc(&TheMSys.stats_alloc);
+    NRT_STATS_INC(alloc);
+#if !NRT_ENABLE_STATS
+    if (!TheMSys.allocated) {
+        TheMSys.allocated = 1;
+    }
+#endif
     return ptr;
 }
 
 void *NRT_Reallocate(void *ptr, size_t size) {
-    void *new_ptr = TheMSys.allocator.realloc(ptr, size);
+    void *new_ptr;
+    if (TheSlab.enabled) {
+        new_ptr = nrt_slab_realloc(ptr, size);
+    } else {
+        new_ptr = TheMSys.allocator.realloc(ptr, size);
+    }
     NRT_Debug(nrt_debug_print("NRT_Reallocate bytes=%zu ptr=%p -> %p\n",
                               size, ptr, new_ptr));
     return new_ptr;
@@ -536,8 +1873,12 @@ void *NRT_Reallocate(void *ptr, size_t size) {
 
 void NRT_Free(void *ptr) {
     NRT_Debug(nrt_debug_print("NRT_Free %p\n", ptr));
-    TheMSys.allocator.free(ptr);
-    TheMSys.atomic_inc(&TheMSys.stats_free);
+    if (TheSlab.enabled) {
+        nrt_slab_free(ptr);
+    } else {
+        TheMSys.allocator.free(ptr);
+    }
+    NRT_STATS_INC(free);
 }
 
 /*
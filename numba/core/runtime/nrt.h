@@ -20,6 +20,15 @@ All functions described here are threadsafe.
 #   define NRT_Debug(X) if (0) { X; }
 #endif
 
+/*
+ * Allocation statistics - enabled by default.  Building with
+ * -DNRT_ENABLE_STATS=0 compiles the counters out of the allocation paths;
+ * the NRT_MemSys_get_stats_*() functions then always return 0.
+ */
+#ifndef NRT_ENABLE_STATS
+#   define NRT_ENABLE_STATS 1
+#endif
+
 /* TypeDefs */
 typedef void (*NRT_dtor_function)(void *ptr, size_t size, void *info);
 typedef void (*NRT_dealloc_func)(void *ptr, void *dealloc_info);
@@ -33,6 +42,41 @@ typedef void *(*NRT_malloc_func)(size_t size);
 typedef void *(*NRT_realloc_func)(void *ptr, size_t new_size);
 typedef void (*NRT_free_func)(void *ptr);
 
+/* Number of size classes of the slab allocator: 16 bytes to 64 KiB */
+#define NRT_SLAB_NUM_CLASSES 13
+
+/* Statistics of one size class of the slab allocator */
+typedef struct {
+    size_t block_size;
+    size_t alloc, free;
+    size_t chunks;
+} NRT_SlabStats;
+
+/* An arena for NRT_MemInfo allocations, see NRT_Arena_new() */
+typedef struct NRT_Arena NRT_Arena;
+
+/* Statistics of an arena */
+typedef struct {
+    size_t alloc;       /* number of blocks served */
+    size_t bytes;       /* total bytes requested */
+    size_t chunks;      /* number of chunks obtained from the system */
+} NRT_ArenaStats;
+
+/* Per-site statistics of the allocation profiler */
+typedef struct {
+    const char *name;
+    size_t alloc, alloc_bytes;  /* sampled allocations */
+    size_t free, free_bytes;    /* ... of which were released */
+    double lifetime;            /* total lifetime of the released ones (s) */
+} NRT_ProfileSite;
+
+/* A live allocation sampled by the allocation profiler */
+typedef struct {
+    const char *site;
+    size_t size;
+    double age;                 /* seconds since allocation */
+} NRT_ProfileAlloc;
+
 /* Memory System API */
 
 /* Initialize the memory system */
@@ -49,6 +93,36 @@ void NRT_MemSys_shutdown(void);
 VISIBILITY_HIDDEN
 void NRT_MemSys_set_allocator(NRT_malloc_func, NRT_realloc_func, NRT_free_func);
 
+/*
+ * Put the thread-caching slab allocator in front of the system allocator for
+ * blocks of up to `max_size` bytes (clamped to the largest size class).
+ * A `max_size` of 0 disables it.  Returns -1 without changing anything if
+ * NRT blocks are currently allocated, 0 otherwise.
+ */
+VISIBILITY_HIDDEN
+int NRT_MemSys_set_slab_allocator(size_t max_size);
+
+/*
+ * Copy the statistics of up to `n` size classes of the slab allocator into
+ * `out`.  Returns the number of entries written, 0 if it is disabled.
+ */
+VISIBILITY_HIDDEN
+size_t NRT_MemSys_get_slab_stats(NRT_SlabStats *out, size_t n);
+
+/*
+ * Flags of NRT_MemSys_set_large_alloc_policy()
+ */
+#define NRT_LARGE_HUGEPAGES  1  /* use transparent huge pages */
+#define NRT_LARGE_INTERLEAVE 2  /* interleave the pages over NUMA nodes */
+
+/*
+ * Map the MemInfo allocations of at least `threshold` bytes directly from
+ * the OS, with the given NRT_LARGE_* flags.  A `threshold` of 0 disables it.
+ * Returns -1 if this is not supported on the platform, 0 otherwise.
+ */
+VISIBILITY_HIDDEN
+int NRT_MemSys_set_large_alloc_policy(size_t threshold, int flags);
+
 /*
  * Register the atomic increment and decrement functions
  */
@@ -77,6 +151,8 @@ void NRT_MemSys_set_atomic_cas_stub(void);
 
 /*
  * The following functions get internal statistics of the memory subsystem.
+ * The counters are kept per thread and summed on request, so the result is
+ * only exact while no other thread is allocating.
  */
 VISIBILITY_HIDDEN
 size_t NRT_MemSys_get_stats_alloc(void);
@@ -227,6 +303,65 @@ void *NRT_MemInfo_varsize_realloc(NRT_MemInfo *mi, size_t size);
 VISIBILITY_HIDDEN
 void NRT_MemInfo_varsize_free(NRT_MemInfo *mi, void *ptr);
 
+/*
+ * NRT API for arenas.
+ *
+ * While an arena is pushed on a thread, the NRT_MemInfo_alloc* functions
+ * called on that thread bump-allocate from chunks of `chunk_size` bytes
+ * owned by the arena instead of calling the system allocator.  Blocks can
+ * be released on any thread and may outlive the arena: a chunk is returned
+ * to the system once the arena no longer uses it and all its blocks are
+ * dead.  Arenas nest; NRT_Arena_pop() returns the innermost one, which must
+ * be popped before NRT_Arena_free() is called.
+ *
+ * NRT_Arena_get_live_chunks() returns the number of chunks of all arenas
+ * not yet returned to the system.
+ *
+ * NRT_Arena_promote() returns a new MemInfo holding a copy of the data of
+ * `mi` outside of any arena, if `mi` is a plain data block of an arena (no
+ * custom destructor) and the caller holds its only reference, and NULL
+ * otherwise or if the copy can't be allocated.
+ */
+VISIBILITY_HIDDEN
+NRT_Arena *NRT_Arena_new(size_t chunk_size);
+VISIBILITY_HIDDEN
+void NRT_Arena_push(NRT_Arena *arena);
+VISIBILITY_HIDDEN
+NRT_Arena *NRT_Arena_pop(void);
+VISIBILITY_HIDDEN
+void NRT_Arena_get_stats(NRT_Arena *arena, NRT_ArenaStats *out);
+VISIBILITY_HIDDEN
+size_t NRT_Arena_get_live_chunks(void);
+VISIBILITY_HIDDEN
+void NRT_Arena_free(NRT_Arena *arena);
+VISIBILITY_HIDDEN
+NRT_MemInfo *NRT_Arena_promote(NRT_MemInfo *mi);
+
+/*
+ * NRT allocation profiler.
+ *
+ * NRT_Profile_start() discards any previous profile and starts sampling
+ * MemInfo allocations, on average one per `sample_interval` bytes (every
+ * allocation if it is 0 or 1).  Each sample is attributed to the site last
+ * set with NRT_Profile_set_site() on the allocating thread, which returns
+ * the previous one so that it can be restored.
+ * NRT_Profile_stop() stops sampling but keeps the profile for inspection.
+ *
+ * NRT_Profile_get_sites() and NRT_Profile_snapshot() copy up to `n` entries
+ * into `out` and return the total number available.  The strings they
+ * return stay valid until the next NRT_Profile_start().
+ */
+VISIBILITY_HIDDEN
+const char *NRT_Profile_set_site(const char *site);
+VISIBILITY_HIDDEN
+void NRT_Profile_start(size_t sample_interval);
+VISIBILITY_HIDDEN
+void NRT_Profile_stop(void);
+VISIBILITY_HIDDEN
+size_t NRT_Profile_get_sites(NRT_ProfileSite *out, size_t n);
+VISIBILITY_HIDDEN
+size_t NRT_Profile_snapshot(NRT_ProfileAlloc *out, size_t n);
+
 /*
  * Print debug info to FILE
  */
@@ -6,10 +6,17 @@ from llvmlite import binding as ll
 
 from numba.core.compiler_lock import global_compiler_lock
 from numba.core.typing.typeof import typeof_impl
-from numba.core import types
+from numba.core import types, config
 from numba.core.runtime import _nrt_python as _nrt
 
 _nrt_mstats = namedtuple("nrt_mstats", ["alloc", "free", "mi_alloc", "mi_free"])
+_nrt_slab_stats = namedtuple("nrt_slab_stats",
+                             ["block_size", "alloc", "free", "chunks"])
+_nrt_arena_stats = namedtuple("nrt_arena_stats", ["alloc", "bytes", "chunks"])
+_nrt_profile_site = namedtuple("nrt_profile_site",
+                               ["site", "alloc", "alloc_bytes", "live",
+                                "live_bytes", "mean_lifetime"])
+_nrt_profile_alloc = namedtuple("nrt_profile_alloc", ["site", "size", "age"])
 
 
 class _Runtime(object):
@@ -104,6 +111,14 @@ class _Runtime(object):
             raise MemoryError(msg)
         return MemInfo(mi)
 
+    @property
+    def stats_enabled(self):
+        """
+        Whether the NRT was built with allocation statistics.  If not,
+        `get_allocation_stats()` always returns zeros.
+        """
+        return bool(_nrt.STATS_ENABLED)
+
     def get_allocation_stats(self):
         """
         Returns a namedtuple of (alloc, free, mi_alloc, mi_free) for count of
@@ -115,6 +130,144 @@ class _Runtime(object):
                            mi_alloc=_nrt.memsys_get_stats_mi_alloc(),
                            mi_free=_nrt.memsys_get_stats_mi_free())
 
+    def profile_start(self, sample_interval=512 * 1024):
+        """
+        Start the NRT allocation profiler, discarding any previous profile.
+
+        On average one MemInfo allocation is sampled per `sample_interval`
+        bytes allocated (each thread counts separately); 0 or 1 samples every
+        allocation.  Samples are attributed to the compiled function that
+        made them if it was compiled with NUMBA_NRT_PROFILE set, and to
+        "<unknown>" otherwise.
+        """
+        _nrt.profile_start(sample_interval)
+
+    def profile_stop(self):
+        """
+        Stop the NRT allocation profiler.  The profile collected so far can
+        still be inspected, but releases are no longer tracked.
+        """
+        _nrt.profile_stop()
+
+    def profile_snapshot(self):
+        """
+        Returns a list of namedtuples of (site, size, age) describing the
+        sampled allocations that are still alive, `age` being in seconds.
+        """
+        return [_nrt_profile_alloc(*alloc)
+                for alloc in _nrt.profile_snapshot()]
+
+    def profile_top(self, n=10, key='alloc_bytes'):
+        """
+        Returns the `n` allocation sites with the largest `key` as a list of
+        namedtuples of (site, alloc, alloc_bytes, live, live_bytes,
+        mean_lifetime).  Counts and sizes are those of the sampled
+        allocations, `mean_lifetime` is in seconds over the released ones
+        (None if none was).
+        """
+        sites = []
+        for name, alloc, alloc_bytes, free, free_bytes, lifetime in \
+                _nrt.profile_get_sites():
+            sites.append(_nrt_profile_site(
+                site=name, alloc=alloc, alloc_bytes=alloc_bytes,
+                live=alloc - free, live_bytes=alloc_bytes - free_bytes,
+                mean_lifetime=lifetime / free if free else None))
+        sites.sort(key=lambda site: getattr(site, key) or 0, reverse=True)
+        return sites[:n]
+
+    def set_large_alloc_policy(self, threshold, hugepages=True,
+                               interleave=False):
+        """
+        Map the NRT allocations of at least `threshold` bytes directly from
+        the OS instead of the system allocator; 0 disables it.  If
+        `hugepages` is true, transparent huge pages are requested for them.
+        If `interleave` is true, their pages are interleaved over the NUMA
+        nodes; otherwise they are placed on the node of the thread that
+        first touches them.
+
+        Only supported on Linux, raises NotImplementedError elsewhere.
+        """
+        _nrt.memsys_set_large_alloc_policy(threshold, hugepages, interleave)
+
+    def set_slab_allocator(self, max_size):
+        """
+        Serve NRT allocations of up to `max_size` bytes from the
+        thread-caching slab allocator.  A `max_size` of 0 disables it.
+
+        Raises RuntimeError if NRT blocks are currently allocated.
+        """
+        _nrt.memsys_set_slab_allocator(max_size)
+
+    def get_slab_stats(self):
+        """
+        Returns a list of namedtuples of (block_size, alloc, free, chunks),
+        one per size class of the slab allocator.  The list is empty if the
+        slab allocator is disabled.
+        """
+        return [_nrt_slab_stats(*stats)
+                for stats in _nrt.memsys_get_slab_stats()]
+
+
+class nrt_arena(object):
+    """
+    A context manager that serves the NRT allocations of arrays made on the
+    current thread from an arena::
+
+        with numba.nrt_arena():
+            result = some_jitted_function(x)
+
+    The MemInfo and data of each array are bump-allocated from chunks of
+    `chunk_size` bytes, and freeing them only drops a per-chunk count, which
+    makes short-lived temporaries nearly free.  Arrays returned to Python
+    are copied out of the arena, so they do not keep a whole chunk alive,
+    unless they are still referenced by the jitted side (e.g. kept in a
+    typed container, or views of the same array): those stay shared and
+    keep their chunk alive until they are released.
+    Allocations on other threads (e.g. parallel regions) are not affected.
+    """
+
+    def __init__(self, chunk_size=1 << 20):
+        self._chunk_size = chunk_size
+        self._arena = None
+        self._stats = None
+
+    def __enter__(self):
+        if self._arena is not None:
+            raise RuntimeError("NRT arena is already active")
+        self._arena = _nrt.arena_new(self._chunk_size)
+        _nrt.arena_push(self._arena)
+        return self
+
+    def __exit__(self, *exc_info):
+        popped = _nrt.arena_pop()
+        if popped != self._arena:
+            if popped:
+                _nrt.arena_push(popped)
+            raise RuntimeError("NRT arenas must be exited in the reverse "
+                               "order they were entered")
+        arena, self._arena = self._arena, None
+        self._stats = _nrt_arena_stats(*_nrt.arena_get_stats(arena))
+        _nrt.arena_free(arena)
+
+    @property
+    def stats(self):
+        """
+        A namedtuple of (alloc, bytes, chunks): the number of blocks served,
+        the bytes requested and the number of chunks obtained from the system
+        allocator.
+        """
+        if self._arena is not None:
+            return _nrt_arena_stats(*_nrt.arena_get_stats(self._arena))
+        return self._stats
+
+    @staticmethod
+    def live_chunks():
+        """
+        The number of chunks of all arenas not yet returned to the system
+        allocator.
+        """
+        return _nrt.arena_get_live_chunks()
+
 
 # Alias to _nrt_python._MemInfo
 MemInfo = _nrt._MemInfo
@@ -127,6 +280,12 @@ def typeof_meminfo(val, c):
 
 # Create runtime
 _nrt.memsys_use_cpython_allocator()
+if config.NRT_SLAB_ALLOCATOR:
+    _nrt.memsys_set_slab_allocator(config.NRT_SLAB_ALLOCATOR)
+if config.NRT_LARGE_ALLOC_THRESHOLD:
+    _nrt.memsys_set_large_alloc_policy(config.NRT_LARGE_ALLOC_THRESHOLD,
+                                       config.NRT_LARGE_ALLOC_HUGEPAGES,
+                                       config.NRT_LARGE_ALLOC_INTERLEAVE)
 rtsys = _Runtime()
 
 # Install finalizer
@@ -23,6 +23,9 @@ set_compatible(PyObject* self, PyObject* args);
 static PyObject*
 get_pointer(PyObject* self, PyObject* args);
 
+static PyObject*
+get_stats(PyObject* self, PyObject* args);
+
 
 static PyMethodDef ext_methods[] = {
 #define declmethod(func) { #func , ( PyCFunction )func , METH_VARARGS , NULL }
@@ -31,6 +34,7 @@ static PyMethodDef ext_methods[] = {
     declmethod(check_compatible),
     declmethod(set_compatible),
     declmethod(get_pointer),
+    declmethod(get_stats),
     { NULL },
 #undef declmethod
 };
@@ -202,4 +206,26 @@ get_pointer(PyObject* self, PyObject* args)
     return PyLong_FromVoidPtr(unwrap_TypeManager(tmcap));
 }
 
+PyObject*
+get_stats(PyObject* self, PyObject* args)
+{
+    PyObject *tmcap;
+    if (!PyArg_ParseTuple(args, "O", &tmcap)) {
+        return NULL;
+    }
 
+    TypeManager *tm = unwrap_TypeManager(tmcap);
+    if (!tm) {
+        BAD_TM_ARGUMENT;
+        return NULL;
+    }
+
+    TCCMapStats st = tm->getStats();
+    return Py_BuildValue("{snsnsdsnsd}",
+                         "size", (Py_ssize_t) st.size,
+                         "capacity", (Py_ssize_t) st.capacity,
+                         "load_factor",
+                         (double) st.size / (double) st.capacity,
+                         "max_probe_length", (Py_ssize_t) st.max_probe,
+                         "mean_probe_length", st.mean_probe);
+}
@@ -2,46 +2,105 @@
 #include <cstdio>
 #include <algorithm>
 #include <limits.h>
+#include <stdint.h>
 
 #include "typeconv.hpp"
 
 
 // ------ TypeManager ------
 
+/* Marks an unused slot.  No compatibility is ever stored for it, since
+   a type is always an exact match for itself. */
+static const TypePair EMPTY_KEY(-1, -1);
+
 TCCMap::TCCMap()
-    : nb_records(0)
+    : records(TCCMAP_INITIAL_SIZE, TCCRecord({EMPTY_KEY, TCC_FALSE})),
+      nb_records(0)
 {
 }
 
 size_t TCCMap::hash(const TypePair &key) const {
-    return std::hash<size_t>()(std::hash<Type>()(key.first)) ^
-           std::hash<Type>()(key.second);
+    /* Mix both typecodes (the finalizer of MurmurHash3), since typecodes
+       are small consecutive integers and std::hash<int> is often the
+       identity. */
+    uint64_t h = ((uint64_t) (uint32_t) key.first << 32) |
+                 (uint32_t) key.second;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (size_t) h;
+}
+
+void TCCMap::grow() {
+    std::vector<TCCRecord> old(records.size() * 2,
+                               TCCRecord({EMPTY_KEY, TCC_FALSE}));
+    old.swap(records);
+    const size_t mask = records.size() - 1;
+    for (size_t j = 0; j < old.size(); ++j) {
+        if (old[j].key == EMPTY_KEY)
+            continue;
+        size_t i = hash(old[j].key) & mask;
+        while (records[i].key != EMPTY_KEY) {
+            i = (i + 1) & mask;
+        }
+        records[i] = old[j];
+    }
 }
 
 void TCCMap::insert(const TypePair &key, TypeCompatibleCode val) {
-    size_t i = hash(key) & (TCCMAP_SIZE - 1);
-    TCCMapBin &bin = records[i];
-    for (unsigned int j = 0; j < bin.size(); ++j) {
-        if (bin[j].key == key) {
-            bin[j].val = val;
+    if (key == EMPTY_KEY)
+        return;
+    if ((nb_records + 1) * TCCMAP_LOAD_DENOM >
+        records.size() * TCCMAP_LOAD_NUM) {
+        grow();
+    }
+    const size_t mask = records.size() - 1;
+    size_t i = hash(key) & mask;
+    while (records[i].key != EMPTY_KEY) {
+        if (records[i].key == key) {
+            records[i].val = val;
             return;
         }
+        i = (i + 1) & mask;
     }
-    bin.push_back({key, val});
+    records[i].key = key;
+    records[i].val = val;
     nb_records++;
 }
 
 TypeCompatibleCode TCCMap::find(const TypePair &key) const {
-    size_t i = hash(key) & (TCCMAP_SIZE - 1);
-    const TCCMapBin &bin = records[i];
-    for (unsigned int j = 0; j < bin.size(); ++j) {
-        if (bin[j].key == key) {
-            return bin[j].val;
+    const size_t mask = records.size() - 1;
+    size_t i = hash(key) & mask;
+    /* The load factor guarantees there is an empty slot to stop at */
+    while (records[i].key != EMPTY_KEY) {
+        if (records[i].key == key) {
+            return records[i].val;
         }
+        i = (i + 1) & mask;
     }
     return TCC_FALSE;
 }
 
+TCCMapStats TCCMap::stats() const {
+    TCCMapStats st;
+    const size_t mask = records.size() - 1;
+    size_t total_probe = 0;
+    st.size = nb_records;
+    st.capacity = records.size();
+    st.max_probe = 0;
+    for (size_t j = 0; j < records.size(); ++j) {
+        if (records[j].key == EMPTY_KEY)
+            continue;
+        size_t probe = (j - hash(records[j].key)) & mask;
+        total_probe += probe;
+        st.max_probe = std::max(st.max_probe, probe);
+    }
+    st.mean_probe = nb_records ? (double) total_probe / nb_records : 0.0;
+    return st;
+}
+
 // ----- Ratings -----
 Rating::Rating() : promote(0), safe_convert(0), unsafe_convert(0) { }
 
@@ -64,6 +123,11 @@ inline bool Rating::operator == (const Rating &other) const {
 
 // ------ TypeManager ------
 
+TypeManager::TypeManager()
+    : version(0)
+{
+}
+
 bool TypeManager::canPromote(Type from, Type to) const {
     return isCompatible(from, to) == TCC_PROMOTE;
 }
@@ -91,6 +155,7 @@ void TypeManager::addSafeConversion(Type from, Type to) {
 void TypeManager::addCompatibility(Type from, Type to, TypeCompatibleCode tcc) {
     TypePair pair(from, to);
     tccmap.insert(pair, tcc);
+    version++;
 }
 
 TypeCompatibleCode TypeManager::isCompatible(Type from, Type to) const {
@@ -100,6 +165,14 @@ TypeCompatibleCode TypeManager::isCompatible(Type from, Type to) const {
     return tccmap.find(pair);
 }
 
+unsigned int TypeManager::getVersion() const {
+    return version;
+}
+
+TCCMapStats TypeManager::getStats() const {
+    return tccmap.stats();
+}
+
 
 int TypeManager::selectOverload(const Type sig[], const Type ovsigs[],
                                 int &selected,
@@ -30,21 +30,37 @@ struct TCCRecord {
     TypeCompatibleCode val;
 };
 
-typedef std::vector<TCCRecord> TCCMapBin;
+struct TCCMapStats {
+    /* Number of records */
+    size_t size;
+    /* Number of slots */
+    size_t capacity;
+    /* Longest and average distance between a record's slot and the slot
+       its hash maps to */
+    size_t max_probe;
+    double mean_probe;
+};
 
+/* An open-addressing hash table (with linear probing) mapping type pairs
+   to their compatibility. */
 class TCCMap {
 public:
     TCCMap();
 
     void insert(const TypePair &key, TypeCompatibleCode val);
     TypeCompatibleCode find(const TypePair &key) const;
+    TCCMapStats stats() const;
 private:
     size_t hash(const TypePair &key) const;
+    void grow();
 
     /* Must be a power of two */
-    static const size_t TCCMAP_SIZE = 512;
-    TCCMapBin records[TCCMAP_SIZE];
-    int nb_records;
+    static const size_t TCCMAP_INITIAL_SIZE = 512;
+    /* Maximum load factor, as a fraction of TCCMAP_LOAD_DENOM */
+    static const size_t TCCMAP_LOAD_NUM = 1;
+    static const size_t TCCMAP_LOAD_DENOM = 2;
+    std::vector<TCCRecord> records;
+    size_t nb_records;
 };
 
 struct Rating {
@@ -61,6 +77,8 @@ struct Rating {
 
 class TypeManager{
 public:
+    TypeManager();
+
     bool canPromote(Type from, Type to) const;
     bool canUnsafeConvert(Type from, Type to) const;
     bool canSafeConvert(Type from, Type to) const;
@@ -72,6 +90,15 @@ public:
 
     TypeCompatibleCode isCompatible(Type from, Type to) const;
 
+    /**
+    Returns
+        A counter incremented whenever a compatibility is added, so that
+        users can invalidate cached overload selections.
+    */
+    unsigned int getVersion() const;
+
+    TCCMapStats getStats() const;
+
     /**
     Output stored in selected.
     Returns
@@ -89,6 +116,7 @@ private:
                         Rating ratings[], int candidates[]) const;
 
     TCCMap tccmap;
+    unsigned int version;
 };
 
 
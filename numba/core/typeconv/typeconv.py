@@ -66,6 +66,15 @@ class TypeManager(object):
     def get_pointer(self):
         return _typeconv.get_pointer(self._ptr)
 
+    def get_stats(self):
+        """
+        Return a dict of statistics about the internal compatibility hash
+        table: number of entries ('size'), number of slots ('capacity'),
+        'load_factor', and the maximum and mean distance of an entry from
+        its ideal slot ('max_probe_length', 'mean_probe_length').
+        """
+        return _typeconv.get_stats(self._ptr)
+
 
 class TypeCastingRules(object):
     """
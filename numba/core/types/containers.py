@@ -882,6 +882,33 @@ class DictIteratorType(SimpleIteratorType):
         super(DictIteratorType, self).__init__(name, yield_type)
 
 
+class ConcurrentDictType(Type):
+    """Concurrent dictionary type, a dictionary sharded into independently
+    locked tables
+    """
+
+    def __init__(self, keyty, valty):
+        assert not isinstance(keyty, TypeRef)
+        assert not isinstance(valty, TypeRef)
+        keyty = unliteral(keyty)
+        valty = unliteral(valty)
+        if isinstance(keyty, (Optional, NoneType)):
+            fmt = "ConcurrentDict.key_type cannot be of type {}"
+            raise TypingError(fmt.format(keyty))
+        if isinstance(valty, (Optional, NoneType)):
+            fmt = "ConcurrentDict.value_type cannot be of type {}"
+            raise TypingError(fmt.format(valty))
+        _sentry_forbidden_types(keyty, valty)
+        self.key_type = keyty
+        self.value_type = valty
+        name = "{}[{},{}]".format(self.__class__.__name__, keyty, valty)
+        super(ConcurrentDictType, self).__init__(name)
+
+    @property
+    def key(self):
+        return self.key_type, self.value_type
+
+
 class StructRef(Type):
     """A mutable struct.
     """
@@ -108,6 +108,10 @@ def _typeof_type(val, c):
     if issubclass(val, Dict):
         return types.TypeRef(types.DictType)
 
+    from numba.typed import ConcurrentDict
+    if issubclass(val, ConcurrentDict):
+        return types.TypeRef(types.ConcurrentDictType)
+
     from numba.typed import List
     if issubclass(val, List):
         return types.TypeRef(types.ListType)
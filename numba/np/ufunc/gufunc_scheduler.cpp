@@ -10,6 +10,9 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdint.h>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
 #include "gufunc_scheduler.h"
 
 #ifdef _MSC_VER
@@ -22,6 +25,28 @@
 // Default 0 value means one evenly-sized chunk of work per worker thread.
 static THREAD_LOCAL(uintp) parallel_chunksize = 0;
 
+// Kind of schedule, one of the NUMBA_SCHEDULE_* values.
+static THREAD_LOCAL(int) parallel_schedule = NUMBA_SCHEDULE_STATIC;
+
+// Set by a parfor right before it launches its schedule, whose entries are
+// chunks already, see get_launch_schedule().
+static THREAD_LOCAL(int) parallel_prechunked = 0;
+
+// Number of divisions per thread of a dynamic schedule without a chunk size.
+#define DYNAMIC_DIVISIONS_PER_THREAD 16
+
+// Largest item size of the arrays of the parfor about to be scheduled, it
+// sizes the tiles of a tiled schedule.
+static THREAD_LOCAL(uintp) tile_itemsize = 8;
+
+// Bounds of a tiled schedule: the tiles keep at least this many bytes
+// contiguous in the last dimension, there are at most this many tiles (the
+// schedule lives on the stack of the launching thread), and the cache size
+// used when it cannot be queried.
+#define TILE_MIN_INNER_BYTES 512
+#define TILE_MAX_TILES 4096
+#define TILE_DEFAULT_CACHE_SIZE (256 * 1024)
+
 // round not available on VS2010.
 double guround (double number) {
 	return number < 0.0 ? ceil(number - 0.5) : floor(number + 0.5);
@@ -110,13 +135,230 @@ extern "C" uintp get_parallel_chunksize() {
     return parallel_chunksize;
 }
 
-extern "C" uintp get_sched_size(uintp num_threads, uintp num_dim, intp *starts, intp *ends) {
-    if (parallel_chunksize == 0) {
-        return num_threads;
+extern "C" int set_parallel_schedule(int kind) {
+    int orig = parallel_schedule;
+    parallel_schedule = kind;
+    return orig;
+}
+
+extern "C" int get_parallel_schedule() {
+    return parallel_schedule;
+}
+
+extern "C" void set_parallel_tile_itemsize(uintp n) {
+    tile_itemsize = n ? n : 1;
+}
+
+extern "C" void set_parallel_prechunked() {
+    parallel_prechunked = 1;
+}
+
+/*
+ * Returns the kind of schedule of a parallel_for() of `total` entries on
+ * num_threads threads launched by the calling thread, and sets *grain to the
+ * number of entries of its chunks: the chunk size, or without one as many
+ * as make DYNAMIC_DIVISIONS_PER_THREAD chunks per thread, as get_sched_size()
+ * does for a parfor (a guided schedule shrinks its chunks down to that
+ * size).  The entries of a launch marked by
+ * set_parallel_prechunked() are the chunks of a parfor schedule of that kind
+ * already, so they are handed out one at a time, as a dynamic schedule does,
+ * rather than split again; guided chunks in particular do not shrink twice.
+ * The mark only applies to the next launch, not to those of its kernel.
+ */
+extern "C" int get_launch_schedule(uintp total, uintp num_threads, uintp *grain) {
+    if (parallel_prechunked) {
+        parallel_prechunked = 0;
+        *grain = 1;
+        if (parallel_schedule == NUMBA_SCHEDULE_GUIDED) {
+            return NUMBA_SCHEDULE_DYNAMIC;
+        }
+        return parallel_schedule;
+    }
+    if (parallel_chunksize) {
+        *grain = parallel_chunksize;
+    } else {
+        uintp divisions = num_threads * DYNAMIC_DIVISIONS_PER_THREAD;
+        *grain = divisions ? (total + divisions - 1) / divisions : 1;
+        if (*grain == 0) {
+            *grain = 1;
+        }
+    }
+    return parallel_schedule;
+}
+
+/*
+ * Size in bytes of the L2 cache of a core.
+ */
+static uintp l2_cache_size() {
+    // Racy but every thread computes the same value
+    static uintp size = 0;
+    if (size == 0) {
+        long s = 0;
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+        s = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        size = s > 0 ? (uintp)s : TILE_DEFAULT_CACHE_SIZE;
     }
+    return size;
+}
+
+/*
+ * Number of iterations of a tile of a tiled schedule: the chunk size if set,
+ * otherwise as many items as fill half of the L2 cache, leaving room for the
+ * other arrays and neighbours a stencil touches.
+ */
+static uintp tile_budget() {
+    if (parallel_chunksize) {
+        return parallel_chunksize;
+    }
+    uintp budget = l2_cache_size() / (2 * tile_itemsize);
+    return budget ? budget : 1;
+}
+
+/*
+ * Number of tiles of the given shape covering the iteration space.
+ */
+static uintp tile_count(const std::vector<intp> &ipd, const std::vector<intp> &tile) {
+    uintp count = 1;
+    for(uintp i = 0; i < ipd.size(); ++i) {
+        count *= ipd[i] > 0 ? (ipd[i] + tile[i] - 1) / tile[i] : 0;
+    }
+    return count;
+}
+
+/*
+ * Shape of the tiles of a tiled schedule.  Starting from the whole space,
+ * the longest side of the tile is halved until the tile fits in the budget,
+ * keeping the last (contiguous) dimension at least TILE_MIN_INNER_BYTES
+ * long while the other dimensions can still be cut.  The tiles are then cut
+ * further until each thread has one, and grown back if there are too many.
+ */
+static std::vector<intp> tile_shape(const std::vector<intp> &ipd, uintp num_threads, uintp budget) {
+    uintp ndim = ipd.size();
+    std::vector<intp> tile(ndim);
+    uintp size = 1;
+    for(uintp i = 0; i < ndim; ++i) {
+        tile[i] = ipd[i] > 1 ? ipd[i] : 1;
+        size *= tile[i];
+    }
+    intp min_inner = TILE_MIN_INNER_BYTES / tile_itemsize;
+    if (min_inner < 1) {
+        min_inner = 1;
+    }
+
+    // Index of the side to halve next, or -1 if the tile is a single item
+    auto longest = [&](bool spare_inner) -> intp {
+        intp dim = -1;
+        for(uintp i = 0; i < ndim; ++i) {
+            bool inner = i == ndim - 1;
+            if (tile[i] <= 1 || (spare_inner && inner && tile[i] / 2 < min_inner)) {
+                continue;
+            }
+            if (dim < 0 || tile[i] > tile[dim]) {
+                dim = i;
+            }
+        }
+        if (dim < 0 && spare_inner && tile[ndim - 1] > 1) {
+            dim = ndim - 1;
+        }
+        return dim;
+    };
+
+    while (size > budget || tile_count(ipd, tile) < num_threads) {
+        intp dim = longest(true);
+        if (dim < 0) {
+            break;
+        }
+        size /= tile[dim];
+        tile[dim] = (tile[dim] + 1) / 2;
+        size *= tile[dim];
+    }
+    while (tile_count(ipd, tile) > TILE_MAX_TILES) {
+        // Double the side that is the smallest share of its dimension
+        intp dim = -1;
+        for(uintp i = 0; i < ndim; ++i) {
+            if (tile[i] < ipd[i] && (dim < 0 || tile[i] * ipd[dim] < tile[dim] * ipd[i])) {
+                dim = i;
+            }
+        }
+        tile[dim] *= 2;
+    }
+    return tile;
+}
+
+/*
+ * Size of the next chunk of a guided schedule: a share of the remaining
+ * iterations that shrinks as they run out, but no less than min_chunk.
+ */
+extern "C" uintp guided_chunk(uintp remaining, uintp num_threads, uintp min_chunk) {
+    uintp len = (remaining + 2 * num_threads - 1) / (2 * num_threads);
+    if (len < min_chunk) {
+        len = min_chunk;
+    }
+    return len < remaining ? len : remaining;
+}
+
+/*
+ * Number of chunks of a guided schedule of len iterations.
+ */
+static uintp guided_size(uintp len, uintp num_threads, uintp min_chunk) {
+    uintp count = 0;
+    while (len > 0) {
+        len -= guided_chunk(len, num_threads, min_chunk);
+        ++count;
+    }
+    return count;
+}
+
+/*
+ * Index of the dimension a guided schedule splits, the longest one.
+ */
+static uintp guided_dim(const std::vector<intp> &ipd) {
+    uintp dim = 0;
+    for(uintp i = 1; i < ipd.size(); ++i) {
+        if (ipd[i] > ipd[dim]) {
+            dim = i;
+        }
+    }
+    return dim;
+}
+
+/*
+ * Returns the number of chunks of the schedule of the current kind and, if
+ * params is not NULL, fills its NUMBA_SCHED_PARAMS entries with what
+ * do_scheduling_*() needs to compute that schedule.
+ */
+extern "C" uintp get_sched_size(uintp num_threads, uintp num_dim, intp *starts, intp *ends, uintp *params) {
     RangeActual ra(num_dim, starts, ends);
-    uintp total_work_size = ra.total_size();
-    uintp num_divisions = total_work_size / parallel_chunksize;
+    uintp num_divisions;
+    uintp size = 0;
+    if (parallel_schedule == NUMBA_SCHEDULE_GUIDED) {
+        std::vector<intp> ipd = ra.iters_per_dim();
+        size = parallel_chunksize ? parallel_chunksize : 1;
+        num_divisions = guided_size(ipd[guided_dim(ipd)], num_threads, size);
+    } else if (parallel_schedule == NUMBA_SCHEDULE_TILED) {
+        std::vector<intp> ipd = ra.iters_per_dim();
+        size = tile_budget();
+        num_divisions = tile_count(ipd, tile_shape(ipd, num_threads, size));
+    } else if (parallel_chunksize == 0) {
+        if (parallel_schedule != NUMBA_SCHEDULE_DYNAMIC) {
+            num_divisions = num_threads;
+        } else {
+            uintp total_work_size = ra.total_size();
+            num_divisions = num_threads * DYNAMIC_DIVISIONS_PER_THREAD;
+            if (num_divisions > total_work_size) {
+                num_divisions = total_work_size;
+            }
+        }
+    } else {
+        uintp total_work_size = ra.total_size();
+        num_divisions = total_work_size / parallel_chunksize;
+    }
+    if (params) {
+        params[NUMBA_SCHED_PARAM_KIND] = parallel_schedule;
+        params[NUMBA_SCHED_PARAM_THREADS] = num_threads;
+        params[NUMBA_SCHED_PARAM_SIZE] = size;
+    }
     return num_divisions < num_threads ? num_threads : num_divisions;
 }
 
@@ -376,6 +618,108 @@ std::vector<RangeActual> create_schedule(const RangeActual &full_space, uintp nu
     }
 }
 
+/*
+ * Computes a guided schedule of num_sched chunks: the longest dimension is
+ * cut into chunks that shrink towards the end of the iteration space, each
+ * spanning the whole of the other dimensions.  Falls back to a static
+ * schedule if num_sched was not sized by get_sched_size().
+ */
+std::vector<RangeActual> create_guided_schedule(const RangeActual &full_space, uintp num_sched, uintp num_threads, uintp min_chunk) {
+    std::vector<intp> ipd = full_space.iters_per_dim();
+    uintp dim = guided_dim(ipd);
+    uintp len = ipd[dim];
+    if (num_threads == 0 || min_chunk == 0) {
+        return create_schedule(full_space, num_sched);
+    }
+    // get_sched_size() gives at least one chunk per thread
+    uintp count = guided_size(len, num_threads, min_chunk);
+    if ((count < num_threads ? num_threads : count) != num_sched) {
+        return create_schedule(full_space, num_sched);
+    }
+
+    std::vector<RangeActual> ret;
+    intp cur = full_space.start[dim];
+    uintp remaining = len;
+    while (remaining > 0) {
+        uintp ilen = guided_chunk(remaining, num_threads, min_chunk);
+        RangeActual ra(full_space.start, full_space.end);
+        ra.start[dim] = cur;
+        ra.end[dim] = cur + ilen - 1;
+        ret.push_back(ra);
+        cur += ilen;
+        remaining -= ilen;
+    }
+    // Pad with empty chunks up to one per thread
+    std::vector<intp> empty_start(full_space.ndim(), 1), empty_end(full_space.ndim(), 0);
+    while (ret.size() < num_sched) {
+        ret.push_back(RangeActual(empty_start, empty_end));
+    }
+    return ret;
+}
+
+/*
+ * Computes a tiled schedule of num_sched tiles: the iteration space is cut
+ * into tiles of tile_shape(), listed with the last dimension varying fastest
+ * so that consecutive tiles, which the threading layers hand to the same
+ * thread, are neighbours.  Falls back to a static schedule if num_sched was
+ * not sized by get_sched_size().
+ */
+std::vector<RangeActual> create_tiled_schedule(const RangeActual &full_space, uintp num_sched, uintp num_threads, uintp budget) {
+    std::vector<intp> ipd = full_space.iters_per_dim();
+    if (num_threads == 0) {
+        return create_schedule(full_space, num_sched);
+    }
+    std::vector<intp> tile = tile_shape(ipd, num_threads, budget);
+    uintp count = tile_count(ipd, tile);
+    if ((count < num_threads ? num_threads : count) != num_sched) {
+        return create_schedule(full_space, num_sched);
+    }
+
+    std::vector<RangeActual> ret;
+    uintp ndim = ipd.size();
+    std::vector<intp> start(full_space.start), end(ndim);
+    while (ret.size() < count) {
+        for(uintp i = 0; i < ndim; ++i) {
+            end[i] = std::min(start[i] + tile[i] - 1, full_space.end[i]);
+        }
+        ret.push_back(RangeActual(start, end));
+        // Step to the next tile, carrying into the outer dimensions
+        for(uintp i = ndim; i-- > 0;) {
+            start[i] += tile[i];
+            if (start[i] <= full_space.end[i] || i == 0) {
+                break;
+            }
+            start[i] = full_space.start[i];
+        }
+    }
+    // Pad with empty tiles up to one per thread
+    std::vector<intp> empty_start(ndim, 1), empty_end(ndim, 0);
+    while (ret.size() < num_sched) {
+        ret.push_back(RangeActual(empty_start, empty_end));
+    }
+    return ret;
+}
+
+/*
+ * Computes the schedule described by the params of get_sched_size(), or a
+ * static one if there are none.
+ */
+std::vector<RangeActual> create_schedule_of_kind(const RangeActual &full_space, uintp num_sched, const uintp *params) {
+    if (params == NULL) {
+        return create_schedule(full_space, num_sched);
+    }
+    uintp num_threads = params[NUMBA_SCHED_PARAM_THREADS];
+    uintp size = params[NUMBA_SCHED_PARAM_SIZE];
+    switch (params[NUMBA_SCHED_PARAM_KIND]) {
+        case NUMBA_SCHEDULE_GUIDED:
+            return create_guided_schedule(full_space, num_sched, num_threads, size);
+        case NUMBA_SCHEDULE_TILED:
+            return create_tiled_schedule(full_space, num_sched, num_threads, size);
+        default:
+            return create_schedule(full_space, num_sched);
+    }
+}
+
 /*
  *   Print the calculated schedule when in debug mode.
  */
@@ -395,8 +739,9 @@ void print_schedule(const std::vector<RangeActual> &vra) {
     num_threads is the number (N) of chunks to break the iteration space into
     sched is pre-allocated memory for the schedule to be stored in and is of size NxD.
     debug is non-zero if DEBUG_ARRAY_OPT is turned on.
+    params are the parameters filled by get_sched_size(), or NULL for a static schedule.
 */
-extern "C" void do_scheduling_signed(uintp num_dim, intp *starts, intp *ends, uintp num_threads, intp *sched, intp debug) {
+extern "C" void do_scheduling_signed(uintp num_dim, intp *starts, intp *ends, uintp num_threads, intp *sched, intp debug, const uintp *params) {
     if (debug) {
         printf("do_scheduling_signed\n");
         printf("num_dim = %d\n", (int)num_dim);
@@ -411,14 +756,14 @@ extern "C" void do_scheduling_signed(uintp num_dim, intp *starts, intp *ends, ui
     if (num_threads == 0) return;
 
     RangeActual full_space(num_dim, starts, ends);
-    std::vector<RangeActual> ret = create_schedule(full_space, num_threads);
+    std::vector<RangeActual> ret = create_schedule_of_kind(full_space, num_threads, params);
     if (debug) {
         print_schedule(ret);
     }
     flatten_schedule(ret, sched);
 }
 
-extern "C" void do_scheduling_unsigned(uintp num_dim, intp *starts, intp *ends, uintp num_threads, uintp *sched, intp debug) {
+extern "C" void do_scheduling_unsigned(uintp num_dim, intp *starts, intp *ends, uintp num_threads, uintp *sched, intp debug, const uintp *params) {
     if (debug) {
         printf("do_scheduling_unsigned\n");
         printf("num_dim = %d\n", (int)num_dim);
@@ -433,7 +778,7 @@ extern "C" void do_scheduling_unsigned(uintp num_dim, intp *starts, intp *ends,
     if (num_threads == 0) return;
 
     RangeActual full_space(num_dim, starts, ends);
-    std::vector<RangeActual> ret = create_schedule(full_space, num_threads);
+    std::vector<RangeActual> ret = create_schedule_of_kind(full_space, num_threads, params);
     if (debug) {
         print_schedule(ret);
     }
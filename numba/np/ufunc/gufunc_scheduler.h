@@ -33,16 +33,34 @@
     #define uintp unsigned
 #endif
 
+/* Kinds of schedule of set_parallel_schedule() */
+#define NUMBA_SCHEDULE_STATIC  0  /* one equal chunk per thread */
+#define NUMBA_SCHEDULE_DYNAMIC 1  /* equal chunks handed out on demand */
+#define NUMBA_SCHEDULE_GUIDED  2  /* chunks shrinking towards the end */
+#define NUMBA_SCHEDULE_TILED   3  /* cache-sized tiles of all dimensions */
+
+/* Parameters of a schedule, filled by get_sched_size() for do_scheduling_*() */
+#define NUMBA_SCHED_PARAM_KIND    0  /* kind of schedule */
+#define NUMBA_SCHED_PARAM_THREADS 1  /* number of threads it was sized for */
+#define NUMBA_SCHED_PARAM_SIZE    2  /* guided: minimum chunk, tiled: budget */
+#define NUMBA_SCHED_PARAMS        3
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-void do_scheduling_signed(uintp num_dim, intp *starts, intp *ends, uintp num_threads, intp *sched, intp debug);
-void do_scheduling_unsigned(uintp num_dim, intp *starts, intp *ends, uintp num_threads, uintp *sched, intp debug);
+void do_scheduling_signed(uintp num_dim, intp *starts, intp *ends, uintp num_threads, intp *sched, intp debug, const uintp *params);
+void do_scheduling_unsigned(uintp num_dim, intp *starts, intp *ends, uintp num_threads, uintp *sched, intp debug, const uintp *params);
 uintp set_parallel_chunksize(uintp);
 uintp get_parallel_chunksize(void);
-uintp get_sched_size(uintp num_threads, uintp num_dim, intp *starts, intp *ends);
+uintp get_sched_size(uintp num_threads, uintp num_dim, intp *starts, intp *ends, uintp *params);
+int set_parallel_schedule(int);
+int get_parallel_schedule(void);
+void set_parallel_tile_itemsize(uintp);
+void set_parallel_prechunked(void);
+int get_launch_schedule(uintp total, uintp num_threads, uintp *grain);
+uintp guided_chunk(uintp remaining, uintp num_threads, uintp min_chunk);
 
 #ifdef __cplusplus
 }
@@ -14,6 +14,9 @@ Threading layer on top of OpenMP.
 #include <stdio.h>
 #include "workqueue.h"
 #include "gufunc_scheduler.h"
+#include "thread_affinity.h"
+#include "parallel_async.h"
+#include "parallel_profile.h"
 
 #ifdef _MSC_VER
 #include <malloc.h>
@@ -152,10 +155,58 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
         printf("\n");
     }
 
+    // Kind of schedule of this thread, OpenMP 2 (MSVC) has no
+    // omp_set_schedule() so it always runs a static schedule
+    uintp grain;
+    int kind = get_launch_schedule(size, num_threads, &grain);
+
+#if _OPENMP >= 200805
+    // The `omp for` below has a runtime schedule, map the schedule kind of
+    // this thread on it for the duration of the region. OpenMP hands out the
+    // chunks made below one at a time, or shrinking runs of them if guided.
+    omp_sched_t old_kind;
+    int old_chunk;
+    omp_get_schedule(&old_kind, &old_chunk);
+    switch (kind)
+    {
+        case NUMBA_SCHEDULE_DYNAMIC:
+            omp_set_schedule(omp_sched_dynamic, 1);
+            break;
+        case NUMBA_SCHEDULE_GUIDED:
+            omp_set_schedule(omp_sched_guided, 1);
+            break;
+        default:
+            omp_set_schedule(omp_sched_static, 0);
+            break;
+    }
+#else
+    kind = NUMBA_SCHEDULE_STATIC;
+#endif
+
+    // The loop below runs over chunks rather than iterations: chunks of the
+    // grain (single entries of a parfor schedule) for the dynamic and guided
+    // kinds, and one even chunk per thread otherwise.
+    ptrdiff_t nchunks, count, remain;
+    if (kind == NUMBA_SCHEDULE_DYNAMIC || kind == NUMBA_SCHEDULE_GUIDED)
+    {
+        count = (ptrdiff_t)grain;
+        nchunks = (size + count - 1) / count;
+        remain = 0;
+    }
+    else
+    {
+        nchunks = size < num_threads ? size : num_threads;
+        count = nchunks ? size / nchunks : 0;
+        remain = nchunks ? size % nchunks : 0;
+    }
+
+    // Workers are identified by their thread number in the team
+    void *profile = profile_region_begin(fn, num_threads);
+
     // Set the thread mask on the pragma such that the state is scope limited
     // and passed via a register on the OMP region call site, this limiting
     // global state and racing
-    #pragma omp parallel num_threads(num_threads), shared(agreed_nthreads)
+    #pragma omp parallel num_threads(num_threads), shared(agreed_nthreads, profile)
     {
         size_t * count_space = (size_t *)alloca(sizeof(size_t) * arg_len);
         char ** array_arg_space = (char**)alloca(sizeof(char*) * array_count);
@@ -163,11 +214,18 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
         // tell the active thread team about the number of threads
         set_num_threads(agreed_nthreads);
 
-        #pragma omp for
-        for(ptrdiff_t r = 0; r < size; r++)
+        // Pin the workers of the outermost team to the CPU of their thread
+        // number, nested teams reuse the IDs so are left alone, as is the
+        // launching thread
+        int tid = omp_get_thread_num();
+        if (tid != 0 && omp_get_level() == 1)
+            pin_current_thread(tid);
+
+        // Call the kernel once on the outer iterations [begin, end)
+        auto run_range = [&](ptrdiff_t begin, ptrdiff_t end)
         {
             memcpy(count_space, dimensions, arg_len * sizeof(size_t));
-            count_space[0] = 1;
+            count_space[0] = end - begin;
 
             if(_DEBUG)
             {
@@ -181,7 +239,7 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
             {
                 char * base = args[j];
                 size_t step = steps[j];
-                ptrdiff_t offset = step * r;
+                ptrdiff_t offset = step * begin;
                 array_arg_space[j] = base + offset;
 
                 if(0&&_DEBUG)
@@ -201,9 +259,48 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
                     printf("%p, ", (void *)array_arg_space[j]);
                 printf("\n");
             }
-            func(array_arg_space, count_space, steps, data);
+            if (profile)
+            {
+                uint64_t start = profile_now();
+                func(array_arg_space, count_space, steps, data);
+                profile_chunk(profile, tid, start, profile_now());
+            }
+            else
+            {
+                func(array_arg_space, count_space, steps, data);
+            }
+        };
+
+        // Each chunk is run as soon as it is handed to this thread, so that
+        // under a dynamic or guided schedule the other threads can still take
+        // the chunks that follow it.
+#if _OPENMP >= 200805
+        #pragma omp for schedule(runtime) nowait
+#else
+        #pragma omp for nowait
+#endif
+        for(ptrdiff_t c = 0; c < nchunks; c++)
+        {
+            ptrdiff_t begin = c * count + (c < remain ? c : remain);
+            ptrdiff_t end = begin + count + (c < remain ? 1 : 0);
+            run_range(begin, end < size ? end : size);
         }
     }
+    profile_region_end(profile);
+
+#if _OPENMP >= 200805
+    omp_set_schedule(old_kind, old_chunk);
+#endif
+}
+
+static void *
+parallel_for_async(void *fn, char **args, size_t *dimensions, size_t *steps,
+                   void *data, size_t inner_ndim, size_t array_count,
+                   size_t steps_count, int num_threads)
+{
+    return submit_parallel_for(parallel_for, fn, args, dimensions, steps,
+                               data, inner_ndim, array_count, steps_count,
+                               num_threads);
 }
 
 static void launch_threads(int count)
@@ -248,6 +345,9 @@ MOD_INIT(omppool)
     SetAttrStringFromVoidPointer(m, ready);
     SetAttrStringFromVoidPointer(m, add_task);
     SetAttrStringFromVoidPointer(m, parallel_for);
+    SetAttrStringFromVoidPointer(m, parallel_for_async);
+    SetAttrStringFromVoidPointer(m, parallel_for_poll);
+    SetAttrStringFromVoidPointer(m, parallel_for_wait);
     SetAttrStringFromVoidPointer(m, do_scheduling_signed);
     SetAttrStringFromVoidPointer(m, do_scheduling_unsigned);
     SetAttrStringFromVoidPointer(m, set_num_threads);
@@ -256,6 +356,13 @@ MOD_INIT(omppool)
     SetAttrStringFromVoidPointer(m, set_parallel_chunksize);
     SetAttrStringFromVoidPointer(m, get_parallel_chunksize);
     SetAttrStringFromVoidPointer(m, get_sched_size);
+    SetAttrStringFromVoidPointer(m, set_parallel_schedule);
+    SetAttrStringFromVoidPointer(m, get_parallel_schedule);
+    SetAttrStringFromVoidPointer(m, set_parallel_tile_itemsize);
+    SetAttrStringFromVoidPointer(m, set_parallel_prechunked);
+    SetAttrStringFromVoidPointer(m, set_parallel_profiling);
+    SetAttrStringFromVoidPointer(m, read_parallel_profile);
+    SetAttrStringFromVoidPointer(m, set_thread_affinity);
 
     PyObject *tmp = PyString_FromString(_OMP_VENDOR);
     PyObject_SetAttrString(m, "openmp_vendor", tmp);
@@ -10,11 +10,16 @@ UFuncCore also defines a work-stealing mechanism that allows idle threads
 to steal works from other threads.
 """
 
+import json
 import os
 import sys
 import warnings
+import weakref
+from collections import namedtuple
+from concurrent.futures import ThreadPoolExecutor
 from threading import RLock as threadRLock
-from ctypes import CFUNCTYPE, c_int, CDLL, POINTER, c_uint
+from ctypes import (CFUNCTYPE, c_int, CDLL, POINTER, c_uint, c_size_t,
+                    c_uint64, c_void_p)
 
 import numpy as np
 
@@ -203,6 +208,7 @@ def build_ufunc_wrapper(library, ctx, fname, signature, cres):
                                                  cres=cres)
     info = build_gufunc_kernel(library, ctx, innerfunc, signature,
                                len(signature.args))
+    _register_profiled_kernel(innerfunc, cres.fndesc.qualname)
     return info
 
 # ---------------------------------------------------------------------------
@@ -270,6 +276,7 @@ def build_gufunc_wrapper(py_func, cres, sin, sout, cache, is_parfors):
     info = build_gufunc_kernel(
         library, ctx, innerinfo, signature, inner_ndim,
     )
+    _register_profiled_kernel(innerinfo, cres.fndesc.qualname)
     return info
 
 # ---------------------------------------------------------------------------
@@ -341,6 +348,19 @@ def threading_layer():
         return _threading_layer
 
 
+def _get_nested_launches():
+    """
+    Get the number of parallel regions the workqueue threading layer ran
+    serially because another region was already running, i.e. regions nested
+    in another one or launched concurrently from another thread.  Always 0 for
+    the other threading layers, which run nested regions in parallel.
+    """
+    if _threading_layer != 'workqueue':
+        return 0
+    from numba.np.ufunc import workqueue
+    return CFUNCTYPE(c_size_t)(workqueue.get_nested_launches)()
+
+
 def _check_tbb_version_compatible():
     """
     Checks that if TBB is present it is of a compatible version.
@@ -375,6 +395,96 @@ def _check_tbb_version_compatible():
         raise ImportError("Problem with TBB. Reason: %s" % e)
 
 
+def _parse_cpu_list(spec):
+    """
+    Parses a list of CPUs such as '0-3,8,10-11' into a list of ints.
+    """
+    cpus = []
+    for item in spec.split(','):
+        lo, sep, hi = item.strip().partition('-')
+        try:
+            lo = int(lo)
+            hi = int(hi) if sep else lo
+        except ValueError:
+            lo = hi = -1
+        if lo < 0 or hi < lo:
+            msg = "Invalid CPU list in NUMBA_THREAD_AFFINITY: %r" % spec
+            raise ValueError(msg)
+        cpus.extend(range(lo, hi + 1))
+    return cpus
+
+
+def _cpu_topology(cpus):
+    """
+    Returns a dict mapping each CPU to its (package, core) pair.  Outside of
+    Linux every CPU is reported as its own core of a single package.
+    """
+    topology = {}
+    for cpu in cpus:
+        path = '/sys/devices/system/cpu/cpu%d/topology/' % cpu
+        try:
+            with open(path + 'physical_package_id') as f:
+                package = int(f.read())
+            with open(path + 'core_id') as f:
+                core = int(f.read())
+        except (OSError, ValueError):
+            package, core = 0, cpu
+        topology[cpu] = (package, core)
+    return topology
+
+
+def _order_cpus(kind, topology):
+    """
+    Orders the CPUs of `topology` for consecutive thread IDs: 'compact' fills
+    the hardware threads of a core, then the cores of a package, before moving
+    on; 'scatter' spreads consecutive IDs over the packages, then over the
+    cores, before doubling up on a core.
+    """
+    compact = sorted(topology, key=lambda cpu: (topology[cpu], cpu))
+    if kind == 'compact':
+        return compact
+    # rank each CPU amongst its core's hardware threads and each core amongst
+    # its package's cores, then take the first thread of every core of every
+    # package round-robin
+    packages = sorted({package for package, _ in topology.values()})
+    thread_rank, core_rank, seen = {}, {}, {}
+    for cpu in compact:
+        package, core = topology[cpu]
+        cores = seen.setdefault(package, {})
+        threads = cores.setdefault(core, [])
+        thread_rank[cpu] = len(threads)
+        core_rank[cpu] = list(cores).index(core)
+        threads.append(cpu)
+    return sorted(compact, key=lambda cpu: (thread_rank[cpu], core_rank[cpu],
+                                            packages.index(topology[cpu][0])))
+
+
+def _get_thread_affinity(setting, count):
+    """
+    Resolves the NUMBA_THREAD_AFFINITY `setting` into the CPU of each of the
+    `count` thread IDs, or None if the threads are not to be pinned.
+    """
+    setting = setting.strip().lower()
+    if not setting:
+        return None
+    if hasattr(os, 'sched_getaffinity'):
+        available = sorted(os.sched_getaffinity(0))
+    else:
+        available = list(range(os.cpu_count() or 1))
+    if setting in ('compact', 'scatter'):
+        cpus = _order_cpus(setting, _cpu_topology(available))
+    else:
+        cpus = _parse_cpu_list(setting)
+        # the workers could not be pinned to these, fail rather than leave
+        # them where the operating system put them
+        unavailable = sorted(set(cpus).difference(available))
+        if unavailable:
+            msg = ("CPUs %s in NUMBA_THREAD_AFFINITY are not available to "
+                   "this process" % ','.join(map(str, unavailable)))
+            raise ValueError(msg)
+    return [cpus[i % len(cpus)] for i in range(count)]
+
+
 def _launch_threads():
     if not _backend_init_process_lock:
         _set_init_process_lock()
@@ -515,11 +625,23 @@ def _launch_threads():
             ll.add_symbol('do_scheduling_signed', lib.do_scheduling_signed)
             ll.add_symbol('do_scheduling_unsigned', lib.do_scheduling_unsigned)
 
+            cpus = _get_thread_affinity(config.THREAD_AFFINITY, NUM_THREADS)
+            if cpus is not None:
+                set_thread_affinity = CFUNCTYPE(c_int, c_int, POINTER(c_int))(
+                    lib.set_thread_affinity)
+                if set_thread_affinity(len(cpus), (c_int * len(cpus))(*cpus)):
+                    raise MemoryError("Cannot set NUMBA_THREAD_AFFINITY")
+
             launch_threads = CFUNCTYPE(None, c_int)(lib.launch_threads)
             launch_threads(NUM_THREADS)
 
             _load_threading_functions(lib)  # load late
 
+            if config.PARALLEL_PROFILE:
+                global _parallel_profiling
+                _parallel_profiling = True
+                _set_parallel_profiling(1)
+
             # set library name so it can be queried
             global _threading_layer
             _threading_layer = libname
@@ -545,6 +667,9 @@ def _load_threading_functions(lib):
     ll.add_symbol('set_parallel_chunksize', lib.set_parallel_chunksize)
     ll.add_symbol('get_parallel_chunksize', lib.get_parallel_chunksize)
     ll.add_symbol('get_sched_size', lib.get_sched_size)
+    ll.add_symbol('set_parallel_tile_itemsize',
+                  lib.set_parallel_tile_itemsize)
+    ll.add_symbol('set_parallel_prechunked', lib.set_parallel_prechunked)
     global _set_parallel_chunksize
     _set_parallel_chunksize = CFUNCTYPE(c_uint,
                                         c_uint)(lib.set_parallel_chunksize)
@@ -555,7 +680,23 @@ def _load_threading_functions(lib):
                                 c_uint,
                                 c_uint,
                                 POINTER(c_int),
-                                POINTER(c_int))(lib.get_sched_size)
+                                POINTER(c_int),
+                                c_void_p)(lib.get_sched_size)
+
+    global _set_parallel_schedule
+    _set_parallel_schedule = CFUNCTYPE(c_int,
+                                       c_int)(lib.set_parallel_schedule)
+    global _get_parallel_schedule
+    _get_parallel_schedule = CFUNCTYPE(c_int)(lib.get_parallel_schedule)
+
+    global _set_parallel_profiling
+    _set_parallel_profiling = CFUNCTYPE(c_int,
+                                        c_int)(lib.set_parallel_profiling)
+    global _read_parallel_profile
+    _read_parallel_profile = CFUNCTYPE(c_size_t,
+                                       POINTER(c_uint64),
+                                       c_size_t,
+                                       c_int)(lib.read_parallel_profile)
 
 
 # Some helpers to make set_num_threads jittable
@@ -756,3 +897,315 @@ def ol_get_parallel_chunksize():
     def impl():
         return _get_parallel_chunksize()
     return impl
+
+
+# The kinds of schedule, indexed by their NUMBA_SCHEDULE_* value
+_SCHEDULE_KINDS = ('static', 'dynamic', 'guided', 'tiled')
+
+
+def set_parallel_schedule(kind):
+    """
+    Set the kind of schedule of the parallel regions launched by the calling
+    thread and return the previous one.
+
+    - ``'static'`` (the default) divides the iterations of a parfor into one
+      chunk per thread, or into chunks of the parallel chunk size if one is
+      set.
+    - ``'dynamic'`` divides them into equal chunks of the parallel chunk size
+      (by default 16 chunks per thread) that the threads take one at a time.
+    - ``'guided'`` divides them into chunks that shrink as the iterations run
+      out, down to the parallel chunk size (by default 1 for a parfor, and
+      the size of the chunks of a dynamic schedule for a parallel gufunc),
+      that the threads take one at a time.
+    - ``'tiled'`` divides the iteration space of a parfor into tiles over all
+      of its dimensions, of the parallel chunk size iterations (by default
+      as many items of its arrays as fill half of the L2 cache), that the
+      threads take in runs of neighbouring tiles.
+
+    This function can be used inside of a jitted function.
+    """
+    _launch_threads()
+    if kind not in _SCHEDULE_KINDS:
+        raise ValueError("The parallel schedule must be one of %s"
+                         % (_SCHEDULE_KINDS,))
+    return _SCHEDULE_KINDS[_set_parallel_schedule(_SCHEDULE_KINDS.index(kind))]
+
+
+def get_parallel_schedule():
+    """
+    Get the kind of schedule of the parallel regions launched by the calling
+    thread, see :func:`set_parallel_schedule`.
+
+    This function can be used inside of a jitted function.
+    """
+    _launch_threads()
+    return _SCHEDULE_KINDS[_get_parallel_schedule()]
+
+
+@overload(set_parallel_schedule)
+def ol_set_parallel_schedule(kind):
+    _launch_threads()
+    if not isinstance(kind, (types.UnicodeType, types.StringLiteral)):
+        msg = "The parallel schedule must be a string"
+        raise errors.TypingError(msg)
+
+    def impl(kind):
+        for i in range(len(_SCHEDULE_KINDS)):
+            if _SCHEDULE_KINDS[i] == kind:
+                return _SCHEDULE_KINDS[_set_parallel_schedule(i)]
+        raise ValueError("The parallel schedule must be one of "
+                         "'static', 'dynamic', 'guided' or 'tiled'")
+    return impl
+
+
+@overload(get_parallel_schedule)
+def ol_get_parallel_schedule():
+    _launch_threads()
+
+    def impl():
+        return _SCHEDULE_KINDS[_get_parallel_schedule()]
+    return impl
+
+
+# Runs the calls of submit_parallel(), created on first use
+_submit_executor = None
+_submit_lock = threadRLock()
+
+# The nogil copies of the jitted functions given to submit_parallel()
+_nogil_dispatchers = weakref.WeakKeyDictionary()
+
+
+def _get_nogil_dispatcher(func):
+    """
+    Returns `func`, or a copy of it compiled with nogil=True if it holds the
+    GIL.
+    """
+    if func.targetoptions.get('nogil'):
+        return func
+    with _submit_lock:
+        nogil_func = _nogil_dispatchers.get(func)
+        if nogil_func is None:
+            from numba.core.decorators import jit
+            options = dict(func.targetoptions, nogil=True)
+            nogil_func = jit(locals=func.locals, **options)(func.py_func)
+            _nogil_dispatchers[func] = nogil_func
+        return nogil_func
+
+
+def submit_parallel(func, *args, **kwargs):
+    """
+    Call the jitted function `func` with the given arguments without waiting
+    for it, and return a :class:`concurrent.futures.Future` of its result.
+
+    The call runs on a helper thread with the GIL released, so the calling
+    thread can carry on running Python code while the threading layer runs
+    the parallel regions of `func`.  If `func` is not compiled with
+    ``nogil=True`` a copy of it that is gets compiled on first use.  The
+    arguments must not be modified until the future is done.
+    """
+    from numba.core.dispatcher import Dispatcher
+    if not isinstance(func, Dispatcher):
+        raise TypeError("submit_parallel() requires a jitted function, got %r"
+                        % (func,))
+    # Start the threading layer here rather than on the helper thread
+    _launch_threads()
+    nogil_func = _get_nogil_dispatcher(func)
+    global _submit_executor
+    with _submit_lock:
+        if _submit_executor is None:
+            _submit_executor = ThreadPoolExecutor(
+                thread_name_prefix='numba-submit')
+    return _submit_executor.submit(nogil_func, *args, **kwargs)
+
+
+# ---------------------------------------------------------------------------
+# Instrumentation of the parallel regions
+
+# Words of a record of the profile log before its per-worker part, and per
+# worker, see parallel_profile.h
+_PROFILE_HEADER = 4
+_PROFILE_WORKER = 4
+
+# The gufunc kernels whose address is not resolved yet, as (library, symbol,
+# name), and the names of the resolved ones by address
+_profiled_kernels = []
+_profiled_names = {}
+_profile_lock = threadRLock()
+
+# Whether the recording is on, as last set from Python
+_parallel_profiling = False
+
+
+def _register_profiled_kernel(info, name):
+    """
+    Record `name` as the name of the gufunc kernel of wrapper info `info` in
+    the profiles of the parallel regions, if they are being recorded.
+    """
+    if _is_initialized:
+        enabled = _parallel_profiling
+    else:
+        enabled = config.PARALLEL_PROFILE
+    if not enabled:
+        return
+    with _profile_lock:
+        _profiled_kernels.append((weakref.ref(info.library), info.name, name))
+
+
+def _profiled_kernel_name(fn):
+    with _profile_lock:
+        if fn not in _profiled_names and _profiled_kernels:
+            # Resolve the kernels whose library has been compiled since, the
+            # others are kept for later or dropped if their library is gone
+            pending = []
+            for entry in _profiled_kernels:
+                library = entry[0]()
+                if library is None:
+                    continue
+                if not library._finalized:
+                    pending.append(entry)
+                    continue
+                ptr = library.get_pointer_to_function(entry[1])
+                if ptr:
+                    _profiled_names[ptr] = entry[2]
+            _profiled_kernels[:] = pending
+        return _profiled_names.get(fn)
+
+
+ParallelWorkerProfile = namedtuple(
+    'ParallelWorkerProfile',
+    ['worker', 'busy', 'wait', 'chunks', 'first_start', 'last_end'])
+ParallelWorkerProfile.__doc__ = """
+The time a worker of a parallel region spent running its chunks (`busy`) and
+not (`wait`), how many chunks it ran, and when it started the first one and
+finished the last one, in seconds.  A worker that ran no chunk has `None`
+start and end.
+"""
+
+
+class ParallelRegionProfile(namedtuple(
+        'ParallelRegionProfile',
+        ['func', 'name', 'start', 'duration', 'num_threads', 'workers'])):
+    """
+    The profile of a parallel region: the address of its gufunc kernel
+    `func` and the name of the function compiled into it (or `None` if it is
+    not known, e.g. for a function loaded from the cache or compiled while
+    the recording was off), when the region started and how long it took, in
+    seconds, and the profile of each of its `num_threads` workers.
+    """
+
+    __slots__ = ()
+
+    @property
+    def imbalance(self):
+        """
+        The ratio of the largest busy time of a worker to the mean, 1 for a
+        perfectly balanced region.
+        """
+        busy = [w.busy for w in self.workers]
+        mean = sum(busy) / len(busy)
+        return max(busy) / mean if mean else 1.
+
+
+def set_parallel_profiling(enabled):
+    """
+    Turn the recording of the profiles of the parallel regions on or off and
+    return the previous state.  The profiles are read with
+    :func:`get_parallel_profile`.  The recording can also be turned on from
+    the start with the ``NUMBA_PARALLEL_PROFILE`` environment variable.
+    """
+    _launch_threads()
+    global _parallel_profiling
+    _parallel_profiling = bool(enabled)
+    return bool(_set_parallel_profiling(1 if enabled else 0))
+
+
+def get_parallel_profile(clear=True):
+    """
+    Return the profiles of the parallel regions recorded so far, from the
+    oldest to the latest, as a list of :class:`ParallelRegionProfile`.  With
+    `clear` the returned profiles are removed from the record.
+    """
+    _launch_threads()
+    size = _read_parallel_profile(None, 0, 0)
+    if size == 0:
+        return []
+    words = (c_uint64 * size)()
+    size = _read_parallel_profile(words, size, 1 if clear else 0)
+
+    def seconds(t):
+        return t * 1e-9
+
+    records = []
+    i = 0
+    while i < size:
+        fn, num_threads, start, end = words[i:i + _PROFILE_HEADER]
+        i += _PROFILE_HEADER
+        workers = []
+        for w in range(num_threads):
+            busy, chunks, first, last = words[i:i + _PROFILE_WORKER]
+            i += _PROFILE_WORKER
+            workers.append(ParallelWorkerProfile(
+                worker=w,
+                busy=seconds(busy),
+                wait=seconds(end - start - busy),
+                chunks=chunks,
+                first_start=seconds(first) if chunks else None,
+                last_end=seconds(last) if chunks else None))
+        records.append(ParallelRegionProfile(
+            func=fn,
+            name=_profiled_kernel_name(fn),
+            start=seconds(start),
+            duration=seconds(end - start),
+            num_threads=num_threads,
+            workers=workers))
+    return records
+
+
+def parallel_profile_to_chrome_trace(records, file=None):
+    """
+    Convert the profiles `records` of :func:`get_parallel_profile` to the
+    Chrome trace event format, as read by ``chrome://tracing`` or Perfetto,
+    and return it.  If `file` is given, a path or a file object, the trace is
+    also written to it as JSON.
+
+    Each region is an event of the first track, and each of its workers that
+    ran chunks an event of its own track from the start of its first chunk
+    to the end of its last one.
+    """
+    pid = os.getpid()
+
+    def us(t):
+        return t * 1e6
+
+    events = []
+    tracks = set()
+    for record in records:
+        name = record.name or hex(record.func)
+        events.append({
+            'name': name, 'cat': 'parallel', 'ph': 'X', 'pid': pid, 'tid': 0,
+            'ts': us(record.start), 'dur': us(record.duration),
+            'args': {'num_threads': record.num_threads,
+                     'imbalance': record.imbalance}})
+        for w in record.workers:
+            if not w.chunks:
+                continue
+            tracks.add(w.worker)
+            events.append({
+                'name': name, 'cat': 'worker', 'ph': 'X', 'pid': pid,
+                'tid': w.worker + 1, 'ts': us(w.first_start),
+                'dur': us(w.last_end - w.first_start),
+                'args': {'busy_us': us(w.busy), 'chunks': w.chunks}})
+    events.append({'name': 'thread_name', 'ph': 'M', 'pid': pid, 'tid': 0,
+                   'args': {'name': 'parallel regions'}})
+    for worker in sorted(tracks):
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': pid,
+                       'tid': worker + 1,
+                       'args': {'name': 'worker %d' % worker}})
+    trace = {'traceEvents': events, 'displayTimeUnit': 'ms'}
+    if file is not None:
+        if isinstance(file, (str, os.PathLike)):
+            with open(file, 'w') as f:
+                json.dump(trace, f)
+        else:
+            json.dump(trace, file)
+    return trace
@@ -0,0 +1,96 @@
+/*
+Asynchronous launch of a parallel_for() of a threading layer.
+
+The threading layers only know how to run a parallel region to completion on
+the calling thread, so an asynchronous launch runs it on a helper thread that
+stands in for the caller.  The helper takes on the caller's schedule kind and
+chunk size, the number of threads is passed explicitly.
+*/
+
+#include <condition_variable>
+#include <mutex>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "gufunc_scheduler.h"
+#include "parallel_async.h"
+
+struct parallel_for_launch {
+    parallel_for_fn parallel_for;
+    void *fn;
+    std::vector<char *> args;
+    std::vector<size_t> dimensions;
+    std::vector<size_t> steps;
+    void *data;
+    size_t inner_ndim;
+    size_t array_count;
+    int num_threads;
+    int schedule;
+    uintp chunksize;
+
+    std::mutex lock;
+    std::condition_variable cond;
+    bool done;
+    std::thread thread;
+
+    void run() {
+        set_parallel_schedule(schedule);
+        set_parallel_chunksize(chunksize);
+        parallel_for(fn, args.data(), dimensions.data(), steps.data(), data,
+                     inner_ndim, array_count, num_threads);
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+        cond.notify_all();
+    }
+};
+
+extern "C" void *
+submit_parallel_for(parallel_for_fn parallel_for, void *fn, char **args,
+                    size_t *dimensions, size_t *steps, void *data,
+                    size_t inner_ndim, size_t array_count, size_t steps_count,
+                    int num_threads)
+{
+    parallel_for_launch *launch = NULL;
+    try {
+        launch = new parallel_for_launch;
+        launch->parallel_for = parallel_for;
+        launch->fn = fn;
+        launch->args.assign(args, args + array_count);
+        launch->dimensions.assign(dimensions, dimensions + inner_ndim + 1);
+        launch->steps.assign(steps, steps + steps_count);
+        launch->data = data;
+        launch->inner_ndim = inner_ndim;
+        launch->array_count = array_count;
+        launch->num_threads = num_threads;
+        launch->schedule = get_parallel_schedule();
+        launch->chunksize = get_parallel_chunksize();
+        launch->done = false;
+        launch->thread = std::thread(&parallel_for_launch::run, launch);
+    } catch (const std::exception &) {
+        // out of memory or of threads
+        delete launch;
+        return NULL;
+    }
+    return launch;
+}
+
+extern "C" int
+parallel_for_poll(void *handle)
+{
+    parallel_for_launch *launch = (parallel_for_launch *)handle;
+    std::lock_guard<std::mutex> guard(launch->lock);
+    return launch->done ? 1 : 0;
+}
+
+extern "C" void
+parallel_for_wait(void *handle)
+{
+    parallel_for_launch *launch = (parallel_for_launch *)handle;
+    {
+        std::unique_lock<std::mutex> guard(launch->lock);
+        launch->cond.wait(guard, [launch] { return launch->done; });
+    }
+    launch->thread.join();
+    delete launch;
+}
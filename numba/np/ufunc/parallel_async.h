@@ -0,0 +1,42 @@
+/*
+Asynchronous launch of a parallel_for() of a threading layer.
+*/
+
+#ifndef NUMBA_PARALLEL_ASYNC_H_
+#define NUMBA_PARALLEL_ASYNC_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* The parallel_for() of a threading layer, see workqueue.h */
+typedef void (*parallel_for_fn)(void *fn, char **args, size_t *dimensions,
+                                size_t *steps, void *data, size_t inner_ndim,
+                                size_t array_count, int num_threads);
+
+/* Start `parallel_for(fn, args, ...)` on a helper thread and return a handle
+ * to it, or NULL if the thread could not be started.  The args, dimensions
+ * and steps arrays are copied, `steps_count` being the length of steps: the
+ * `array_count` outer steps followed by the strides of the core dimensions
+ * of each argument.  The arrays they point to and `data` must stay alive
+ * until the launch is waited for.  The schedule kind and chunk size of the
+ * calling thread apply.  Every handle must be waited for exactly once. */
+void *submit_parallel_for(parallel_for_fn parallel_for, void *fn, char **args,
+                          size_t *dimensions, size_t *steps, void *data,
+                          size_t inner_ndim, size_t array_count,
+                          size_t steps_count, int num_threads);
+
+/* Return 1 if the launch of `handle` has finished, 0 otherwise. */
+int parallel_for_poll(void *handle);
+
+/* Wait for the launch of `handle` to finish and release the handle. */
+void parallel_for_wait(void *handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* NUMBA_PARALLEL_ASYNC_H_ */
@@ -0,0 +1,142 @@
+/*
+Opt-in instrumentation of the parallel regions of a threading layer.
+
+When it is on, each parallel_for() records how long each of its workers spent
+running chunks, how many chunks it ran and when it ran its first and last one.
+Closed records are appended to a log that numba.np.ufunc.parallel reads.  When
+it is off the cost is a load of a flag per region.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "parallel_profile.h"
+
+// Words of a record before its per-worker part, and per worker
+#define RECORD_HEADER 4
+#define RECORD_WORKER 4
+
+// Bound on the size of the log, records are dropped when it is full
+#define MAX_LOG_WORDS (1 << 22)
+
+struct worker_profile {
+    std::atomic<uint64_t> busy;
+    std::atomic<uint64_t> chunks;
+    std::atomic<uint64_t> first;
+    std::atomic<uint64_t> last;
+};
+
+struct region_profile {
+    void *fn;
+    int num_threads;
+    uint64_t start;
+    std::vector<worker_profile> workers;
+
+    region_profile(void *f, int n)
+        : fn(f), num_threads(n), start(profile_now()), workers(n)
+    {
+        for (auto &w : workers) {
+            w.busy = 0;
+            w.chunks = 0;
+            w.first = UINT64_MAX;
+            w.last = 0;
+        }
+    }
+};
+
+static std::atomic<int> profiling(0);
+static std::mutex log_lock;
+static std::vector<uint64_t> *profile_log = NULL;
+
+extern "C" int
+set_parallel_profiling(int enabled)
+{
+    return profiling.exchange(enabled ? 1 : 0);
+}
+
+extern "C" uint64_t
+profile_now(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+extern "C" void *
+profile_region_begin(void *fn, int num_threads)
+{
+    if (!profiling.load(std::memory_order_relaxed))
+        return NULL;
+    return new region_profile(fn, num_threads > 0 ? num_threads : 1);
+}
+
+extern "C" void
+profile_chunk(void *region, int worker, uint64_t start, uint64_t end)
+{
+    region_profile *rp = (region_profile *)region;
+    if (!rp)
+        return;
+    worker_profile &w = rp->workers[(unsigned)worker % rp->workers.size()];
+    w.busy += end - start;
+    w.chunks += 1;
+    // a worker index is normally used by one thread at a time, but e.g. TBB
+    // may move a slot between threads
+    uint64_t cur = w.first.load();
+    while (start < cur && !w.first.compare_exchange_weak(cur, start)) {}
+    cur = w.last.load();
+    while (end > cur && !w.last.compare_exchange_weak(cur, end)) {}
+}
+
+extern "C" void
+profile_region_end(void *region)
+{
+    region_profile *rp = (region_profile *)region;
+    if (!rp)
+        return;
+    uint64_t end = profile_now();
+    {
+        std::lock_guard<std::mutex> guard(log_lock);
+        if (!profile_log)
+            profile_log = new std::vector<uint64_t>;
+        size_t size = RECORD_HEADER + RECORD_WORKER * rp->workers.size();
+        if (profile_log->size() + size <= MAX_LOG_WORDS) {
+            profile_log->push_back((uint64_t)(uintptr_t)rp->fn);
+            profile_log->push_back((uint64_t)rp->workers.size());
+            profile_log->push_back(rp->start);
+            profile_log->push_back(end);
+            for (auto &w : rp->workers) {
+                uint64_t chunks = w.chunks;
+                profile_log->push_back(w.busy);
+                profile_log->push_back(chunks);
+                profile_log->push_back(chunks ? w.first.load() : 0);
+                profile_log->push_back(chunks ? w.last.load() : 0);
+            }
+        }
+    }
+    delete rp;
+}
+
+extern "C" size_t
+read_parallel_profile(uint64_t *out, size_t words, int clear)
+{
+    std::lock_guard<std::mutex> guard(log_lock);
+    if (!profile_log)
+        return 0;
+    if (words == 0)
+        return profile_log->size();
+    // copy the whole records that fit
+    size_t copied = 0;
+    while (copied < profile_log->size()) {
+        size_t size = RECORD_HEADER +
+                      RECORD_WORKER * (*profile_log)[copied + 1];
+        if (copied + size > words)
+            break;
+        copied += size;
+    }
+    std::copy(profile_log->begin(), profile_log->begin() + copied, out);
+    if (clear)
+        profile_log->erase(profile_log->begin(), profile_log->begin() + copied);
+    return copied;
+}
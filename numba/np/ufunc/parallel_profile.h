@@ -0,0 +1,48 @@
+/*
+Opt-in instrumentation of the parallel regions of a threading layer.
+*/
+
+#ifndef NUMBA_PARALLEL_PROFILE_H_
+#define NUMBA_PARALLEL_PROFILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Turn the instrumentation on or off, return the previous state. */
+int set_parallel_profiling(int enabled);
+
+/* Start the record of a parallel_for() of the kernel `fn` over `num_threads`
+ * workers, returns NULL when the instrumentation is off.  The other calls
+ * accept a NULL region and do nothing. */
+void *profile_region_begin(void *fn, int num_threads);
+
+/* Account the chunk of the region run by `worker` (an index below the
+ * region's number of threads, larger ones are folded into that range) from
+ * `start` to `end`, as given by profile_now(). */
+void profile_chunk(void *region, int worker, uint64_t start, uint64_t end);
+
+/* Close the record of the region and append it to the log. */
+void profile_region_end(void *region);
+
+/* The current time in nanoseconds of a monotonic clock. */
+uint64_t profile_now(void);
+
+/* Copy the log into `out`, at most `words` 64-bit words of whole records,
+ * and return the number of words copied.  With `clear` the copied records
+ * are removed from the log.  Called with `words` 0 it returns the size of
+ * the log instead.  Each record is laid out as:
+ *   fn, num_threads, start, end,
+ *   then for each worker: busy, chunks, first chunk start, last chunk end
+ * with all times in nanoseconds, and 0 starts for workers that ran nothing. */
+size_t read_parallel_profile(uint64_t *out, size_t words, int clear);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* NUMBA_PARALLEL_PROFILE_H_ */
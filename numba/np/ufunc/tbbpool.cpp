@@ -16,9 +16,16 @@ Implement parallel vectorize workqueue on top of Intel TBB.
 #include <string.h>
 #include <stdio.h>
 #include <thread>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 #include "workqueue.h"
 
 #include "gufunc_scheduler.h"
+#include "thread_affinity.h"
+#include "parallel_async.h"
+#include "parallel_profile.h"
 
 /* TBB 2019 U5 is the minimum required version as this is needed:
  * https://github.com/intel/tbb/blob/18070344d755ece04d169e6cc40775cae9288cee/CHANGES#L133-L134
@@ -102,6 +109,51 @@ public:
 
 void fix_tls_observer::on_scheduler_entry(bool worker) {
     set_num_threads(mask_val);
+    // Pin workers to the CPU of the arena slot they take, which is what
+    // get_thread_id() returns. The launching thread is left alone.
+    if (worker)
+        pin_current_thread(tbb::this_task_arena::current_thread_index());
+}
+
+// An arena limited to a number of threads and the observer watching it.
+// Creating these costs more than a short parallel region, so they are created
+// once per thread count and kept for the life of the TBB scheduler. The
+// observer is declared last so it is destroyed (and stops observing) before
+// the arena is.
+struct cached_arena {
+    tbb::task_arena arena;
+    fix_tls_observer observer;
+
+    explicit cached_arena(int num_threads)
+        : arena(num_threads), observer(arena, num_threads) {}
+};
+
+// The cache is heap allocated and never freed so that it is not destroyed at
+// exit after TBB itself. Launches hold a shared_ptr to their entry so that
+// clearing the cache never pulls an arena from under a running region.
+static std::mutex arena_cache_lock;
+static std::unordered_map<int, std::shared_ptr<cached_arena>> *arena_cache = NULL;
+
+static std::shared_ptr<cached_arena>
+get_arena(int num_threads)
+{
+    std::lock_guard<std::mutex> guard(arena_cache_lock);
+    if (!arena_cache)
+        arena_cache = new std::unordered_map<int, std::shared_ptr<cached_arena>>;
+    std::shared_ptr<cached_arena> &entry = (*arena_cache)[num_threads];
+    if (!entry)
+        entry = std::make_shared<cached_arena>(num_threads);
+    return entry;
+}
+
+// Drop the cached arenas, this must happen before the scheduler is finalized
+// as live arenas keep the worker threads around.
+static void
+clear_arena_cache(void)
+{
+    std::lock_guard<std::mutex> guard(arena_cache_lock);
+    if (arena_cache)
+        arena_cache->clear();
 }
 
 static void
@@ -160,13 +212,30 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
     // doing any work. Any further call to query the TLS slot value made by any
     // thread in the arena is then safe and were any thread to create a nested
     // parallel region the same logic applies as per program start/reinit.
-    tbb::task_arena limited(num_threads);
-    fix_tls_observer observer(limited, num_threads);
+    // The arena is reused by later launches with the same thread count and a
+    // worker may stay in it between launches without re-entering, so each
+    // chunk also resets the TLS slot in case a previous region changed it.
+    std::shared_ptr<cached_arena> cached = get_arena(num_threads);
+    tbb::task_arena &limited = cached->arena;
+
+    // The schedule kind and chunk size are thread local, read them on the
+    // launching thread. A dynamic schedule hands out chunks of the grain
+    // (single entries of a parfor schedule) one at a time, a guided schedule
+    // has each thread claim shrinking chunks of no less than the grain from
+    // a shared cursor, the other kinds leave the splitting to TBB's auto
+    // partitioner.
+    uintp grain;
+    const int schedule = get_launch_schedule(dimensions[0], num_threads,
+                                             &grain);
+
+    // Workers are identified by their slot in the arena
+    void *profile = profile_region_begin(fn, num_threads);
 
     limited.execute([&]{
         using range_t = tbb::blocked_range<size_t>;
-        tbb::parallel_for(range_t(0, dimensions[0]), [=](const range_t &range)
+        auto body = [=](const range_t &range)
         {
+            set_num_threads(num_threads);
             size_t * count_space = (size_t *)alloca(sizeof(size_t) * arg_len);
             char ** array_arg_space = (char**)alloca(sizeof(char*) * array_count);
             memcpy(count_space, dimensions, arg_len * sizeof(size_t));
@@ -205,9 +274,58 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
                 printf("\n");
             }
             auto func = reinterpret_cast<void (*)(char **args, size_t *dims, size_t *steps, void *data)>(fn);
-            func(array_arg_space, count_space, steps, data);
-        });
+            if (profile)
+            {
+                uint64_t start = profile_now();
+                func(array_arg_space, count_space, steps, data);
+                profile_chunk(profile,
+                              tbb::this_task_arena::current_thread_index(),
+                              start, profile_now());
+            }
+            else
+            {
+                func(array_arg_space, count_space, steps, data);
+            }
+        };
+        if (schedule == NUMBA_SCHEDULE_GUIDED)
+        {
+            const size_t total = dimensions[0];
+            std::atomic<size_t> next(0);
+            tbb::parallel_for(range_t(0, num_threads, 1), [&](const range_t &)
+            {
+                size_t start = next.load();
+                while (start < total)
+                {
+                    size_t count = guided_chunk(total - start, num_threads, grain);
+                    if (next.compare_exchange_weak(start, start + count))
+                    {
+                        body(range_t(start, start + count));
+                        start = next.load();
+                    }
+                }
+            }, tbb::simple_partitioner());
+        }
+        else if (schedule == NUMBA_SCHEDULE_DYNAMIC)
+        {
+            tbb::parallel_for(range_t(0, dimensions[0], grain), body,
+                              tbb::simple_partitioner());
+        }
+        else
+        {
+            tbb::parallel_for(range_t(0, dimensions[0]), body);
+        }
     });
+    profile_region_end(profile);
+}
+
+static void *
+parallel_for_async(void *fn, char **args, size_t *dimensions, size_t *steps,
+                   void *data, size_t inner_ndim, size_t array_count,
+                   size_t steps_count, int num_threads)
+{
+    return submit_parallel_for(parallel_for, fn, args, dimensions, steps,
+                               data, inner_ndim, array_count, steps_count,
+                               num_threads);
 }
 
 static std::thread::id init_thread_id;
@@ -233,6 +351,7 @@ static void prepare_fork(void)
     {
         if(is_main_thread())
         {
+            clear_arena_cache();
             if (!tbb::finalize(tsh, std::nothrow))
             {
                 tbb::task_scheduler_handle::release(tsh);
@@ -279,6 +398,7 @@ static void unload_tbb(void)
         delete tg;
         tg = NULL;
     }
+    clear_arena_cache();
     if (tsh_was_initialized)
     {
         // blocking terminate is not strictly required here, ignore return value
@@ -339,6 +459,9 @@ MOD_INIT(tbbpool)
     SetAttrStringFromVoidPointer(m, ready);
     SetAttrStringFromVoidPointer(m, add_task);
     SetAttrStringFromVoidPointer(m, parallel_for);
+    SetAttrStringFromVoidPointer(m, parallel_for_async);
+    SetAttrStringFromVoidPointer(m, parallel_for_poll);
+    SetAttrStringFromVoidPointer(m, parallel_for_wait);
     SetAttrStringFromVoidPointer(m, do_scheduling_signed);
     SetAttrStringFromVoidPointer(m, do_scheduling_unsigned);
     SetAttrStringFromVoidPointer(m, set_num_threads);
@@ -347,6 +470,13 @@ MOD_INIT(tbbpool)
     SetAttrStringFromVoidPointer(m, set_parallel_chunksize);
     SetAttrStringFromVoidPointer(m, get_parallel_chunksize);
     SetAttrStringFromVoidPointer(m, get_sched_size);
+    SetAttrStringFromVoidPointer(m, set_parallel_schedule);
+    SetAttrStringFromVoidPointer(m, get_parallel_schedule);
+    SetAttrStringFromVoidPointer(m, set_parallel_tile_itemsize);
+    SetAttrStringFromVoidPointer(m, set_parallel_prechunked);
+    SetAttrStringFromVoidPointer(m, set_parallel_profiling);
+    SetAttrStringFromVoidPointer(m, read_parallel_profile);
+    SetAttrStringFromVoidPointer(m, set_thread_affinity);
 
     return MOD_SUCCESS_VAL(m);
 }
@@ -0,0 +1,92 @@
+/*
+Pinning of the threading layer workers to CPUs, see NUMBA_THREAD_AFFINITY.
+
+The Python side resolves the setting into one CPU per thread ID, each
+threading layer then pins its workers as they start working for a given
+thread ID, so that get_thread_id() maps onto the same CPU from one parallel
+region to the next.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "thread_affinity.h"
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL(ty) __declspec(thread) ty
+#else
+/* Non-standard C99 extension that's understood by gcc and clang */
+#define THREAD_LOCAL(ty) __thread ty
+#endif
+
+// Written once before the threads are launched, read-only afterwards
+static int *affinity_cpus = NULL;
+static int affinity_count = 0;
+
+// The CPU the calling thread is pinned to, -1 if it is not pinned, so that a
+// thread that keeps its thread ID does not make a system call per region.
+static THREAD_LOCAL(int) pinned_cpu = -1;
+
+static int
+pin_to_cpu(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t *set = CPU_ALLOC(cpu + 1);
+    size_t size = CPU_ALLOC_SIZE(cpu + 1);
+    int status;
+    if (!set)
+        return -1;
+    CPU_ZERO_S(size, set);
+    CPU_SET_S(cpu, size, set);
+    status = sched_setaffinity(0, size, set);
+    CPU_FREE(set);
+    return status == 0 ? 0 : -1;
+#elif defined(_WIN32)
+    // Only the first processor group can be addressed with a mask
+    if (cpu >= (int)(8 * sizeof(DWORD_PTR)))
+        return -1;
+    return SetThreadAffinityMask(GetCurrentThread(),
+                                 (DWORD_PTR)1 << cpu) ? 0 : -1;
+#else
+    // e.g. macOS has no way to bind a thread to a CPU
+    (void)cpu;
+    return -1;
+#endif
+}
+
+extern "C" int
+set_thread_affinity(int count, const int *cpus)
+{
+    free(affinity_cpus);
+    affinity_cpus = NULL;
+    affinity_count = 0;
+    if (count <= 0)
+        return 0;
+    affinity_cpus = (int *)malloc(sizeof(int) * count);
+    if (!affinity_cpus)
+        return -1;
+    memcpy(affinity_cpus, cpus, sizeof(int) * count);
+    affinity_count = count;
+    return 0;
+}
+
+extern "C" int
+pin_current_thread(int tid)
+{
+    int cpu;
+    if (affinity_count == 0 || tid < 0)
+        return -1;
+    cpu = affinity_cpus[tid % affinity_count];
+    if (cpu == pinned_cpu)
+        return 0;
+    if (pin_to_cpu(cpu) != 0)
+        return -1;
+    pinned_cpu = cpu;
+    return 0;
+}
@@ -0,0 +1,27 @@
+/*
+Pinning of the threading layer workers to CPUs, see NUMBA_THREAD_AFFINITY.
+*/
+
+#ifndef NUMBA_THREAD_AFFINITY_H_
+#define NUMBA_THREAD_AFFINITY_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Set the CPUs the workers are pinned to, thread ID `tid` goes on
+ * `cpus[tid % count]`.  A count of 0 disables pinning.  This must be called
+ * before the threads are launched.  Returns 0 on success. */
+int set_thread_affinity(int count, const int *cpus);
+
+/* Pin the calling thread to the CPU of thread ID `tid`, this is a no-op if
+ * the thread is already there.  Returns 0 on success, -1 if pinning is
+ * disabled, unsupported on this platform or failed. */
+int pin_current_thread(int tid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* NUMBA_THREAD_AFFINITY_H_ */
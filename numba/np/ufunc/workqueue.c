@@ -2,7 +2,12 @@
 Implement parallel vectorize workqueue.
 
 This keeps a set of worker threads running all the time.
-They wait and spin on a task queue for jobs.
+They wait for jobs by spinning on an epoch counter for a while, then parking
+on a condition variable until the next job is published.
+
+parallel_for() splits the outer dimension into several chunks per thread and
+deals them out to per-worker Chase-Lev deques; workers that run out of chunks
+steal from the others, which balances loops with uneven iteration costs.
 
 **WARNING**
 This module is not thread-safe.  Adding task to queue is not protected from
@@ -45,18 +50,36 @@ race conditions.
 #include <stdio.h>
 #include "workqueue.h"
 #include "gufunc_scheduler.h"
+#include "thread_affinity.h"
+#include "parallel_async.h"
+#include "parallel_profile.h"
 
 #define _DEBUG 0
 
+/* Number of chunks parallel_for() aims to give each worker.  More chunks
+ * balance skewed loops better at the cost of more calls into the gufunc.
+ */
+#define CHUNKS_PER_THREAD 16
+
+/* Bounds of the number of polls a waiting thread spins for before parking.
+ * Each worker adapts its own limit: it doubles when a job arrives while
+ * spinning and halves when the worker had to park.
+ */
+#define SPIN_MIN 64
+#define SPIN_MAX 8192
+
 /* workqueue is not threadsafe, so we use DSO globals to flag and update various
  * states.
  */
-/* This variable is the nesting level, it's incremented at the start of each
- * parallel region and decremented at the end, if parallel regions are nested
- * on entry the value == 1 and workqueue will abort (this in preference to just
- * hanging or segfaulting).
+/* This flag is set while a parallel region owns the thread pool.  A region
+ * launched while it is set, i.e. nested in another region or concurrently
+ * from another thread, runs serially on the launching thread instead (this in
+ * preference to hanging or segfaulting).
  */
-static int _nesting_level = 0;
+static volatile ptrdiff_t _pool_busy = 0;
+
+/* Number of parallel regions that ran serially because the pool was busy */
+static volatile ptrdiff_t _nested_launches = 0;
 
 /* As the thread-pool isn't inherited by children,
    free the task-queue, too. */
@@ -108,6 +131,13 @@ queue_condition_signal(queue_condition_t *qc)
     pthread_cond_signal(&qc->cond);
 }
 
+static void
+queue_condition_broadcast(queue_condition_t *qc)
+{
+    /* XXX errors? */
+    pthread_cond_broadcast(&qc->cond);
+}
+
 static void
 queue_condition_wait(queue_condition_t *qc)
 {
@@ -196,6 +226,12 @@ queue_condition_signal(queue_condition_t *qc)
     WakeConditionVariable(&qc->cv);
 }
 
+static void
+queue_condition_broadcast(queue_condition_t *qc)
+{
+    WakeAllConditionVariable(&qc->cv);
+}
+
 static void
 queue_condition_wait(queue_condition_t *qc)
 {
@@ -264,6 +300,103 @@ platform_launch(void)
 
 #endif /* Windows threading */
 
+/* Atomics for the work-stealing deques */
+#ifdef _MSC_VER
+
+static ptrdiff_t
+atomic_load(volatile ptrdiff_t *ptr)
+{
+    ptrdiff_t val = *ptr;
+    MemoryBarrier();
+    return val;
+}
+
+static void
+atomic_store(volatile ptrdiff_t *ptr, ptrdiff_t val)
+{
+    MemoryBarrier();
+    *ptr = val;
+}
+
+static int
+atomic_cas(volatile ptrdiff_t *ptr, ptrdiff_t old, ptrdiff_t repl)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile *)ptr,
+                                             (PVOID)repl,
+                                             (PVOID)old) == (PVOID)old;
+}
+
+static void
+atomic_fence(void)
+{
+    MemoryBarrier();
+}
+
+static ptrdiff_t
+atomic_add(volatile ptrdiff_t *ptr, ptrdiff_t val)
+{
+    ptrdiff_t old;
+    do {
+        old = atomic_load(ptr);
+    } while (!atomic_cas(ptr, old, old + val));
+    return old + val;
+}
+
+static void
+cpu_relax(void)
+{
+    YieldProcessor();
+}
+
+#else
+
+static ptrdiff_t
+atomic_load(volatile ptrdiff_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static void
+atomic_store(volatile ptrdiff_t *ptr, ptrdiff_t val)
+{
+    __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+static int
+atomic_cas(volatile ptrdiff_t *ptr, ptrdiff_t old, ptrdiff_t repl)
+{
+    return __atomic_compare_exchange_n(ptr, &old, repl, 0, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_RELAXED);
+}
+
+static void
+atomic_fence(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static ptrdiff_t
+atomic_add(volatile ptrdiff_t *ptr, ptrdiff_t val)
+{
+    return __atomic_add_fetch(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static void
+cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__powerpc__)
+    __asm__ __volatile__("or 27,27,27" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+#endif
+
 typedef struct Task
 {
     void (*func)(void *args, void *dims, void *steps, void *data);
@@ -273,30 +406,167 @@ typedef struct Task
 
 typedef struct
 {
-    queue_condition_t cond;
-    int state;
     Task task;
+    /* set by add_task(), the task is published by ready() */
+    int staged;
+    /* set while the published task waits for or is being run by the worker */
+    volatile ptrdiff_t has_task;
 } Queue;
 
 
+/* Chase-Lev work-stealing deque of the chunks of a parallel_for().
+ *
+ * A worker's chunks are contiguous and pushed before the workers start, so
+ * the deque needs no buffer: the entry at position i is chunk `last - i`.
+ * The owner pops from the bottom, i.e. runs its chunks in ascending order,
+ * and thieves steal from the top, i.e. the chunks furthest from the owner.
+ */
+typedef struct
+{
+    volatile ptrdiff_t top;
+    volatile ptrdiff_t bottom;
+    ptrdiff_t last;
+    /* Chunk the owner runs before touching the deque, -1 if none.  It cannot
+     * be stolen, so every worker with chunks joins the parallel region. */
+    ptrdiff_t first;
+    /* Keep each deque on its own cache line */
+    char _pad[64 - 4 * sizeof(ptrdiff_t)];
+} Deque;
+
+#define DEQUE_EMPTY -1
+#define DEQUE_ABORT -2
+
+static void
+deque_init(Deque *deque, ptrdiff_t start, ptrdiff_t stop)
+{
+    deque->first = start < stop ? start : -1;
+    deque->last = stop - 1;
+    deque->top = 0;
+    deque->bottom = start < stop ? stop - start - 1 : 0;
+}
+
+/* Take the next chunk of the owner, or DEQUE_EMPTY */
+static ptrdiff_t
+deque_pop(Deque *deque)
+{
+    ptrdiff_t b = deque->bottom - 1;
+    ptrdiff_t t, chunk;
+
+    atomic_store(&deque->bottom, b);
+    atomic_fence();
+    t = atomic_load(&deque->top);
+    if (t > b)
+    {
+        atomic_store(&deque->bottom, b + 1);
+        return DEQUE_EMPTY;
+    }
+    chunk = deque->last - b;
+    if (t == b)
+    {
+        /* Last chunk, race against the thieves */
+        if (!atomic_cas(&deque->top, t, t + 1))
+            chunk = DEQUE_EMPTY;
+        atomic_store(&deque->bottom, b + 1);
+    }
+    return chunk;
+}
+
+/* Steal a chunk from another worker, DEQUE_EMPTY if there is none left or
+ * DEQUE_ABORT if another thread won the race for it.
+ */
+static ptrdiff_t
+deque_steal(Deque *deque)
+{
+    ptrdiff_t t = atomic_load(&deque->top);
+    ptrdiff_t b;
+
+    atomic_fence();
+    b = atomic_load(&deque->bottom);
+    if (t >= b)
+        return DEQUE_EMPTY;
+    if (!atomic_cas(&deque->top, t, t + 1))
+        return DEQUE_ABORT;
+    return deque->last - t;
+}
+
+/* A parallel_for() shared by its workers */
+typedef struct
+{
+    void (*func)(char **args, size_t *dims, size_t *steps, void *data);
+    char **args;
+    size_t *dimensions;
+    size_t *steps;
+    void *data;
+    size_t arg_len;
+    size_t array_count;
+    /* the outer dimension is split into `nchunks` chunks, the first `remain`
+     * of which have one more iteration than `count` */
+    size_t count;
+    size_t remain;
+    /* a guided schedule claims chunks from `next` instead, shrinking from a
+     * share of the remaining iterations down to `grain` */
+    int guided;
+    size_t grain;
+    volatile ptrdiff_t next;
+    int num_threads;
+    /* record of the region when the instrumentation is on, or NULL */
+    void *profile;
+} ParallelJob;
+
 static Queue *queues = NULL;
+static Deque *deques = NULL;
 static int queue_count;
 static int queue_pivot = 0;
 static int NUM_THREADS = -1;
 
-static void
-queue_state_wait(Queue *queue, int old, int repl)
+/* ready() publishes the staged tasks by bumping the epoch, the workers wait
+ * for it to change.  Parked workers are counted in `_sleepers` and woken
+ * through `wake_cond`.
+ */
+static volatile ptrdiff_t _epoch = 0;
+static volatile ptrdiff_t _sleepers = 0;
+static queue_condition_t wake_cond;
+
+/* Number of published tasks not done yet, synchronize() waits for it to drop
+ * to 0, parking on `done_cond` if it takes long.
+ */
+static volatile ptrdiff_t _pending = 0;
+static volatile ptrdiff_t _launcher_parked = 0;
+static queue_condition_t done_cond;
+
+/* Wait for the epoch to move on from `seen` and return the new epoch */
+static ptrdiff_t
+wait_epoch(ptrdiff_t seen, int *spin_limit)
 {
-    queue_condition_t *cond = &queue->cond;
+    ptrdiff_t epoch;
+    int i;
 
-    queue_condition_lock(cond);
-    while (queue->state != old)
+    for (i = 0; i < *spin_limit; i++)
+    {
+        epoch = atomic_load(&_epoch);
+        if (epoch != seen)
+        {
+            if (*spin_limit < SPIN_MAX)
+                *spin_limit *= 2;
+            return epoch;
+        }
+        cpu_relax();
+    }
+    if (*spin_limit > SPIN_MIN)
+        *spin_limit /= 2;
+
+    queue_condition_lock(&wake_cond);
+    atomic_store(&_sleepers, _sleepers + 1);
+    // pairs with the fence in ready(): either ready() sees this thread
+    // asleep or this thread sees the new epoch
+    atomic_fence();
+    while ((epoch = atomic_load(&_epoch)) == seen)
     {
-        queue_condition_wait(cond);
+        queue_condition_wait(&wake_cond);
     }
-    queue->state = repl;
-    queue_condition_signal(cond);
-    queue_condition_unlock(cond);
+    atomic_store(&_sleepers, _sleepers - 1);
+    queue_condition_unlock(&wake_cond);
+    return epoch;
 }
 
 // break on this for debug
@@ -355,12 +625,125 @@ get_num_threads(void)
 // static void nopfn(void *args, void *dims, void *steps, void *data) {};
 
 
-// synchronize the TLS num_threads slot to value args[0]
-static void sync_tls(void *args, void *dims, void *steps, void *data) {
-    int nthreads = *((int *)(args));
-    _TLS_num_threads = nthreads;
-};
+static void
+run_range(ParallelJob *job, int tid, size_t start, size_t count,
+          size_t *count_space, char **array_arg_space)
+{
+    size_t j;
+    uint64_t chunk_start = 0;
+
+    memcpy(count_space, job->dimensions, job->arg_len * sizeof(size_t));
+    count_space[0] = count;
+
+    for(j = 0; j < job->array_count; j++)
+    {
+        array_arg_space[j] = job->args[j] + job->steps[j] * start;
+    }
+
+    if(_DEBUG)
+    {
+        printf("THREAD %d: start %zd, count %zd\n",
+               tid, start, count_space[0]);
+    }
+    if (job->profile)
+    {
+        chunk_start = profile_now();
+    }
+    job->func(array_arg_space, count_space, job->steps, job->data);
+    if (job->profile)
+    {
+        profile_chunk(job->profile, tid, chunk_start, profile_now());
+    }
+}
+
+static void
+run_chunk(ParallelJob *job, int tid, ptrdiff_t chunk, size_t *count_space,
+          char **array_arg_space)
+{
+    size_t index = (size_t)chunk;
+    size_t start;
+
+    start = index * job->count + (index < job->remain ? index : job->remain);
+    run_range(job, tid, start, job->count + (index < job->remain ? 1 : 0),
+              count_space, array_arg_space);
+}
 
+/* Task run by each worker of a guided parallel_for(): claim chunks from the
+ * shared cursor, each a share of what remains, until no iteration is left.
+ */
+static void
+run_guided(ParallelJob *job, int tid, size_t *count_space,
+           char **array_arg_space)
+{
+    size_t total = job->dimensions[0];
+    ptrdiff_t start;
+    size_t count;
+
+    for (;;)
+    {
+        start = atomic_load(&job->next);
+        if ((size_t)start >= total)
+        {
+            return;
+        }
+        count = guided_chunk(total - start, job->num_threads, job->grain);
+        if (atomic_cas(&job->next, start, start + count))
+        {
+            run_range(job, tid, start, count, count_space, array_arg_space);
+        }
+    }
+}
+
+/* Task run by each worker of a parallel_for(): run its own chunks, then steal
+ * from the other workers until no chunk is left.
+ */
+static void
+parallel_for_worker(void *args, void *dims, void *steps, void *data)
+{
+    ParallelJob *job = (ParallelJob *)args;
+    int tid = get_thread_id();
+    int i, victim, retry;
+    ptrdiff_t chunk;
+    Deque *own = &deques[tid];
+    size_t *count_space = (size_t *)alloca(sizeof(size_t) * job->arg_len);
+    char **array_arg_space = alloca(sizeof(char*) * job->array_count);
+
+    // synchronize the TLS num_threads slot of the participating threads
+    _TLS_num_threads = job->num_threads;
+
+    if (job->guided)
+    {
+        run_guided(job, tid, count_space, array_arg_space);
+        return;
+    }
+
+    if (own->first >= 0)
+    {
+        run_chunk(job, tid, own->first, count_space, array_arg_space);
+    }
+    while ((chunk = deque_pop(own)) != DEQUE_EMPTY)
+    {
+        run_chunk(job, tid, chunk, count_space, array_arg_space);
+    }
+
+    do
+    {
+        retry = 0;
+        for (i = 1; i < job->num_threads; i++)
+        {
+            victim = (tid + i) % job->num_threads;
+            while ((chunk = deque_steal(&deques[victim])) != DEQUE_EMPTY)
+            {
+                if (chunk == DEQUE_ABORT)
+                {
+                    retry = 1;
+                    break;
+                }
+                run_chunk(job, tid, chunk, count_space, array_arg_space);
+            }
+        }
+    } while (retry);
+}
 
 static void
 parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *data,
@@ -372,44 +755,70 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
     //     steps = <ir.Argument '.3' of type i64*>
     //     data = <ir.Argument '.4' of type i8*>
 
-    // check the nesting level, if it's already 1, abort, workqueue cannot
-    // handle nesting.
-    if (_nesting_level >= 1){
-        fprintf(stderr, "%s", "Terminating: Nested parallel kernel launch "
-                              "detected, the workqueue threading layer does "
-                              "not supported nested parallelism. Try the TBB "
-                              "threading layer.\n");
-        raise(SIGABRT);
+    // read the schedule first, this consumes the mark of a parfor launch
+    // even if it runs serially
+    uintp grain;
+    int schedule = get_launch_schedule(*((size_t *)dimensions), num_threads,
+                                       &grain);
+
+    // take the pool, if another region already has it (this is a nested
+    // region, or another thread is running one) run the whole loop serially
+    // on this thread.
+    if (!atomic_cas(&_pool_busy, 0, 1))
+    {
+        atomic_add(&_nested_launches, 1);
+        if(_DEBUG)
+        {
+            printf("nested parallel region, running serially\n");
+        }
+        void *profile = profile_region_begin(fn, 1);
+        uint64_t start = profile ? profile_now() : 0;
+        ((void (*)(char **, size_t *, size_t *, void *))fn)(
+            args, dimensions, steps, data);
+        if (profile)
+        {
+            profile_chunk(profile, 0, start, profile_now());
+            profile_region_end(profile);
+        }
         return;
     }
 
-    // increment the nest level
-    _nesting_level += 1;
-
-    size_t * count_space = NULL;
-    char ** array_arg_space = NULL;
     const size_t arg_len = (inner_ndim + 1);
     int i; // induction var for chunking, thread count unlikely to overflow int
-    size_t j, count, remain, total;
-
-    ptrdiff_t offset;
-    char * base;
+    size_t j, total, nchunks;
     int old_queue_count = -1;
-
-    size_t step;
+    ParallelJob job;
 
     debug_marker();
 
     total = *((size_t *)dimensions);
-    count = total / num_threads;
-    remain = total;
+    if (schedule == NUMBA_SCHEDULE_STATIC)
+    {
+        nchunks = (size_t)num_threads * CHUNKS_PER_THREAD;
+        if (nchunks > total)
+        {
+            nchunks = total;
+        }
+    }
+    else if (schedule == NUMBA_SCHEDULE_GUIDED)
+    {
+        // Guided schedules claim shrinking chunks of no less than the grain,
+        // so no chunk is dealt up front.
+        nchunks = 0;
+    }
+    else
+    {
+        // Dynamic and tiled schedules hand out chunks of the grain, which is
+        // a single entry (one of its chunks or tiles) for a parfor schedule.
+        nchunks = (total + grain - 1) / grain;
+    }
 
     if(_DEBUG)
     {
         printf("inner_ndim: %zd\n",inner_ndim);
         printf("arg_len: %zd\n", arg_len);
         printf("total: %zd\n", total);
-        printf("count: %zd\n", count);
+        printf("nchunks: %zd\n", nchunks);
 
         printf("dimensions: ");
         for(j = 0; j < arg_len; j++)
@@ -430,83 +839,64 @@ parallel_for(void *fn, char **args, size_t *dimensions, size_t *steps, void *dat
         {
             printf("%p, ", (void *)args[j]);
         }
+        printf("\n");
+    }
+
+    if (!queues)
+    {
+        launch_threads(NUM_THREADS);
     }
 
-    // sync the thread pool TLS slots, sync all slots, we don't know which
-    // threads will end up running.
-    for (i = 0; i < NUM_THREADS; i++)
+    job.func = fn;
+    job.args = args;
+    job.dimensions = dimensions;
+    job.steps = steps;
+    job.data = data;
+    job.arg_len = arg_len;
+    job.array_count = array_count;
+    job.count = nchunks ? total / nchunks : 0;
+    job.remain = nchunks ? total % nchunks : 0;
+    job.guided = schedule == NUMBA_SCHEDULE_GUIDED;
+    job.grain = grain;
+    job.next = 0;
+    job.num_threads = num_threads;
+    job.profile = profile_region_begin(fn, num_threads);
+
+    // Deal the chunks out in contiguous blocks, as a static schedule would,
+    // the workers only steal once they are done with their own block.
+    for (i = 0; i < num_threads; i++)
     {
-        add_task_internal(sync_tls, (void *)(&num_threads), NULL, NULL, NULL, i);
+        deque_init(&deques[i], (ptrdiff_t)(nchunks * i / num_threads),
+                   (ptrdiff_t)(nchunks * (i + 1) / num_threads));
     }
-    ready();
-    synchronize();
 
     // This backend isn't threadsafe so just mutate the global
     old_queue_count = queue_count;
     queue_count = num_threads;
+    queue_pivot = 0;
 
     for (i = 0; i < num_threads; i++)
     {
-        count_space = (size_t *)alloca(sizeof(size_t) * arg_len);
-        memcpy(count_space, dimensions, arg_len * sizeof(size_t));
-        if(i == num_threads - 1)
-        {
-            // Last thread takes all leftover
-            count_space[0] = remain;
-        }
-        else
-        {
-            count_space[0] = count;
-            remain = remain - count;
-        }
-
-        if(_DEBUG)
-        {
-            printf("\n=================== THREAD %d ===================\n", i);
-            printf("\ncount_space: ");
-            for(j = 0; j < arg_len; j++)
-            {
-                printf("%zd, ", count_space[j]);
-            }
-            printf("\n");
-        }
-
-        array_arg_space = alloca(sizeof(char*) * array_count);
-
-        for(j = 0; j < array_count; j++)
-        {
-            base = args[j];
-            step = steps[j];
-            offset = step * count * i;
-            array_arg_space[j] = (char *)(base + offset);
-
-            if(_DEBUG)
-            {
-                printf("Index %zd\n", j);
-                printf("-->Got base %p\n", (void *)base);
-                printf("-->Got step %zd\n", step);
-                printf("-->Got offset %td\n", offset);
-                printf("-->Got addr %p\n", (void *)array_arg_space[j]);
-            }
-        }
-
-        if(_DEBUG)
-        {
-            printf("\narray_arg_space: ");
-            for(j = 0; j < array_count; j++)
-            {
-                printf("%p, ", (void *)array_arg_space[j]);
-            }
-        }
-        add_task_internal(fn, (void *)array_arg_space, (void *)count_space, steps, data, i);
+        add_task_internal(parallel_for_worker, (void *)&job, NULL, NULL, NULL, i);
     }
 
     ready();
     synchronize();
+    profile_region_end(job.profile);
 
     queue_count = old_queue_count;
-    // decrement the nest level
-    _nesting_level -= 1;
+    // release the pool
+    atomic_store(&_pool_busy, 0);
+}
+
+static void *
+parallel_for_async(void *fn, char **args, size_t *dimensions, size_t *steps,
+                   void *data, size_t inner_ndim, size_t array_count,
+                   size_t steps_count, int num_threads)
+{
+    return submit_parallel_for(parallel_for, fn, args, dimensions, steps,
+                               data, inner_ndim, array_count, steps_count,
+                               num_threads);
 }
 
 static void
@@ -528,6 +918,7 @@ add_task_internal(void *fn, void *args, void *dims, void *steps, void *data, int
     task->steps = steps;
     task->data = data;
     task->tid = tid;
+    queue->staged = 1;
 
     /* Move pivot */
     if ( ++queue_pivot == queue_count )
@@ -547,20 +938,37 @@ void thread_worker(void *arg)
 {
     Queue *queue = (Queue*)arg;
     Task *task;
+    ptrdiff_t seen = 0;
+    int spin_limit = SPIN_MAX;
+
+    /* Queue i is always run by the worker of thread ID i */
+    pin_current_thread((int)(queue - queues));
 
     while (1)
     {
-        /* Wait for the queue to be in READY state (i.e. for some task
-         * to need running), and switch it to RUNNING.
-         */
-        queue_state_wait(queue, READY, RUNNING);
+        /* Wait for ready() to publish a new set of tasks */
+        seen = wait_epoch(seen, &spin_limit);
+        if (!atomic_load(&queue->has_task))
+        {
+            continue;
+        }
 
         task = &queue->task;
         set_thread_id(task->tid);
         task->func(task->args, task->dims, task->steps, task->data);
 
-        /* Task is done. */
-        queue_state_wait(queue, RUNNING, DONE);
+        /* Task is done, wake synchronize() if this was the last one */
+        atomic_store(&queue->has_task, 0);
+        if (atomic_add(&_pending, -1) == 0)
+        {
+            atomic_fence();
+            if (atomic_load(&_launcher_parked))
+            {
+                queue_condition_lock(&done_cond);
+                queue_condition_signal(&done_cond);
+                queue_condition_unlock(&done_cond);
+            }
+        }
     }
 }
 
@@ -578,13 +986,16 @@ static void launch_threads(int count)
         /* set for use in parallel_for */
         NUM_THREADS = count;
         queues = malloc(sz);     /* this memory will leak */
-        /* Note this initializes the state to IDLE */
+        /* Note this clears the tasks */
         memset(queues, 0, sz);
+        deques = calloc(count, sizeof(Deque));
         queue_count = count;
 
+        queue_condition_init(&wake_cond);
+        queue_condition_init(&done_cond);
+
         for (i = 0; i < count; ++i)
         {
-            queue_condition_init(&queues[i].cond);
             numba_new_thread(thread_worker, &queues[i]);
         }
 
@@ -600,10 +1011,23 @@ static void synchronize(void)
         launch_threads(NUM_THREADS);
     }
     int i;
-    for (i = 0; i < queue_count; ++i)
+    for (i = 0; i < SPIN_MAX; ++i)
+    {
+        if (atomic_load(&_pending) == 0)
+            return;
+        cpu_relax();
+    }
+
+    queue_condition_lock(&done_cond);
+    atomic_store(&_launcher_parked, 1);
+    // pairs with the fence in thread_worker() after the last task is done
+    atomic_fence();
+    while (atomic_load(&_pending) != 0)
     {
-        queue_state_wait(&queues[i], DONE, IDLE);
+        queue_condition_wait(&done_cond);
     }
+    atomic_store(&_launcher_parked, 0);
+    queue_condition_unlock(&done_cond);
 }
 
 static void ready(void)
@@ -614,9 +1038,33 @@ static void ready(void)
         launch_threads(NUM_THREADS);
     }
     int i;
-    for (i = 0; i < queue_count; ++i)
+    ptrdiff_t count = 0;
+    for (i = 0; i < NUM_THREADS; ++i)
+    {
+        count += queues[i].staged;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    atomic_store(&_pending, count);
+    for (i = 0; i < NUM_THREADS; ++i)
     {
-        queue_state_wait(&queues[i], IDLE, READY);
+        if (queues[i].staged)
+        {
+            queues[i].staged = 0;
+            atomic_store(&queues[i].has_task, 1);
+        }
+    }
+    atomic_add(&_epoch, 1);
+    // pairs with the fence in wait_epoch()
+    atomic_fence();
+    if (atomic_load(&_sleepers))
+    {
+        queue_condition_lock(&wake_cond);
+        queue_condition_broadcast(&wake_cond);
+        queue_condition_unlock(&wake_cond);
     }
 }
 
@@ -624,11 +1072,23 @@ static void reset_after_fork(void)
 {
     free(queues);
     queues = NULL;
+    free(deques);
+    deques = NULL;
     if (_INIT_NUM_THREADS != -1)
     {
         NUM_THREADS = _INIT_NUM_THREADS;
     }
-    _nesting_level = 0;
+    _pool_busy = 0;
+    _epoch = 0;
+    _sleepers = 0;
+    _pending = 0;
+    _launcher_parked = 0;
+}
+
+static size_t
+get_nested_launches(void)
+{
+    return (size_t)atomic_load(&_nested_launches);
 }
 
 MOD_INIT(workqueue)
@@ -643,6 +1103,9 @@ MOD_INIT(workqueue)
     SetAttrStringFromVoidPointer(m, ready);
     SetAttrStringFromVoidPointer(m, add_task);
     SetAttrStringFromVoidPointer(m, parallel_for);
+    SetAttrStringFromVoidPointer(m, parallel_for_async);
+    SetAttrStringFromVoidPointer(m, parallel_for_poll);
+    SetAttrStringFromVoidPointer(m, parallel_for_wait);
     SetAttrStringFromVoidPointer(m, do_scheduling_signed);
     SetAttrStringFromVoidPointer(m, do_scheduling_unsigned);
     SetAttrStringFromVoidPointer(m, set_num_threads);
@@ -651,6 +1114,14 @@ MOD_INIT(workqueue)
     SetAttrStringFromVoidPointer(m, set_parallel_chunksize);
     SetAttrStringFromVoidPointer(m, get_parallel_chunksize);
     SetAttrStringFromVoidPointer(m, get_sched_size);
+    SetAttrStringFromVoidPointer(m, set_parallel_schedule);
+    SetAttrStringFromVoidPointer(m, get_parallel_schedule);
+    SetAttrStringFromVoidPointer(m, set_parallel_tile_itemsize);
+    SetAttrStringFromVoidPointer(m, set_parallel_prechunked);
+    SetAttrStringFromVoidPointer(m, set_parallel_profiling);
+    SetAttrStringFromVoidPointer(m, read_parallel_profile);
+    SetAttrStringFromVoidPointer(m, set_thread_affinity);
+    SetAttrStringFromVoidPointer(m, get_nested_launches);
 
     return MOD_SUCCESS_VAL(m);
 }
@@ -1,18 +1,5 @@
 typedef struct opaque_thread * thread_pointer;
 
-enum QUEUE_STATE
-{
-    /*
-    The queue has 4 states:
-
-    IDLE: not doing anything
-    READY: tasks enqueued; signal workers to start
-    RUNNING: workers running
-    DONE: workers completed
-    */
-    IDLE = 0, READY, RUNNING, DONE
-};
-
 /* Launch `count` number of threads and create the associated thread queue.
 Must invoke once before each add_task() is used.
 *Warning* queues memory are leaked at interpreter tear down!
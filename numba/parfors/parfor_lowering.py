@@ -1695,7 +1695,21 @@ def call_parallel_gufunc(lowerer, cres, gu_signature, outer_sig, expr_args, expr
                                                   ("Invalid number of threads. "
                                                    "This likely indicates a bug in Numba.",))
 
-    get_sched_size_fnty = llvmlite.ir.FunctionType(uintp_t, [uintp_t, uintp_t, intp_ptr_t, intp_ptr_t])
+    # A tiled schedule sizes its tiles after the items of the parfor's arrays
+    itemsizes = [context.get_abi_sizeof(context.get_data_type(t.dtype))
+                 for t in expr_arg_types if isinstance(t, types.Array)]
+    set_tile_itemsize = cgutils.get_or_insert_function(
+        builder.module,
+        llvmlite.ir.FunctionType(llvmlite.ir.VoidType(), [uintp_t]),
+        name="set_parallel_tile_itemsize")
+    builder.call(set_tile_itemsize,
+                 [context.get_constant(types.uintp, max(itemsizes, default=8))])
+
+    # The kind and parameters of the schedule, as NUMBA_SCHED_PARAMS entries
+    # filled by get_sched_size() for do_scheduling_*()
+    sched_params = cgutils.alloca_once(builder, uintp_t, size=3,
+                                       name="sched_params")
+    get_sched_size_fnty = llvmlite.ir.FunctionType(uintp_t, [uintp_t, uintp_t, intp_ptr_t, intp_ptr_t, uintp_ptr_t])
     get_sched_size = cgutils.get_or_insert_function(
         builder.module,
         get_sched_size_fnty,
@@ -1703,7 +1717,8 @@ def call_parallel_gufunc(lowerer, cres, gu_signature, outer_sig, expr_args, expr
     num_divisions = builder.call(get_sched_size, [num_threads,
                                                   context.get_constant(types.uintp, num_dim),
                                                   dim_starts,
-                                                  dim_stops])
+                                                  dim_stops,
+                                                  sched_params])
     builder.call(set_chunksize, [zero])
 
     multiplier = context.get_constant(types.uintp, num_dim * 2)
@@ -1712,7 +1727,8 @@ def call_parallel_gufunc(lowerer, cres, gu_signature, outer_sig, expr_args, expr
 
     debug_flag = 1 if config.DEBUG_ARRAY_OPT else 0
     scheduling_fnty = llvmlite.ir.FunctionType(
-        intp_ptr_t, [uintp_t, intp_ptr_t, intp_ptr_t, uintp_t, sched_ptr_type, intp_t])
+        intp_ptr_t, [uintp_t, intp_ptr_t, intp_ptr_t, uintp_t, sched_ptr_type, intp_t,
+                     uintp_ptr_t])
     if index_var_typ.signed:
         do_scheduling = cgutils.get_or_insert_function(builder.module,
                                                        scheduling_fnty,
@@ -1727,7 +1743,7 @@ def call_parallel_gufunc(lowerer, cres, gu_signature, outer_sig, expr_args, expr
             context.get_constant(
                 types.uintp, num_dim), dim_starts, dim_stops, num_divisions,
             sched, context.get_constant(
-                    types.intp, debug_flag)])
+                    types.intp, debug_flag), sched_params])
 
     # Get the LLVM vars for the Numba IR reduction array vars.
     redarrs = [lowerer.loadvar(redarrdict[x].name) for x in redvars]
@@ -1907,6 +1923,15 @@ def call_parallel_gufunc(lowerer, cres, gu_signature, outer_sig, expr_args, expr
     fn = cgutils.get_or_insert_function(builder.module, fnty, wrapper_name)
     context.active_code_library.add_linking_library(info.library)
 
+    # The entries of the launch are the chunks of the schedule, so that the
+    # threading layer hands them out as they are rather than chunking them
+    # again after the schedule kind
+    set_prechunked = cgutils.get_or_insert_function(
+        builder.module,
+        llvmlite.ir.FunctionType(llvmlite.ir.VoidType(), []),
+        name="set_parallel_prechunked")
+    builder.call(set_prechunked, [])
+
     if config.DEBUG_ARRAY_OPT:
         cgutils.printf(builder, "before calling kernel %p\n", fn)
     builder.call(fn, [args, shapes, steps, data])
@@ -84,8 +84,8 @@ class Dict(object):
 
     def dict_new_minsize(self, key_size, val_size):
         dp = ctypes.c_void_p()
-        status = self.tc.numba_dict_new_minsize(
-            ctypes.byref(dp), key_size, val_size,
+        status = self.tc.numba_dict_new_flags(
+            ctypes.byref(dp), 0, key_size, val_size, self.tc.dict_flags,
         )
         self.tc.assertEqual(status, 0)
         return dp
@@ -100,6 +100,29 @@ class Dict(object):
         )
         self.tc.assertGreaterEqual(status, 0)
 
+    def dict_insert_many(self, keys_bytes, vals_bytes):
+        n = len(keys_bytes)
+        hashes = (ctypes.c_ssize_t * n)(*map(hash, keys_bytes))
+        status = self.tc.numba_dict_insert_many(
+            self.dp, b''.join(keys_bytes), hashes, b''.join(vals_bytes), n,
+        )
+        self.tc.assertEqual(status, 0)
+
+    def dict_lookup_many(self, keys_bytes):
+        n = len(keys_bytes)
+        hashes = (ctypes.c_ssize_t * n)(*map(hash, keys_bytes))
+        out_vals = ctypes.create_string_buffer(self.valsize * n)
+        out_found = ctypes.create_string_buffer(n)
+        nfound = self.tc.numba_dict_lookup_many(
+            self.dp, b''.join(keys_bytes), hashes, out_vals, out_found, n,
+        )
+        self.tc.assertGreaterEqual(nfound, 0)
+        vals = [out_vals.raw[i * self.valsize:(i + 1) * self.valsize]
+                for i in range(n)]
+        found = list(out_found.raw)
+        self.tc.assertEqual(nfound, sum(found))
+        return vals, found
+
     def dict_lookup(self, key_bytes):
         hashval = hash(key_bytes)
         oldval_bytes = ctypes.create_string_buffer(self.valsize)
@@ -208,6 +231,9 @@ class ParametrizedType(types.Type):
 
 
 class TestDictImpl(TestCase):
+    # flags of the dicts created by the tests
+    dict_flags = 0
+
     def setUp(self):
         """Bind to the c_helper library and provide the ctypes wrapper.
         """
@@ -238,6 +264,24 @@ class TestDictImpl(TestCase):
                 ctypes.c_ssize_t,        # val_size
             ],
         )
+        # numba_dict_new_flags(
+        #    NB_Dict **out,
+        #    Py_ssize_t size,
+        #    Py_ssize_t key_size,
+        #    Py_ssize_t val_size,
+        #    int flags
+        # )
+        self.numba_dict_new_flags = wrap(
+            'dict_new_flags',
+            ctypes.c_int,
+            [
+                ctypes.POINTER(dict_t),  # out
+                ctypes.c_ssize_t,        # size
+                ctypes.c_ssize_t,        # key_size
+                ctypes.c_ssize_t,        # val_size
+                ctypes.c_int,            # flags
+            ],
+        )
         # numba_dict_free(NB_Dict *d)
         self.numba_dict_free = wrap(
             'dict_free',
@@ -282,6 +326,44 @@ class TestDictImpl(TestCase):
                 ctypes.c_char_p,    # oldval_bytes
             ],
         )
+        # numba_dict_insert_many(
+        #     NB_Dict         *d,
+        #     const char      *keys,
+        #     const Py_hash_t *hashes,
+        #     const char      *vals,
+        #     Py_ssize_t       n
+        #     )
+        self.numba_dict_insert_many = wrap(
+            'dict_insert_many',
+            ctypes.c_int,
+            [
+                dict_t,                     # d
+                ctypes.c_char_p,            # keys
+                ctypes.POINTER(hash_t),     # hashes
+                ctypes.c_char_p,            # vals
+                ctypes.c_ssize_t,           # n
+            ],
+        )
+        # numba_dict_lookup_many(
+        #     NB_Dict         *d,
+        #     const char      *keys,
+        #     const Py_hash_t *hashes,
+        #     char            *out_vals,
+        #     char            *out_found,
+        #     Py_ssize_t       n
+        #     )
+        self.numba_dict_lookup_many = wrap(
+            'dict_lookup_many',
+            ctypes.c_ssize_t,
+            [
+                dict_t,                     # d
+                ctypes.c_char_p,            # keys
+                ctypes.POINTER(hash_t),     # hashes
+                ctypes.c_char_p,            # out_vals
+                ctypes.c_char_p,            # out_found
+                ctypes.c_ssize_t,           # n
+            ],
+        )
         # numba_dict_delitem(
         #     NB_Dict *d,
         #     Py_hash_t hash,
@@ -396,6 +478,35 @@ class TestDictImpl(TestCase):
         for i in range(nmax):
             self.assertEqual(d[make_key(i)], make_val(i))
 
+    def test_insert_lookup_many(self):
+        # Tests the batch insertion and lookup, with duplicated keys and
+        # enough keys for the prefetching of large tables.
+        d = Dict(self, 8, 8)
+        d['00000000'] = 'old_0000'
+        nmax = 30000
+        keys = [random.randrange(nmax) for _ in range(nmax)]
+        expect = {'00000000': 'old_0000'}
+        for i, k in enumerate(keys):
+            expect['{:08}'.format(k)] = 'v{:07}'.format(i)
+        d.dict_insert_many(
+            ['{:08}'.format(k).encode() for k in keys],
+            ['v{:07}'.format(i).encode() for i in range(nmax)],
+        )
+        self.assertEqual(len(d), len(expect))
+        self.assertEqual([k for k, v in d.items()], list(expect))
+        for k, v in expect.items():
+            self.assertEqual(d[k], v)
+
+        probes = ['{:08}'.format(i) for i in range(2 * nmax)]
+        vals, found = d.dict_lookup_many([k.encode() for k in probes])
+        for k, v, f in zip(probes, vals, found):
+            if k in expect:
+                self.assertEqual(f, 1)
+                self.assertEqual(v.decode(), expect[k])
+            else:
+                self.assertEqual(f, 0)
+                self.assertEqual(v, bytes(8))
+
     def test_insertion_many(self):
         # Test insertion for differently sized dict
         # Around minsize
@@ -649,3 +760,15 @@ class TestDictImpl(TestCase):
 
         for ii in range(50):  # <- sometimes works a few times
             self.assertIsNone(set_parametrized_data(x, y))
+
+
+class TestDictImplGrouped(TestDictImpl):
+    """Runs the tests on dicts of the grouped layout
+    """
+    dict_flags = 1    # NB_DICT_GROUPED
+
+
+class TestDictImplPodKeys(TestDictImpl):
+    """Runs the tests on dicts of plain data keys
+    """
+    dict_flags = 2    # NB_DICT_POD_KEYS
@@ -6,20 +6,22 @@ correctly.  Detailed testing of the underlying dictionary operations is done
 in test_dictimpl.py.
 """
 
+import collections
 import sys
 import warnings
 
 import numpy as np
 
-from numba import njit, literally
+from numba import njit, literally, prange
 from numba import int32, int64, float32, float64
 from numba import typeof
-from numba.typed import Dict, dictobject
+from numba.typed import Dict, ConcurrentDict, dictobject
 from numba.typed.typedobjectutils import _sentry_safe_cast
 from numba.core.errors import TypingError
 from numba.core import types
 from numba.tests.support import (TestCase, MemoryLeakMixin, unittest,
-                                 override_config, forbid_codegen)
+                                 override_config, forbid_codegen,
+                                 skip_parfors_unsupported)
 from numba.experimental import jitclass
 from numba.extending import overload
 
@@ -281,6 +283,26 @@ class TestDictObject(MemoryLeakMixin, TestCase):
         with self.assertRaises(KeyError):
             foo(keys, vals, 0)
 
+    def test_dict_delitem_sliding_window(self):
+        # Deletions compact and shrink the table, which must keep the order
+        # and the references of the items
+        @njit
+        def foo(n, window):
+            d = dictobject.new_dict(int64, types.unicode_type)
+            for i in range(n):
+                d[i] = str(i)
+                if i >= window:
+                    del d[i - window]
+            items = list(d.items())
+            while len(d) > 1:
+                d.popitem()
+            return items, list(d.items())
+
+        items, rest = foo(10000, 7)
+        expect = [(i, str(i)) for i in range(10000 - 7, 10000)]
+        self.assertEqual(items, expect)
+        self.assertEqual(rest, expect[:1])
+
     def test_dict_clear(self):
         """
         Exercise dict.clear
@@ -1162,6 +1184,168 @@ class TestTypedDict(MemoryLeakMixin, TestCase):
         d[(1, 1)] = 12345
         self.assertEqual(d[(1, 1)], d.get((1, 1)))
 
+    def test_grouped_layout(self):
+        @njit
+        def producer(n):
+            d = Dict.empty(int64, int64, layout='grouped')
+            for i in range(n):
+                d[i * 7919] = i
+            for i in range(0, n, 3):
+                del d[i * 7919]
+            copied = d.copy()
+            return d, dictobject._dict_flags(d), dictobject._dict_flags(copied)
+
+        @njit
+        def layout_flags(d):
+            return dictobject._dict_flags(d)
+
+        grouped = dictobject.DictFlags.GROUPED
+        n = 1000
+        d, flags, copy_flags = producer(n)
+        self.assertEqual(flags & grouped, grouped)
+        self.assertEqual(copy_flags, flags)
+        expect = {i * 7919: i for i in range(n) if i % 3}
+        # insertion order is kept
+        self.assertEqual(list(d.items()), list(expect.items()))
+        for k in range(-10, n * 7919, 997):
+            self.assertEqual(d.get(k), expect.get(k))
+
+        d = Dict.empty(int64, int64, layout='grouped')
+        self.assertEqual(layout_flags(d) & grouped, grouped)
+        self.assertEqual(layout_flags(Dict.empty(int64, int64)) & grouped, 0)
+        for i in range(100):
+            d[i] = -i
+        while d:
+            k, v = d.popitem()
+            self.assertEqual(v, -k)
+            self.assertNotIn(k, d)
+
+        with self.assertRaises(ValueError) as raises:
+            Dict.empty(int64, int64, layout='unknown')
+        self.assertIn("the dict layout must be one of", str(raises.exception))
+
+    def test_pod_keys(self):
+        @njit
+        def fill(keys):
+            d = Dict()
+            for i in range(len(keys)):
+                d[keys[i]] = i
+            ok = len(d) == len(keys)
+            for i in range(len(keys)):
+                ok &= d[keys[i]] == i
+            return ok, dictobject._dict_flags(d)
+
+        @njit
+        def fill_tuples(keys):
+            d = Dict()
+            for i in range(len(keys)):
+                d[(keys[i], keys[i], keys[i])] = i
+            ok = len(d) == len(keys)
+            for i in range(len(keys)):
+                ok &= d[(keys[i], keys[i], keys[i])] == i
+            return ok, dictobject._dict_flags(d)
+
+        @njit
+        def str_flags():
+            d = Dict()
+            d['a'] = 1
+            return dictobject._dict_flags(d)
+
+        pod = dictobject.DictFlags.POD_KEYS
+        # the key sizes compared inline, and others
+        for dtype in (np.int8, np.int16, np.int32, np.int64, np.complex128):
+            ok, flags = fill(np.arange(100).astype(dtype))
+            self.assertTrue(ok)
+            self.assertEqual(flags & pod, pod)
+        for dtype in (np.int16, np.int32):
+            ok, flags = fill_tuples(np.arange(100).astype(dtype))
+            self.assertTrue(ok)
+            self.assertEqual(flags & pod, pod)
+        # keys with reference counting are not plain data
+        self.assertEqual(str_flags() & pod, 0)
+
+    def test_from_arrays(self):
+        @njit
+        def from_arrays(keys, values):
+            return Dict.from_arrays(keys, values)
+
+        @njit
+        def from_arrays_grouped(keys, values):
+            d = Dict.from_arrays(keys, values, layout='grouped')
+            return d, dictobject._dict_flags(d)
+
+        rng = np.random.RandomState(0)
+        keys = rng.randint(0, 500, size=1000)
+        values = rng.random_sample(1000)
+        # later values of duplicated keys win
+        expect = dict(zip(keys.tolist(), values.tolist()))
+
+        for d in (from_arrays(keys, values), Dict.from_arrays(keys, values)):
+            self.assertEqual(typeof(d), types.DictType(int64, float64))
+            self.assertEqual(list(d.items()), list(expect.items()))
+        d, flags = from_arrays_grouped(keys, values)
+        grouped = dictobject.DictFlags.GROUPED
+        self.assertEqual(flags & grouped, grouped)
+        self.assertEqual(dict(d), expect)
+
+        with self.assertRaises(ValueError) as raises:
+            from_arrays(keys, values[:-1])
+        self.assertIn("same length", str(raises.exception))
+        with self.assertRaises(TypingError) as raises:
+            from_arrays(keys.reshape(10, 100), values.reshape(10, 100))
+        self.assertIn("keys must be a 1d array", str(raises.exception))
+
+    def test_insert_lookup_many(self):
+        @njit
+        def insert_many(d, keys, values):
+            d.insert_many(keys, values)
+
+        @njit
+        def lookup_many(d, keys):
+            return d.lookup_many(keys)
+
+        d = Dict.empty(int64, float32)
+        d[-1] = 1.5
+        keys = np.arange(1000)
+        values = np.arange(1000.)
+        # non-contiguous arrays, of other types than the dict
+        insert_many(d, keys[::2], values[::2])
+        d.insert_many(keys[1:20:2].astype(np.int32), values[1:20:2])
+        expect = {-1: 1.5}
+        expect.update(zip(range(0, 1000, 2), range(0, 1000, 2)))
+        expect.update(zip(range(1, 20, 2), range(1, 20, 2)))
+        self.assertEqual(dict(d), expect)
+
+        probes = np.arange(-5, 1005)
+        for got, found in (lookup_many(d, probes), d.lookup_many(probes)):
+            self.assertEqual(got.dtype, np.float32)
+            self.assertEqual(found.dtype, np.bool_)
+            np.testing.assert_equal(
+                found, [k in expect for k in probes.tolist()])
+            np.testing.assert_equal(
+                got, [expect.get(k, 0) for k in probes.tolist()])
+
+        with self.assertRaises(TypingError) as raises:
+            lookup_many(Dict.empty(int64, types.unicode_type), keys)
+        self.assertIn("lookup_many() needs numeric or boolean values",
+                      str(raises.exception))
+
+        # the arrays are cast as the keys and values of d[k] = v are
+        with self.assertRaises(TypingError) as raises:
+            insert_many(d, values, values)
+        self.assertIn("cannot safely cast float64 to int64",
+                      str(raises.exception))
+        with self.assertRaises(TypingError) as raises:
+            lookup_many(d, probes.astype(np.complex128))
+        self.assertIn("cannot safely cast complex128 to int64",
+                      str(raises.exception))
+
+        # an untyped Dict has no value type to look up
+        with self.assertRaises(TypeError) as raises:
+            Dict().lookup_many(keys)
+        self.assertIn("lookup_many() needs the value type of the Dict",
+                      str(raises.exception))
+
     def check_stringify(self, strfn, prefix=False):
         nbd = Dict.empty(int32, int32)
         d = {}
@@ -1759,6 +1943,140 @@ class TestDictWithJitclass(TestCase):
         self.assertEqual(d[1].a, 101)
 
 
+@njit
+def _add(a, b):
+    return a + b
+
+
+@njit
+def _add_positive(a, b):
+    if b < 0:
+        raise ValueError("negative increment")
+    return a + b
+
+
+class TestConcurrentDict(MemoryLeakMixin, TestCase):
+
+    def test_basic(self):
+        @njit
+        def foo(n):
+            cd = ConcurrentDict.empty(types.int64, types.float64, nshards=5)
+            for i in range(n):
+                cd[i] = i * 0.5
+            del cd[0]
+            popped = cd.pop(1)
+            missing = cd.pop(-1, -1.)
+            return (cd, cd.nshards(), len(cd), cd[n - 1], cd.get(-1, 2.),
+                    2 in cd, 0 in cd, popped, missing)
+
+        n = 1000
+        cd, nshards, length, last, default, has2, has0, popped, missing = \
+            foo(n)
+        self.assertIsInstance(cd, ConcurrentDict)
+        self.assertEqual(typeof(cd),
+                         types.ConcurrentDictType(types.int64, types.float64))
+        self.assertEqual(nshards, 8)
+        self.assertEqual(length, n - 2)
+        self.assertEqual(last, (n - 1) * 0.5)
+        self.assertEqual(default, 2.)
+        self.assertTrue(has2)
+        self.assertFalse(has0)
+        self.assertEqual(popped, 0.5)
+        self.assertEqual(missing, -1.)
+        expect = {i: i * 0.5 for i in range(2, n)}
+        self.assertEqual(dict(cd.to_dict()), expect)
+        self.assertEqual(dict(cd), expect)
+
+    def test_keyerror(self):
+        @njit
+        def foo(cd, k):
+            return cd[k]
+
+        cd = ConcurrentDict.empty(types.unicode_type, types.int64)
+        cd['a'] = 1
+        self.assertEqual(foo(cd, 'a'), 1)
+        with self.assertRaises(KeyError):
+            foo(cd, 'b')
+
+    def test_merge(self):
+        @njit
+        def foo(cd, keys):
+            for k in keys:
+                cd.merge(k, 1, _add)
+            return cd.merge(keys[0], 10, _add)
+
+        keys = np.random.RandomState(0).randint(0, 50, size=1000)
+        for layout in ('compact', 'grouped'):
+            cd = ConcurrentDict.empty(types.int64, types.int64,
+                                      layout=layout)
+            self.assertEqual(foo(cd, keys),
+                             np.count_nonzero(keys == keys[0]) + 10)
+            expect = collections.Counter(keys.tolist())
+            expect[keys[0]] += 10
+            self.assertEqual(dict(cd.to_dict()), dict(expect))
+
+    def test_merge_raises(self):
+        # the lock of the shard is not held when combine raises, so the
+        # dict stays usable
+        cd = ConcurrentDict.empty(types.unicode_type, types.int64,
+                                  nshards=1)
+        self.assertEqual(cd.merge('a', 1, _add_positive), 1)
+        with self.assertRaises(ValueError) as raises:
+            cd.merge('a', -1, _add_positive)
+        self.assertIn("negative increment", str(raises.exception))
+        self.assertEqual(cd.merge('a', 2, _add_positive), 3)
+        cd['b'] = 4
+        self.assertEqual(dict(cd), {'a': 3, 'b': 4})
+
+    def test_iter(self):
+        cd = ConcurrentDict.empty(types.int64, types.int64, nshards=8)
+        self.assertEqual(list(cd), [])
+        for i in range(100):
+            cd[i] = -i
+        keys = list(cd)
+        self.assertEqual(sorted(keys), list(range(100)))
+        self.assertEqual(dict(cd), {i: -i for i in range(100)})
+
+    def test_python_api(self):
+        cd = ConcurrentDict.empty(types.unicode_type, types.int64,
+                                  nshards=1)
+        self.assertEqual(cd.nshards(), 1)
+        cd['a'] = 1
+        self.assertEqual(cd.merge('a', 2, _add), 3)
+        self.assertEqual(cd.merge('b', 2, _add), 2)
+        self.assertEqual(len(cd), 2)
+        self.assertIn('b', cd)
+        del cd['b']
+        self.assertNotIn('b', cd)
+        self.assertEqual(cd.get('b', 5), 5)
+        self.assertEqual(dict(cd), {'a': 3})
+        self.assertIsInstance(cd.to_dict(), Dict)
+
+    @skip_parfors_unsupported
+    def test_prange_merge(self):
+        @njit(parallel=True)
+        def histogram(keys, nshards):
+            cd = ConcurrentDict.empty(types.int64, types.int64, nshards)
+            for i in prange(keys.size):
+                cd.merge(keys[i], 1, _add)
+            return cd
+
+        @njit(parallel=True)
+        def fill(cd, keys):
+            for i in prange(keys.size):
+                cd[keys[i]] = keys[i] * 2
+
+        keys = np.random.RandomState(0).randint(0, 1000, size=100000)
+        expect = collections.Counter(keys.tolist())
+        for nshards in (1, 0):
+            cd = histogram(keys, nshards)
+            self.assertEqual(dict(cd.to_dict()), dict(expect))
+
+        cd = ConcurrentDict.empty(types.int64, types.int64)
+        fill(cd, keys)
+        self.assertEqual(dict(cd.to_dict()), {k: k * 2 for k in expect})
+
+
 class TestNoJit(TestCase):
     """Exercise dictionary creation with JIT disabled. """
 
@@ -1780,6 +2098,14 @@ class TestNoJit(TestCase):
                 d = Dict.empty(types.int32, types.float32)
                 self.assertEqual(type(d), dict)
 
+    def test_concurrent_dict_create_no_jit_using_empty(self):
+        with override_config('DISABLE_JIT', True):
+            with forbid_codegen():
+                cd = ConcurrentDict.empty(types.int32, types.float32)
+                self.assertIsInstance(cd, dict)
+                self.assertEqual(cd.merge(1, 2., _add.py_func), 2.)
+                self.assertEqual(cd.merge(1, 2., _add.py_func), 4.)
+
 
 class TestDictIterator(TestCase):
     def test_dict_iterator(self):
@@ -1,5 +1,6 @@
 import multiprocessing
 import platform
+import sys
 import threading
 import pickle
 import weakref
@@ -158,6 +159,32 @@ class TestDispatcher(BaseTest):
             # Implicit conversion of complex to int disallowed
             c_add(12.3, 45.6j)
 
+    def test_resolve_cache(self):
+        c_add = jit(nopython=True)(add)
+        c_add(1, 2)
+        c_add(1, 2)
+        hits = c_add._resolve_cache_hits
+        misses = c_add._resolve_cache_misses
+        for i in range(10):
+            self.assertPreciseEqual(c_add(i, 2), i + 2)
+        self.assertEqual(c_add._resolve_cache_hits, hits + 10)
+        self.assertEqual(c_add._resolve_cache_misses, misses)
+
+        # Inserting a new overload invalidates the cache
+        self.assertPreciseEqual(c_add(1.5, 2.5), 4.0)
+        misses = c_add._resolve_cache_misses
+        self.assertPreciseEqual(c_add(1, 2), 3)
+        self.assertEqual(c_add._resolve_cache_misses, misses + 1)
+        self.assertPreciseEqual(c_add(1.5, 2.5), 4.0)
+        self.assertEqual(c_add._resolve_cache_misses, misses + 2)
+
+        # The cache is keyed on the selection flags too: once compilation
+        # is disabled, unsafe conversions are allowed.
+        c_add.disable_compile()
+        self.assertPreciseEqual(c_add(1, 2.5), 3.5)
+        self.assertPreciseEqual(c_add(1, 2), 3)
+        self.assertEqual(len(c_add.overloads), 2)
+
     def test_ambiguous_new_version(self):
         """Test compiling new version in an ambiguous case
         """
@@ -518,6 +545,67 @@ class TestDispatcher(BaseTest):
         check("F_contig_aligned", F_contig_aligned)
         check("C_contig_misaligned", C_contig_misaligned)
 
+    def test_array_dispatch_uncommon_types(self):
+        # Arrays outside of the direct typecode lookup table (other dtypes,
+        # more than 5 dimensions, read-only arrays) are served by a
+        # secondary cache, check it keeps them apart.
+        @jit(nopython=True)
+        def foo(a):
+            return a.ndim
+
+        readonly = np.zeros(3)
+        readonly.flags.writeable = False
+        arrays = [np.zeros(3, dtype=np.bool_),
+                  np.zeros(3, dtype='M8[ns]'),
+                  np.zeros(3, dtype='M8[s]'),
+                  np.zeros((1,) * 6),
+                  np.zeros((1,) * 7),
+                  np.zeros((1,) * 7, dtype=np.bool_),
+                  np.zeros(3, dtype=[('a', np.int32), ('b', np.float64)]),
+                  readonly]
+        for _ in range(2):
+            for a in arrays:
+                self.assertEqual(foo(a), a.ndim)
+                # A fresh array of the same type hits the cache
+                self.assertEqual(foo(a.copy()), a.ndim)
+        self.assertEqual(len(foo.signatures), len(arrays) + 1)
+        tys = [sig[0] for sig in foo.signatures]
+        self.assertIn(typeof(readonly), tys)
+        self.assertIn(typeof(np.zeros(3)), tys)
+
+    def test_fingerprint_dispatch(self):
+        # Nested tuples have fingerprints longer than the writer's static
+        # buffer; the cache must still tell apart values of distinct types.
+        @jit(nopython=True)
+        def foo(t):
+            return len(t)
+
+        a = np.zeros(3)
+        b = np.zeros(3, dtype=np.int32)
+        values = [((a, a), (a, (a, a)), a, (a, a)),
+                  ((a, a), (a, (a, b)), a, (a, a)),
+                  ((a, b), (a, (a, a)), a, (a, a)),
+                  (1, 2.5, (3, 4j))]
+        for _ in range(3):
+            for v in values:
+                self.assertEqual(foo(v), len(v))
+        self.assertEqual(len(foo.signatures), len(values))
+
+    def test_typed_container_dispatch(self):
+        from numba.typed import Dict, List
+
+        @jit(nopython=True)
+        def foo(c):
+            return len(c)
+
+        containers = [List([1, 2]), List([1.5]), List([(1, 2)]),
+                      Dict.empty(types.int64, types.float64),
+                      Dict.empty(types.unicode_type, types.int64)]
+        for _ in range(3):
+            for c in containers:
+                self.assertEqual(foo(c), len(c))
+        self.assertEqual(len(foo.signatures), len(containers))
+
     def test_dispatch_recompiles_for_scalars(self):
         # for context #3612, essentially, compiling a lambda x:x for a
         # numerically wide type (everything can be converted to a complex128)
@@ -655,6 +743,61 @@ class TestSignatureHandlingObjectMode(TestSignatureHandling):
     jit_args = dict(forceobj=True)
 
 
+def make_sum_usecase(nargs):
+    argnames = ', '.join('a%d' % i for i in range(nargs))
+    body = ' + '.join('a%d' % i for i in range(nargs)) or '0'
+    ns = {}
+    exec("def sum_usecase(%s):\n    return %s" % (argnames, body), ns)
+    return ns['sum_usecase']
+
+
+@unittest.skipIf(sys.version_info < (3, 8), "vectorcall requires Python 3.8+")
+class TestDispatcherVectorcall(BaseTest):
+    """
+    Test the vectorcall entry point of the dispatcher and the calling
+    convention of the compiled wrappers.
+    """
+
+    def test_vectorcall_flag(self):
+        Py_TPFLAGS_HAVE_VECTORCALL = 1 << 11
+        f = jit(nopython=True)(add)
+        self.assertTrue(type(f).__flags__ & Py_TPFLAGS_HAVE_VECTORCALL)
+
+    def test_argument_counts(self):
+        # Below and above the size of the typecode buffer of the fast path
+        for nargs in (0, 1, 4, 16, 30):
+            f, check = self.compile_func(make_sum_usecase(nargs))
+            args = tuple(range(nargs))
+            check(*args)
+            check(*args)
+            self.assertEqual(len(f.overloads), 1)
+
+    def test_mixed_call_styles(self):
+        # Positional calls take the fast path, the others are folded
+        # by the generic path; they must all share one specialization.
+        f, check = self.compile_func(addsub_defaults)
+        check(3, 4, 10)
+        check(3, 4, z=10)
+        check(3)
+        check(3, 4, 10)
+        self.assertEqual(len(f.overloads), 1)
+        # A new type triggers compilation through the generic path
+        check(3.5, 4, 10)
+        self.assertEqual(len(f.overloads), 2)
+
+    def test_compiled_wrapper(self):
+        f = jit(nopython=True)(add)
+        f(1, 2)
+        cfunc = f.overloads[f.signatures[0]].entry_point
+        self.assertEqual(cfunc(1, 2), 3)
+        with self.assertRaises(TypeError) as raises:
+            cfunc(1)
+        self.assertIn("expected 2 arguments, got 1", str(raises.exception))
+        with self.assertRaises(TypeError) as raises:
+            cfunc(1, y=2)
+        self.assertIn("takes no keyword arguments", str(raises.exception))
+
+
 class TestGeneratedDispatcher(TestCase):
     """
     Tests for @generated_jit.
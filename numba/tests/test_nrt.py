@@ -1,13 +1,17 @@
+import ctypes
 import math
+import mmap
 import os
 import platform
 import sys
 import re
+import threading
 
 import numpy as np
 
 from numba import njit
-from numba.core import types
+from numba.typed import List
+from numba.core import config, types
 from numba.core.compiler import compile_isolated, Flags
 from numba.core.runtime import (
     rtsys,
@@ -24,7 +28,8 @@ import numba.core.typing.cffi_utils as cffi_support
 from numba.core.unsafe.nrt import NRT_get_api
 
 from numba.tests.support import (MemoryLeakMixin, TestCase, temp_directory,
-                                 import_dynamic, skip_if_32bit)
+                                 import_dynamic, skip_if_32bit,
+                                 run_in_subprocess)
 from numba.core.registry import cpu_target
 import unittest
 
@@ -304,6 +309,440 @@ class TestTracemalloc(unittest.TestCase):
         self.assertLess(stat.size, N * 0.01)
 
 
+needs_nrt_stats = unittest.skipUnless(rtsys.stats_enabled,
+                                      'NRT built without statistics')
+
+
+class TestNrtStats(TestCase):
+    """
+    Test the sharded NRT allocation counters.
+    """
+
+    @needs_nrt_stats
+    def test_threaded_stats(self):
+        @njit(nogil=True)
+        def work(n):
+            acc = 0.
+            for i in range(n):
+                acc += np.ones(i % 5 + 1).sum()
+            return acc
+
+        nthreads, niters = 8, 1000
+        work(1)
+        old = rtsys.get_allocation_stats()
+        threads = [threading.Thread(target=work, args=(niters,))
+                   for _ in range(nthreads)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        new = rtsys.get_allocation_stats()
+        # No update may be lost even though the threads share no counter
+        total = nthreads * niters
+        self.assertEqual(new.alloc - old.alloc, total)
+        self.assertEqual(new.free - old.free, total)
+        self.assertEqual(new.mi_alloc - old.mi_alloc, total)
+        self.assertEqual(new.mi_free - old.mi_free, total)
+
+
+class TestNrtSlabAllocator(TestCase):
+    """
+    Test the thread-caching slab allocator of NRT.
+    """
+
+    @needs_nrt_stats
+    def test_slab_allocator(self):
+        # The allocator can only be switched while no NRT memory is alive,
+        # so exercise it in a fresh process.
+        code = """if 1:
+            import threading
+            import numpy as np
+            from numba import njit
+            from numba.core.runtime import rtsys
+
+            @njit
+            def work(n):
+                acc = 0.
+                for i in range(n):
+                    acc += np.arange(i % 7 + 1).sum()
+                return acc + np.ones(100000).sum()
+
+            expect = work.py_func(1000)
+            threads = [threading.Thread(target=work, args=(1000,))
+                       for _ in range(4)]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+            assert work(1000) == expect
+
+            stats = rtsys.get_slab_stats()
+            assert stats[0].block_size == 16, stats
+            assert stats[-1].block_size == 4096, stats
+            assert sum(s.alloc for s in stats) >= 5 * 1000, stats
+            assert all(s.alloc == s.free for s in stats), stats
+            assert all(s.chunks > 0 for s in stats if s.alloc), stats
+            alloc_stats = rtsys.get_allocation_stats()
+            assert alloc_stats.alloc == alloc_stats.free, alloc_stats
+            print("OK")
+        """
+        env = os.environ.copy()
+        env['NUMBA_NRT_SLAB_ALLOCATOR'] = '4096'
+        out, _ = run_in_subprocess(code, env=env)
+        self.assertIn("OK", out.decode())
+
+    @needs_nrt_stats
+    def test_thread_exit_drains_cache(self):
+        # The blocks cached by an exiting thread go back to the shared
+        # depot, so a sequence of short-lived threads keeps reusing the
+        # same chunk instead of carving a new one each.
+        code = """if 1:
+            import threading
+            import numpy as np
+            from numba import njit
+            from numba.core.runtime import rtsys
+
+            @njit
+            def work():
+                # A single block of the largest size class
+                return np.ones(400).sum()
+
+            for _ in range(20):
+                t = threading.Thread(target=work)
+                t.start()
+                t.join()
+
+            stats = rtsys.get_slab_stats()
+            assert stats[-1].alloc >= 20, stats
+            assert stats[-1].alloc == stats[-1].free, stats
+            assert stats[-1].chunks == 1, stats
+            print("OK")
+        """
+        env = os.environ.copy()
+        env['NUMBA_NRT_SLAB_ALLOCATOR'] = '4096'
+        out, _ = run_in_subprocess(code, env=env)
+        self.assertIn("OK", out.decode())
+
+    @needs_nrt_stats
+    def test_reconfigure_with_live_blocks(self):
+        # Toggle the slab allocator relative to the current configuration
+        max_size = 0 if rtsys.get_slab_stats() else 1024
+        arr = njit(lambda: np.zeros(10))()
+        with self.assertRaises(RuntimeError) as raises:
+            rtsys.set_slab_allocator(max_size)
+        self.assertIn("NRT blocks are allocated", str(raises.exception))
+        del arr
+
+
+class TestNrtArena(MemoryLeakMixin, TestCase):
+    """
+    Test allocating from a NRT arena.
+    """
+
+    def test_temporaries(self):
+        @njit
+        def work(n):
+            acc = 0.
+            for i in range(n):
+                acc += np.arange(i % 10).sum()
+            return acc
+
+        n = 1000
+        expect = work.py_func(n)
+        work(1)
+        with nrt.nrt_arena() as arena:
+            self.assertEqual(work(n), expect)
+        self.assertGreaterEqual(arena.stats.alloc, n)
+        # The dead temporaries are recycled in place
+        self.assertLess(arena.stats.chunks, 4)
+
+    def test_escaping_arrays(self):
+        @njit
+        def make(n):
+            return np.arange(n) * 2
+
+        make(1)
+        chunks = nrt.nrt_arena.live_chunks()
+        with nrt.nrt_arena(chunk_size=4096) as arena:
+            small = make(10)
+            large = make(10000)
+            # Returned arrays are copied out of the arena
+            self.assertEqual(small.base.external_allocator, 0)
+            self.assertEqual(large.base.external_allocator, 0)
+        self.assertGreaterEqual(arena.stats.alloc, 2)
+        # ... so they do not keep its chunks alive
+        self.assertEqual(nrt.nrt_arena.live_chunks(), chunks)
+        np.testing.assert_equal(small, np.arange(10) * 2)
+        np.testing.assert_equal(large, np.arange(10000) * 2)
+        del small, large
+
+    def test_escaping_views(self):
+        @njit
+        def make(n):
+            arr = np.arange(n)
+            return arr, arr[2:]
+
+        make(1)
+        chunks = nrt.nrt_arena.live_chunks()
+        with nrt.nrt_arena():
+            arr, view = make(10)
+        # The views are not copied apart, so they pin their chunk...
+        self.assertGreater(nrt.nrt_arena.live_chunks(), chunks)
+        view[0] = 42
+        self.assertEqual(arr[2], 42)
+        # ... until they are released
+        del arr, view
+        self.assertEqual(nrt.nrt_arena.live_chunks(), chunks)
+
+    def test_escaping_containers(self):
+        @njit
+        def make(n):
+            lst = List()
+            lst.append(np.arange(n))
+            return lst
+
+        make(1)
+        chunks = nrt.nrt_arena.live_chunks()
+        with nrt.nrt_arena():
+            lst = make(10)
+        # An array kept in a typed container pins its chunk...
+        self.assertGreater(nrt.nrt_arena.live_chunks(), chunks)
+        np.testing.assert_equal(lst[0], np.arange(10))
+        # ... until it is released
+        del lst
+        self.assertEqual(nrt.nrt_arena.live_chunks(), chunks)
+
+    def test_escaping_container_items(self):
+        @njit
+        def make(n):
+            lst = List()
+            lst.append(np.zeros(n))
+            return lst
+
+        @njit
+        def bump(lst, i):
+            lst[i][0] += 1
+
+        make(1)
+        chunks = nrt.nrt_arena.live_chunks()
+        with nrt.nrt_arena():
+            lst = make(10)
+            arr = lst[0]
+        # The boxed item is still the array in the list
+        arr[1] = 5
+        bump(lst, 0)
+        self.assertEqual(arr[0], 1)
+        self.assertEqual(lst[0][1], 5)
+        # Boxing it again sees the writes made in place
+        bump(lst, 0)
+        self.assertEqual(lst[0][0], 2)
+        # Unboxing it back into the list keeps sharing the data
+        lst.append(arr)
+        bump(lst, 1)
+        arr[2] = 7
+        self.assertEqual(arr[0], 3)
+        np.testing.assert_equal(lst[0], arr)
+        np.testing.assert_equal(lst[1], arr)
+        del lst, arr
+        self.assertEqual(nrt.nrt_arena.live_chunks(), chunks)
+
+    def test_nesting(self):
+        outer = nrt.nrt_arena()
+        inner = nrt.nrt_arena()
+        with outer:
+            with inner:
+                np.testing.assert_equal(njit(lambda: np.ones(3))(), 1)
+        self.assertGreater(inner.stats.alloc, 0)
+        self.assertEqual(outer.stats.alloc, 0)
+
+        outer.__enter__()
+        inner.__enter__()
+        with self.assertRaises(RuntimeError) as raises:
+            outer.__exit__(None, None, None)
+        self.assertIn("reverse order", str(raises.exception))
+        inner.__exit__(None, None, None)
+        outer.__exit__(None, None, None)
+
+
+@linux_only
+class TestNrtLargeAlloc(MemoryLeakMixin, TestCase):
+    """
+    Test the direct mapping of large NRT allocations.
+    """
+
+    def setUp(self):
+        super(TestNrtLargeAlloc, self).setUp()
+        self.addCleanup(rtsys.set_large_alloc_policy, 0)
+
+    def check_policy(self, **kwargs):
+        @njit
+        def make(n):
+            arr = np.empty(n)
+            for i in range(n):
+                arr[i] = i
+            return arr
+
+        rtsys.set_large_alloc_policy(1 << 20, **kwargs)
+        n = 1 << 19
+        large = make(n)
+        self.assertNotEqual(large.base.external_allocator, 0)
+        # The data starts the mapping, the MemInfo lives elsewhere
+        if kwargs.get('hugepages', True):
+            self.assertEqual(large.base.data % (2 << 20), 0)
+        else:
+            self.assertEqual(large.base.data % mmap.PAGESIZE, 0)
+        np.testing.assert_equal(large, np.arange(n))
+        self.assertEqual(make(10).base.external_allocator, 0)
+        del large
+
+        rtsys.set_large_alloc_policy(0)
+        self.assertEqual(make(n).base.external_allocator, 0)
+
+    def test_default(self):
+        self.check_policy()
+
+    def test_no_hugepages(self):
+        self.check_policy(hugepages=False)
+
+    def test_interleave(self):
+        self.check_policy(interleave=True)
+
+    def test_invalid(self):
+        with self.assertRaises(ValueError):
+            rtsys.set_large_alloc_policy(-1)
+
+    @unittest.skipIf(config.DEBUG_NRT, "debug markers touch the data")
+    def test_first_touch(self):
+        # Creating an array does not touch its pages, so that they are placed
+        # on the NUMA node of the thread that first writes them
+        @njit
+        def make(n):
+            return np.empty(n)
+
+        libc = ctypes.CDLL(None)
+        libc.mincore.argtypes = [ctypes.c_void_p, ctypes.c_size_t,
+                                 ctypes.c_char_p]
+        vec = ctypes.create_string_buffer(1)
+
+        def resident(arr):
+            self.assertEqual(libc.mincore(arr.ctypes.data, 1, vec), 0)
+            return ord(vec.raw) & 1
+
+        rtsys.set_large_alloc_policy(1 << 20)
+        arr = make(1 << 19)
+        self.assertNotEqual(arr.base.external_allocator, 0)
+        self.assertFalse(resident(arr))
+        arr[0] = 1
+        self.assertTrue(resident(arr))
+        del arr
+
+
+class TestNrtProfiler(MemoryLeakMixin, TestCase):
+    """
+    Test the NRT allocation profiler.
+    """
+
+    def setUp(self):
+        super(TestNrtProfiler, self).setUp()
+        self.addCleanup(rtsys.profile_stop)
+
+    def test_sample_all(self):
+        @njit
+        def make(n):
+            return np.ones(n)
+
+        make(1)
+        rtsys.profile_start(sample_interval=0)
+        arrays = [make(100) for _ in range(5)]
+        snapshot = rtsys.profile_snapshot()
+        self.assertEqual(len(snapshot), 5)
+        for alloc in snapshot:
+            self.assertEqual(alloc.size, 100 * 8)
+            self.assertGreaterEqual(alloc.age, 0)
+
+        del arrays
+        self.assertEqual(rtsys.profile_snapshot(), [])
+        [site] = rtsys.profile_top()
+        self.assertEqual(site.alloc, 5)
+        self.assertEqual(site.alloc_bytes, 5 * 100 * 8)
+        self.assertEqual(site.live, 0)
+        self.assertEqual(site.live_bytes, 0)
+        self.assertGreaterEqual(site.mean_lifetime, 0)
+
+        # Stopping keeps the profile around
+        rtsys.profile_stop()
+        make(100)
+        self.assertEqual(rtsys.profile_top()[0].alloc, 5)
+
+    def test_sample_interval(self):
+        @njit
+        def work(n, size):
+            acc = 0.
+            for i in range(n):
+                acc += np.ones(size)[0]
+            return acc
+
+        work(1, 1)
+        rtsys.profile_start(sample_interval=1 << 20)
+        # 8 MB worth of allocations
+        work(1000, 1000)
+        [site] = rtsys.profile_top()
+        self.assertGreater(site.alloc, 0)
+        self.assertLess(site.alloc, 100)
+        self.assertEqual(site.live, 0)
+
+    def test_sites(self):
+        code = """if 1:
+            import numpy as np
+            from numba import njit
+            from numba.core.runtime import rtsys
+
+            @njit
+            def inner(n):
+                return np.zeros(n)
+
+            @njit
+            def outer(n):
+                a = inner(n)
+                return a, np.ones(2 * n)
+
+            @njit
+            def fail(n):
+                if np.zeros(n).sum() == 0:
+                    raise ValueError("fail")
+                return n
+
+            outer(1)
+            try:
+                fail(1)
+            except ValueError:
+                pass
+            rtsys.profile_start(0)
+            res = outer(10)
+            # The site is restored on return...
+            mi = rtsys.meminfo_alloc(24)
+            sizes = {}
+            for alloc in rtsys.profile_snapshot():
+                sizes[alloc.site.split()[0]] = alloc.size
+            assert sizes == {'inner': 80, 'outer': 160, '<unknown>': 24}, sizes
+            del mi
+            # ... and on error
+            try:
+                fail(3)
+            except ValueError:
+                pass
+            mi = rtsys.meminfo_alloc(32)
+            sites = [alloc.site for alloc in rtsys.profile_snapshot()
+                     if alloc.size == 32]
+            assert sites == ['<unknown>'], sites
+            print("OK")
+        """
+        env = os.environ.copy()
+        env['NUMBA_NRT_PROFILE'] = '1'
+        out, _ = run_in_subprocess(code, env=env)
+        self.assertIn("OK", out.decode())
+
+
 class TestNRTIssue(MemoryLeakMixin, TestCase):
     def test_issue_with_refct_op_pruning(self):
         """
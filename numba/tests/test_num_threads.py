@@ -264,6 +264,36 @@ class TestNumThreads(TestCase):
             self.check_mask(mask, out)
             self.check_mask(mask, len(np.unique(x)))
 
+    @skip_parfors_unsupported
+    @unittest.skipIf(config.NUMBA_NUM_THREADS < 2, "Not enough CPU cores")
+    def _test_get_num_threads_back_to_back(self):
+        # Back-to-back regions alternating between thread counts, some of
+        # which change the thread count inside the loop body, must each see
+        # the count they were launched with (backends may reuse their
+        # per-count thread pools between regions)
+        @njit(parallel=True)
+        def test_func(n, clobber):
+            buf = np.empty((n,), dtype=np.int64)
+            for i in prange(n):
+                buf[i] = get_num_threads()
+                if clobber:
+                    set_num_threads(1)
+            return buf
+
+        n = 100000
+        masks = (2, config.NUMBA_NUM_THREADS, 2, config.NUMBA_NUM_THREADS)
+        for _ in range(3):
+            for clobber in (True, False):
+                for mask in masks:
+                    set_num_threads(mask)
+                    buf = test_func(n, clobber)
+                    # With clobbering a thread may see 1 once it has run an
+                    # iteration of its chunk, the first one must be right
+                    if clobber:
+                        self.check_mask(mask, buf[0])
+                    else:
+                        np.testing.assert_equal(buf, mask)
+
     # this test can only run on OpenMP (providing OMP_MAX_ACTIVE_LEVELS is not
     # set or >= 2) and TBB backends
     @skip_parfors_unsupported
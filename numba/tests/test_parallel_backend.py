@@ -3,6 +3,7 @@
 """
 Tests the parallel backend
 """
+import ctypes
 import faulthandler
 import itertools
 import multiprocessing
@@ -16,14 +17,16 @@ import unittest
 
 import numpy as np
 
-from numba import jit, vectorize, guvectorize, set_num_threads
+from numba import (jit, vectorize, guvectorize, set_num_threads, prange,
+                   submit_parallel)
+from numba.np.ufunc import parallel
 from numba.tests.support import (temp_directory, override_config, TestCase, tag,
                                  skip_parfors_unsupported, linux_only,
                                  needs_external_compilers)
 
 import queue as t_queue
 from numba.testing.main import _TIMEOUT as _RUNNER_TIMEOUT
-from numba.core import config
+from numba.core import config, errors
 
 
 _TEST_TIMEOUT = _RUNNER_TIMEOUT - 60.
@@ -625,6 +628,130 @@ class TestMiscBackendIssues(ThreadLayerTestHelper):
         env['OMP_STACKSIZE'] = "100K"
         self.run_cmd(cmdline, env=env)
 
+    @skip_no_omp
+    def test_omp_dynamic_chunks(self):
+        """
+        Tests that OMP calls the kernel once per chunk of a dynamic or guided
+        schedule, on the whole chunk
+        """
+        runme = """if 1:
+            import ctypes
+            from numba import (set_parallel_schedule, set_parallel_chunksize,
+                               threading_layer)
+            from numba.np.ufunc import parallel, omppool
+            import numpy as np
+
+            parallel._launch_threads()
+            assert threading_layer() == "omp", "omp not found"
+
+            kernel_t = ctypes.CFUNCTYPE(None, ctypes.POINTER(ctypes.c_void_p),
+                                        ctypes.POINTER(ctypes.c_size_t),
+                                        ctypes.POINTER(ctypes.c_size_t),
+                                        ctypes.c_void_p)
+            counts = []
+
+            def kernel(args, dims, steps, data):
+                counts.append(dims[0])
+                ptr = ctypes.cast(args[0], ctypes.POINTER(ctypes.c_int64))
+                np.ctypeslib.as_array(ptr, (dims[0],))[:] += 1
+
+            c_kernel = kernel_t(kernel)
+            parallel_for = ctypes.CFUNCTYPE(
+                None, ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p),
+                ctypes.POINTER(ctypes.c_size_t),
+                ctypes.POINTER(ctypes.c_size_t), ctypes.c_void_p,
+                ctypes.c_size_t, ctypes.c_size_t,
+                ctypes.c_int)(omppool.parallel_for)
+
+            for kind in ('dynamic', 'guided'):
+                set_parallel_schedule(kind)
+                set_parallel_chunksize(7)
+                del counts[:]
+                out = np.zeros(1000, dtype=np.int64)
+                args = (ctypes.c_void_p * 1)(out.ctypes.data)
+                dims = (ctypes.c_size_t * 1)(out.size)
+                steps = (ctypes.c_size_t * 1)(out.itemsize)
+                parallel_for(ctypes.cast(c_kernel, ctypes.c_void_p), args,
+                             dims, steps, None, 0, 1, 4)
+                np.testing.assert_equal(out, 1)
+                # one call per chunk of 7 iterations, the last one shorter
+                assert sorted(counts) == [6] + [7] * 142, (kind, counts)
+        """
+        cmdline = [sys.executable, '-c', runme]
+        env = os.environ.copy()
+        env['NUMBA_THREADING_LAYER'] = "omp"
+        env['NUMBA_NUM_THREADS'] = "4"
+        self.run_cmd(cmdline, env=env)
+
+    def test_default_chunks(self):
+        """
+        Tests that without a chunk size the threading layers call the kernel
+        on chunks of 16 per thread of a dynamic or guided schedule, rather
+        than once per iteration
+        """
+        runme = """if 1:
+            import ctypes
+            import importlib
+            from numba import (set_parallel_schedule, set_parallel_chunksize,
+                               threading_layer)
+            from numba.np.ufunc import parallel
+            import numpy as np
+
+            parallel._launch_threads()
+            pool = {'workqueue': 'workqueue', 'omp': 'omppool',
+                    'tbb': 'tbbpool'}[threading_layer()]
+            pool = importlib.import_module('numba.np.ufunc.' + pool)
+
+            kernel_t = ctypes.CFUNCTYPE(None, ctypes.POINTER(ctypes.c_void_p),
+                                        ctypes.POINTER(ctypes.c_size_t),
+                                        ctypes.POINTER(ctypes.c_size_t),
+                                        ctypes.c_void_p)
+            counts = []
+
+            def kernel(args, dims, steps, data):
+                counts.append(dims[0])
+                ptr = ctypes.cast(args[0], ctypes.POINTER(ctypes.c_int64))
+                np.ctypeslib.as_array(ptr, (dims[0],))[:] += 1
+
+            c_kernel = kernel_t(kernel)
+            parallel_for = ctypes.CFUNCTYPE(
+                None, ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p),
+                ctypes.POINTER(ctypes.c_size_t),
+                ctypes.POINTER(ctypes.c_size_t), ctypes.c_void_p,
+                ctypes.c_size_t, ctypes.c_size_t,
+                ctypes.c_int)(pool.parallel_for)
+
+            set_parallel_chunksize(0)
+            for kind in ('dynamic', 'guided'):
+                set_parallel_schedule(kind)
+                del counts[:]
+                out = np.zeros(1000, dtype=np.int64)
+                args = (ctypes.c_void_p * 1)(out.ctypes.data)
+                dims = (ctypes.c_size_t * 1)(out.size)
+                steps = (ctypes.c_size_t * 1)(out.itemsize)
+                parallel_for(ctypes.cast(c_kernel, ctypes.c_void_p), args,
+                             dims, steps, None, 0, 1, 4)
+                np.testing.assert_equal(out, 1)
+                # 4 threads make chunks of ceil(1000 / 64) = 16 iterations,
+                # dynamic ones are split evenly and guided ones only shrink
+                # to that size, the last one aside
+                assert len(counts) <= 64, (kind, counts)
+                if kind == 'dynamic':
+                    assert max(counts) <= 16, (kind, counts)
+                else:
+                    assert sorted(counts)[1] >= 16, (kind, counts)
+        """
+        cmdline = [sys.executable, '-c', runme]
+        for backend in ('workqueue', 'omp', 'tbb'):
+            if backend == 'omp' and not _HAVE_OMP_POOL:
+                continue
+            if backend == 'tbb' and not _HAVE_TBB_POOL:
+                continue
+            env = os.environ.copy()
+            env['NUMBA_THREADING_LAYER'] = backend
+            env['NUMBA_NUM_THREADS'] = "4"
+            self.run_cmd(cmdline, env=env)
+
     @skip_no_tbb
     def test_single_thread_tbb(self):
         """
@@ -650,12 +777,14 @@ class TestMiscBackendIssues(ThreadLayerTestHelper):
         env['NUMBA_NUM_THREADS'] = "1"
         self.run_cmd(cmdline, env=env)
 
-    def test_workqueue_aborts_on_nested_parallelism(self):
+    def test_workqueue_nested_parallelism(self):
         """
-        Tests workqueue raises sigabrt if a nested parallel call is performed
+        Tests workqueue runs a nested parallel call serially instead of
+        aborting, and counts it
         """
         runme = """if 1:
-            from numba import njit, prange
+            from numba import njit, prange, threading_layer
+            from numba.np.ufunc.parallel import _get_nested_launches
             import numpy as np
 
             @njit(parallel=True)
@@ -671,24 +800,185 @@ class TestMiscBackendIssues(ThreadLayerTestHelper):
                     nested(Z[i])
                 return Z
 
-            main()
+            np.testing.assert_equal(main(), np.ones((5, 10)))
+            assert threading_layer() == "workqueue"
+            # one nested launch per row
+            assert _get_nested_launches() == 5, _get_nested_launches()
+
+            # a non-nested region still runs in parallel
+            nested(np.zeros(10))
+            assert _get_nested_launches() == 5, _get_nested_launches()
         """
         cmdline = [sys.executable, '-c', runme]
         env = os.environ.copy()
         env['NUMBA_THREADING_LAYER'] = "workqueue"
         env['NUMBA_NUM_THREADS'] = "4"
+        self.run_cmd(cmdline, env=env)
 
-        try:
-            out, err = self.run_cmd(cmdline, env=env)
-        except AssertionError as e:
-            if self._DEBUG:
-                print(out, err)
-            e_msg = str(e)
-            self.assertIn("failed with code", e_msg)
-            # raised a SIGABRT, but the value is platform specific so just check
-            # the error message
-            self.assertIn("Terminating: Nested parallel kernel launch detected",
-                          e_msg)
+    def test_workqueue_skewed_work(self):
+        """
+        Tests workqueue gets the right answer when the chunks of a parallel
+        region have very different costs and get stolen between workers
+        """
+        runme = """if 1:
+            from numba import (njit, prange, guvectorize, threading_layer,
+                               parallel_chunksize)
+            import numpy as np
+
+            @njit(parallel=True)
+            def skewed(n):
+                out = np.zeros(n)
+                total = 0
+                for i in prange(n):
+                    # the first iterations do almost all the work
+                    acc = 0.
+                    for j in range(max(n // 4 - i, 1) * 100):
+                        acc += j
+                    out[i] = acc
+                    total += 1
+                return out, total
+
+            @guvectorize(['void(int64[:], int64[:])'], '(n)->(n)',
+                         target='parallel')
+            def skewed_gufunc(x, out):
+                acc = 0
+                for j in range(max(100 - x[0], 1) * 1000):
+                    acc += j
+                out[:] = x + acc
+
+            for n in (1, 7, 1000):
+                expected = skewed.py_func(n)
+                for chunksize in (0, 1, 13):
+                    with parallel_chunksize(chunksize):
+                        got = skewed(n)
+                    np.testing.assert_allclose(got[0], expected[0])
+                    assert got[1] == expected[1]
+
+            x = np.arange(200 * 3).reshape((200, 3))
+            expected = np.array([r + sum(range(max(100 - r[0], 1) * 1000))
+                                 for r in x])
+            np.testing.assert_equal(skewed_gufunc(x), expected)
+            assert threading_layer() == "workqueue"
+        """
+        cmdline = [sys.executable, '-c', runme]
+        env = os.environ.copy()
+        env['NUMBA_THREADING_LAYER'] = "workqueue"
+        env['NUMBA_NUM_THREADS'] = "4"
+        self.run_cmd(cmdline, env=env)
+
+    def test_workqueue_short_regions(self):
+        """
+        Tests workqueue over many back to back short parallel regions with
+        varying thread counts, with the workers both spinning and parked
+        """
+        runme = """if 1:
+            import time
+            from numba import (njit, prange, threading_layer, set_num_threads,
+                               get_num_threads)
+            import numpy as np
+
+            @njit(parallel=True)
+            def short(n):
+                out = np.zeros(n, dtype=np.int64)
+                for i in prange(n):
+                    out[i] = get_num_threads()
+                return out
+
+            for i in range(2000):
+                nthreads = i % 4 + 1
+                set_num_threads(nthreads)
+                n = i % 9
+                np.testing.assert_equal(short(n), np.full(n, nthreads))
+                if i % 500 == 0:
+                    # let the workers park
+                    time.sleep(0.1)
+            assert threading_layer() == "workqueue"
+        """
+        cmdline = [sys.executable, '-c', runme]
+        env = os.environ.copy()
+        env['NUMBA_THREADING_LAYER'] = "workqueue"
+        env['NUMBA_NUM_THREADS'] = "4"
+        self.run_cmd(cmdline, env=env)
+
+    @unittest.skipUnless(sys.platform.startswith('linux'), "Linux only")
+    def test_thread_affinity(self):
+        """
+        Tests NUMBA_THREAD_AFFINITY pins the workers of each threading layer
+        """
+        runme = """if 1:
+            import glob
+            from numba import njit, prange
+            import numpy as np
+
+            @njit(parallel=True)
+            def foo(n):
+                acc = 0.
+                for i in prange(n):
+                    acc += np.sqrt(np.float64(i))
+                return acc
+
+            # enough work for the TBB workers to join the regions
+            for _ in range(20):
+                np.testing.assert_allclose(foo(1000000),
+                                           foo.py_func(1000000))
+
+            # count the threads of this process only allowed on CPU 0
+            pinned = 0
+            for status in glob.glob('/proc/self/task/*/status'):
+                with open(status) as f:
+                    for line in f:
+                        if line.startswith('Cpus_allowed_list:'):
+                            pinned += line.split()[1] == '0'
+            print(pinned)
+        """
+        cmdline = [sys.executable, '-c', runme]
+        for backend in ('workqueue', 'omp', 'tbb'):
+            if backend == 'omp' and not _HAVE_OMP_POOL:
+                continue
+            if backend == 'tbb' and not _HAVE_TBB_POOL:
+                continue
+            env = os.environ.copy()
+            env['NUMBA_THREADING_LAYER'] = backend
+            env['NUMBA_NUM_THREADS'] = "4"
+            env['NUMBA_THREAD_AFFINITY'] = "0"
+            out, _ = self.run_cmd(cmdline, env=env)
+            # the workqueue pins all its workers, omp all but the launching
+            # thread, tbb only the workers that joined a region
+            expected = {'workqueue': 4, 'omp': 3, 'tbb': 1}[backend]
+            self.assertGreaterEqual(int(out), expected, backend)
+
+    def test_thread_affinity_invalid(self):
+        """
+        Tests an invalid NUMBA_THREAD_AFFINITY is reported on first use
+        """
+        runme = """if 1:
+            from numba import njit, prange
+
+            @njit(parallel=True)
+            def foo(n):
+                acc = 0
+                for i in prange(n):
+                    acc += i
+                return acc
+
+            foo(10)
+        """
+        cmdline = [sys.executable, '-c', runme]
+        env = os.environ.copy()
+        env['NUMBA_THREAD_AFFINITY'] = "0-x"
+        with self.assertRaises(AssertionError) as raises:
+            self.run_cmd(cmdline, env=env)
+        self.assertIn("Invalid CPU list in NUMBA_THREAD_AFFINITY",
+                      str(raises.exception))
+
+        # CPUs the process may not run on cannot be pinned to
+        if hasattr(os, 'sched_getaffinity'):
+            cpu = max(os.sched_getaffinity(0)) + 1
+            env['NUMBA_THREAD_AFFINITY'] = "0,%d" % cpu
+            with self.assertRaises(AssertionError) as raises:
+                self.run_cmd(cmdline, env=env)
+            self.assertIn("CPUs %d in NUMBA_THREAD_AFFINITY are not "
+                          "available" % cpu, str(raises.exception))
 
     @unittest.skipUnless(_HAVE_OS_FORK, "Test needs fork(2)")
     def test_workqueue_handles_fork_from_non_main_thread(self):
@@ -1241,5 +1531,199 @@ class TestOpenMPVendors(TestCase):
                 self.assertEqual(expected[k], omppool.openmp_vendor)
 
 
+@skip_parfors_unsupported
+class TestSubmitParallel(TestCase):
+    """
+    Checks the asynchronous launch of parallel work
+    """
+
+    def test_submit_parallel(self):
+        @jit(nopython=True, parallel=True)
+        def foo(a, n):
+            for i in prange(a.shape[0]):
+                acc = 0.
+                for j in range(n):
+                    acc += np.sqrt(i + j)
+                a[i] = acc
+            return a.sum()
+
+        arrays = [np.zeros(1000) for _ in range(4)]
+        futures = [submit_parallel(foo, a, 100) for a in arrays]
+        expected = foo.py_func(np.zeros(1000), 100)
+        for a, fut in zip(arrays, futures):
+            self.assertPreciseEqual(fut.result(), expected)
+            self.assertPreciseEqual(a.sum(), expected)
+        # the calls ran the GIL-releasing copy, compiled once
+        nogil_foo = parallel._nogil_dispatchers[foo]
+        self.assertTrue(nogil_foo.targetoptions['nogil'])
+        self.assertEqual(len(nogil_foo.signatures), 1)
+        self.assertEqual(len(foo.signatures), 0)
+
+        # a nogil function is run as is
+        bar = jit(nopython=True, nogil=True, parallel=True)(foo.py_func)
+        self.assertPreciseEqual(submit_parallel(bar, np.zeros(1000),
+                                                100).result(), expected)
+        self.assertNotIn(bar, parallel._nogil_dispatchers)
+
+        # errors are raised by the future
+        fut = submit_parallel(foo, np.zeros(10), "not an int")
+        with self.assertRaises(errors.TypingError):
+            fut.result()
+
+        with self.assertRaises(TypeError) as raises:
+            submit_parallel(foo.py_func, np.zeros(10), 1)
+        self.assertIn("requires a jitted function", str(raises.exception))
+
+    def test_parallel_for_async(self):
+        # Drives the C level parallel_for_async() of the threading layer
+        # with a ctypes kernel adding 1 to its chunk of an int64 array
+        parallel._launch_threads()
+        lib = {'tbb': 'tbbpool', 'omp': 'omppool',
+               'workqueue': 'workqueue'}[parallel.threading_layer()]
+        lib = getattr(__import__('numba.np.ufunc', fromlist=[lib]), lib)
+
+        kernel_t = ctypes.CFUNCTYPE(None, ctypes.POINTER(ctypes.c_void_p),
+                                    ctypes.POINTER(ctypes.c_size_t),
+                                    ctypes.POINTER(ctypes.c_size_t),
+                                    ctypes.c_void_p)
+
+        def kernel(args, dims, steps, data):
+            ptr = ctypes.cast(args[0], ctypes.POINTER(ctypes.c_int64))
+            chunk = np.ctypeslib.as_array(ptr, (dims[0],))
+            chunk += 1
+
+        c_kernel = kernel_t(kernel)
+        submit = ctypes.CFUNCTYPE(
+            ctypes.c_void_p, ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p),
+            ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_size_t),
+            ctypes.c_void_p, ctypes.c_size_t, ctypes.c_size_t,
+            ctypes.c_size_t, ctypes.c_int)(lib.parallel_for_async)
+        poll = ctypes.CFUNCTYPE(ctypes.c_int,
+                                ctypes.c_void_p)(lib.parallel_for_poll)
+        wait = ctypes.CFUNCTYPE(None, ctypes.c_void_p)(lib.parallel_for_wait)
+
+        out = np.zeros(1000, dtype=np.int64)
+        args = (ctypes.c_void_p * 1)(out.ctypes.data)
+        dims = (ctypes.c_size_t * 1)(out.size)
+        steps = (ctypes.c_size_t * 1)(out.itemsize)
+        handle = submit(ctypes.cast(c_kernel, ctypes.c_void_p), args, dims,
+                        steps, None, 0, 1, 1, 2)
+        self.assertTrue(handle)
+        self.assertIn(poll(handle), (0, 1))
+        wait(handle)
+        np.testing.assert_equal(out, 1)
+
+        # a (n)->(n) kernel also reads the core dimension and its strides,
+        # which follow the outer steps
+        def core_kernel(args, dims, steps, data):
+            for i in range(dims[0]):
+                for j in range(dims[1]):
+                    src = args[0] + i * steps[0] + j * steps[2]
+                    dst = args[1] + i * steps[1] + j * steps[3]
+                    value = ctypes.c_double.from_address(src).value
+                    ctypes.c_double.from_address(dst).value = value + 1
+
+        c_core_kernel = kernel_t(core_kernel)
+        x = np.arange(150.).reshape((3, 50)).T
+        out = np.zeros((50, 3))
+        args = (ctypes.c_void_p * 2)(x.ctypes.data, out.ctypes.data)
+        dims = (ctypes.c_size_t * 2)(*out.shape)
+        steps = (ctypes.c_size_t * 4)(x.strides[0], out.strides[0],
+                                      x.strides[1], out.strides[1])
+        handle = submit(ctypes.cast(c_core_kernel, ctypes.c_void_p), args,
+                        dims, steps, None, 1, 2, 4, 2)
+        self.assertTrue(handle)
+        # the launch has its own copy of the steps
+        ctypes.memset(steps, 0, ctypes.sizeof(steps))
+        wait(handle)
+        np.testing.assert_equal(out, x + 1)
+
+
+@skip_parfors_unsupported
+class TestParallelProfile(TestCase):
+    """
+    Checks the instrumentation of the parallel regions
+    """
+
+    def test_parallel_profile(self):
+        def work(a):
+            for i in prange(a.shape[0]):
+                acc = 0.
+                for j in range(i):
+                    acc += np.sqrt(j)
+                a[i] = acc
+
+        a = np.zeros(2000)
+        foo = jit(nopython=True, parallel=True)(work)
+        foo(a)
+        parallel.get_parallel_profile()
+        # nothing is recorded when the instrumentation is off, and the
+        # kernels compiled meanwhile are not named
+        self.assertFalse(parallel.set_parallel_profiling(False))
+        foo(a)
+        self.assertEqual(parallel.get_parallel_profile(), [])
+        self.assertFalse(parallel.set_parallel_profiling(True))
+        try:
+            foo(a)
+        finally:
+            self.assertTrue(parallel.set_parallel_profiling(False))
+        [record] = parallel.get_parallel_profile()
+        self.assertIsNone(record.name)
+
+        # the kernels compiled while it is on are named after the parfor
+        self.assertFalse(parallel.set_parallel_profiling(True))
+        try:
+            foo = jit(nopython=True, parallel=True)(work)
+            foo(a)
+            foo(a)
+        finally:
+            self.assertTrue(parallel.set_parallel_profiling(False))
+        records = parallel.get_parallel_profile(clear=False)
+        self.assertEqual(len(records), 2)
+        self.assertEqual(parallel.get_parallel_profile(), records)
+        self.assertEqual(parallel.get_parallel_profile(), [])
+
+        self.assertEqual(records[0].func, records[1].func)
+        for record in records:
+            self.assertIsInstance(record.name, str)
+            self.assertTrue(record.name.startswith('__numba_parfor_gufunc_'),
+                            record.name)
+            self.assertEqual(record.num_threads, config.NUMBA_NUM_THREADS)
+            self.assertEqual(len(record.workers), record.num_threads)
+            self.assertGreater(sum(w.chunks for w in record.workers), 0)
+            self.assertGreaterEqual(record.imbalance, 1.)
+            for w in record.workers:
+                self.assertGreaterEqual(w.wait, 0)
+                if w.chunks:
+                    self.assertGreaterEqual(w.first_start, record.start)
+                    self.assertLessEqual(w.last_end,
+                                         record.start + record.duration
+                                         + 1e-6)
+                    # allow for the rounding of the times to seconds
+                    self.assertLessEqual(w.busy,
+                                         w.last_end - w.first_start + 1e-6)
+
+        trace = parallel.parallel_profile_to_chrome_trace(records)
+        events = [e for e in trace['traceEvents'] if e['ph'] == 'X']
+        self.assertEqual(len([e for e in events if e['tid'] == 0]), 2)
+        self.assertEqual(len(events) - 2,
+                         sum(1 for r in records for w in r.workers
+                             if w.chunks))
+
+        # and those of a parallel gufunc after the Python function
+        self.assertFalse(parallel.set_parallel_profiling(True))
+        try:
+            @guvectorize(['void(float64[:], float64[:])'], '(n)->(n)',
+                         target='parallel')
+            def add_one(x, out):
+                out[:] = x + 1
+
+            add_one(np.zeros((1000, 3)))
+        finally:
+            self.assertTrue(parallel.set_parallel_profiling(False))
+        [record] = parallel.get_parallel_profile()
+        self.assertEqual(record.name.rsplit('.', 1)[-1], 'add_one')
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -24,8 +24,9 @@ from itertools import cycle, chain
 import subprocess as subp
 
 import numba.parfors.parfor
-from numba import (njit, prange, parallel_chunksize,
+from numba import (njit, prange, guvectorize, parallel_chunksize,
                    get_parallel_chunksize, set_parallel_chunksize,
+                   get_parallel_schedule, set_parallel_schedule,
                    set_num_threads, get_num_threads, typeof)
 from numba.core import (types, utils, typing, errors, ir, rewrites,
                         typed_passes, inline_closurecall, config, compiler, cpu)
@@ -4347,6 +4348,157 @@ class TestParforChunksizing(TestCase):
         self.assertIn(msg, str(raised.exception))
 
 
+@skip_parfors_unsupported
+class TestParforScheduleKind(TestCase):
+    """
+    Tests the dynamic, guided and tiled schedules in ParallelAccelerator.
+    """
+    _numba_parallel_test_ = False
+
+    def setUp(self):
+        set_parallel_schedule('static')
+        set_parallel_chunksize(0)
+
+    def tearDown(self):
+        set_parallel_schedule('static')
+        set_parallel_chunksize(0)
+
+    def test_python_parallel_schedule_basic(self):
+        self.assertEqual(get_parallel_schedule(), 'static')
+        self.assertEqual(set_parallel_schedule('guided'), 'static')
+        self.assertEqual(get_parallel_schedule(), 'guided')
+        self.assertEqual(set_parallel_schedule('dynamic'), 'guided')
+        self.assertEqual(get_parallel_schedule(), 'dynamic')
+        with self.assertRaises(ValueError) as raised:
+            set_parallel_schedule('auto')
+        self.assertIn("must be one of", str(raised.exception))
+        self.assertEqual(get_parallel_schedule(), 'dynamic')
+
+    def test_njit_parallel_schedule_basic(self):
+        @njit
+        def set_get(kind):
+            old = set_parallel_schedule(kind)
+            return old, get_parallel_schedule()
+
+        self.assertEqual(set_get('guided'), ('static', 'guided'))
+        self.assertEqual(get_parallel_schedule(), 'guided')
+        self.assertEqual(set_get('static'), ('guided', 'static'))
+        with self.assertRaises(ValueError) as raised:
+            set_get('auto')
+        self.assertIn("must be one of", str(raised.exception))
+
+    def test_all_iterations(self):
+        """ Test that all the iterations of 1D and 2D parfors with
+            reductions get run once with each schedule. """
+
+        @njit(parallel=True)
+        def test_impl(n):
+            res = np.zeros(n)
+            acc = 0
+            for i in numba.prange(n):
+                res[i] += i
+                acc += i
+            return res, acc
+
+        @njit(parallel=True)
+        def test_impl_2d(a):
+            acc = 0.
+            for i in numba.prange(a.shape[0]):
+                for j in numba.prange(a.shape[1]):
+                    a[i, j] += 1
+                    acc += a[i, j]
+            return acc
+
+        for kind in ('static', 'dynamic', 'guided', 'tiled'):
+            set_parallel_schedule(kind)
+            for cs in (0, 1, 7):
+                set_parallel_chunksize(cs)
+                for n in (0, 1, 3, 997):
+                    res, acc = test_impl(n)
+                    self.assertPreciseEqual(res, np.arange(n, dtype=np.float64))
+                    self.assertEqual(acc, n * (n - 1) // 2)
+                for shape in ((1, 1), (3, 500), (500, 3)):
+                    a = np.zeros(shape)
+                    self.assertEqual(test_impl_2d(a), a.size)
+                    np.testing.assert_equal(a, np.ones(shape))
+
+    def test_gufunc(self):
+        @guvectorize(['void(float64[:], float64[:])'], '(n)->(n)',
+                     target='parallel')
+        def add_one(x, out):
+            out[:] = x + 1
+
+        x = np.arange(3000.).reshape((1000, 3))
+        for kind in ('static', 'dynamic', 'guided', 'tiled'):
+            set_parallel_schedule(kind)
+            for cs in (0, 1, 7):
+                set_parallel_chunksize(cs)
+                np.testing.assert_equal(add_one(x), x + 1)
+
+    def test_tiled_3d_and_stencil(self):
+        """ Test that tiled schedules of 3D prange nests and of stencils
+            with neighbourhoods crossing the tiles give the right answer. """
+
+        @njit(parallel=True)
+        def test_impl(a):
+            out = np.empty_like(a)
+            for i in numba.prange(a.shape[0]):
+                for j in numba.prange(a.shape[1]):
+                    for k in numba.prange(a.shape[2]):
+                        out[i, j, k] = a[i, j, k] * 2 + i - j + k
+            return out
+
+        @numba.stencil
+        def kernel(a):
+            return a[-1, 0] + a[1, 0] + a[0, -1] + a[0, 1] - 4 * a[0, 0]
+
+        @njit(parallel=True)
+        def test_stencil(a):
+            return kernel(a)
+
+        set_parallel_schedule('tiled')
+        for cs in (0, 1, 50):
+            set_parallel_chunksize(cs)
+            for shape in ((1, 1, 1), (3, 40, 70), (65, 2, 33)):
+                a = np.arange(np.prod(shape), dtype=np.float32).reshape(shape)
+                np.testing.assert_equal(test_impl(a), test_impl.py_func(a))
+            a = np.random.ranf((300, 257))
+            np.testing.assert_allclose(test_stencil(a), kernel(a))
+
+    @unittest.skipIf(config.NUMBA_NUM_THREADS < 4, "needs 4 threads")
+    def test_guided_per_thread_iterations(self):
+        """ Test that the threads share the iterations of a guided parfor
+            of uniform cost evenly: its chunks already shrink, so the
+            threading layer must not hand them out in shrinking runs too,
+            which gives one thread more than half of the iterations. """
+
+        @njit(parallel=True)
+        def test_impl(n, work):
+            set_num_threads(4)
+            counts = np.zeros(get_num_threads(), dtype=np.int64)
+            res = np.zeros(n)
+            for i in numba.prange(n):
+                counts[numba.get_thread_id()] += 1
+                acc = 0.
+                for k in range(work):
+                    acc += np.sqrt(k + i)
+                res[i] = acc
+            return counts, res
+
+        n = 1000
+        set_parallel_schedule('guided')
+        try:
+            counts, res = test_impl(n, 20000)
+        finally:
+            set_num_threads(config.NUMBA_NUM_THREADS)
+        self.assertEqual(counts.sum(), n)
+        self.assertTrue(np.all(res > 0))
+        # TBB may leave a worker out of the region, which is then not
+        # expected to be balanced
+        if np.count_nonzero(counts) == counts.size:
+            self.assertLessEqual(counts.max(), n // 2, counts)
+
+
 @skip_parfors_unsupported
 @x86_only
 class TestParforsVectorizer(TestPrangeBase):
@@ -91,6 +91,36 @@ class TestTypeConv(CompatibilityTestMixin, unittest.TestCase):
         with self.assertRaises(TypeError):
             sel = tm.select_overload(sig, ovs, False, False)
 
+    def test_hash_table(self):
+        tm = TypeManager()
+        stats = tm.get_stats()
+        self.assertEqual(stats['size'], 0)
+        initial_capacity = stats['capacity']
+
+        tys = [types.Array(types.int32, ndim, layout)
+               for ndim in range(1, 21) for layout in 'CFA']
+        pairs = [(ta, tb) for ta, tb in itertools.product(tys, tys)
+                 if ta != tb]
+        for ta, tb in pairs:
+            tm.set_safe_convert(ta, tb)
+
+        # The table grew to accommodate all entries
+        stats = tm.get_stats()
+        self.assertEqual(stats['size'], len(pairs))
+        self.assertGreater(stats['capacity'], initial_capacity)
+        self.assertLessEqual(stats['load_factor'], 0.5)
+        self.assertGreaterEqual(stats['max_probe_length'],
+                                stats['mean_probe_length'])
+        for ta, tb in pairs:
+            self.assertEqual(tm.check_compatible(ta, tb), Conversion.safe)
+        self.assertIsNone(tm.check_compatible(tys[0], types.float64))
+
+        # Overwriting doesn't add entries
+        tm.set_unsafe_convert(tys[0], tys[1])
+        self.assertEqual(tm.check_compatible(tys[0], tys[1]),
+                         Conversion.unsafe)
+        self.assertEqual(tm.get_stats()['size'], len(pairs))
+
     def test_default_rules(self):
         tm = rules.default_type_manager
         self.check_number_compatibility(tm.check_compatible)
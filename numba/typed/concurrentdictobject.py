@@ -0,0 +1,758 @@
+"""
+Compiler-side implementation of the concurrent dictionary.
+
+A concurrent dictionary is a fixed number of shards, each a plain typed
+dictionary guarded by a spinlock.  Every operation hashes its key outside of
+any lock, then holds the lock of the shard of the hash only for the lookup or
+insertion in the dictionary of the shard.  The dictionary of a shard is used
+through a DictType without a meminfo, so that the operations of dictobject
+apply to it unchanged.
+"""
+import operator
+import platform
+
+from llvmlite import ir
+
+from numba.core.extending import (
+    overload,
+    overload_method,
+    intrinsic,
+    register_model,
+    models,
+)
+from numba.core.imputils import impl_ret_borrowed
+from numba.core import types, cgutils, config
+from numba.core.types import ConcurrentDictType, Type
+from numba.core.errors import TypingError
+from numba.typed import dictobject
+from numba.typed.dictobject import DKIX, Status, _raise_if_error
+from numba.typed.typedobjectutils import (_cast, _nonoptional,
+                                          _sentry_safe_cast_default,
+                                          _container_get_data)
+
+ll_cdict_type = cgutils.voidptr_t
+ll_shard_type = cgutils.voidptr_t
+ll_status = cgutils.int32_t
+ll_ssize_t = cgutils.intp_t
+ll_hash = ll_ssize_t
+ll_lock = cgutils.int32_t
+ll_version = cgutils.int32_t
+
+# Must match NB_DictShard in dictobject.h
+ll_shard_struct = ir.LiteralStructType([ll_lock, ll_version,
+                                        cgutils.voidptr_t])
+
+# Most pauses between two looks at a held lock, the wait doubles from one
+# pause up to this
+_LOCK_MAX_BACKOFF = 64
+
+
+_meminfo_cdictptr = types.MemInfoPointer(types.voidptr)
+
+
+def new_concurrent_dict(key, value, nshards=0, flags=0):
+    """Construct a new concurrent dict.
+
+    Parameters
+    ----------
+    key, value : TypeRef
+        Key type and value type of the new dict.
+    nshards : int
+        Number of shards, rounded up to a power of two.  Non-positive
+        values select the default of ``default_nshards()``.
+    flags : int
+        DictFlags of the dict of each shard.
+    """
+    # With JIT disabled, ignore all arguments and return a Python dict.
+    return dict()
+
+
+def default_nshards():
+    """The default number of shards of a concurrent dict: four per thread,
+    which keeps two threads working on the same shard unlikely.
+    """
+    return 4 * config.NUMBA_NUM_THREADS
+
+
+@register_model(ConcurrentDictType)
+class ConcurrentDictModel(models.StructModel):
+    def __init__(self, dmm, fe_type):
+        members = [
+            ('meminfo', _meminfo_cdictptr),
+            ('data', types.voidptr),   # ptr to the C concurrent dict
+        ]
+        super(ConcurrentDictModel, self).__init__(dmm, fe_type, members)
+
+
+@intrinsic
+def _as_meminfo(typingctx, cdobj):
+    """Returns the MemInfoPointer of a concurrent dictionary.
+    """
+    if not isinstance(cdobj, ConcurrentDictType):
+        raise TypingError('expected *cdobj* to be a ConcurrentDictType')
+
+    def codegen(context, builder, sig, args):
+        [tcd] = sig.args
+        [cd] = args
+        # Incref
+        context.nrt.incref(builder, tcd, cd)
+        ctor = cgutils.create_struct_proxy(tcd)
+        cdstruct = ctor(context, builder, value=cd)
+        # Returns the plain MemInfo
+        return cdstruct.meminfo
+
+    sig = _meminfo_cdictptr(cdobj)
+    return sig, codegen
+
+
+@intrinsic
+def _from_meminfo(typingctx, mi, cdicttyperef):
+    """Recreate a concurrent dictionary from a MemInfoPointer
+    """
+    if mi != _meminfo_cdictptr:
+        raise TypingError('expected a MemInfoPointer for concurrent dict.')
+    cdicttype = cdicttyperef.instance_type
+    if not isinstance(cdicttype, ConcurrentDictType):
+        raise TypingError('expected a {}'.format(ConcurrentDictType))
+
+    def codegen(context, builder, sig, args):
+        [mi, _] = args
+        ctor = cgutils.create_struct_proxy(cdicttype)
+        cdstruct = ctor(context, builder)
+
+        data_pointer = context.nrt.meminfo_data(builder, mi)
+        data_pointer = builder.bitcast(data_pointer,
+                                       ll_cdict_type.as_pointer())
+
+        cdstruct.data = builder.load(data_pointer)
+        cdstruct.meminfo = mi
+
+        return impl_ret_borrowed(
+            context,
+            builder,
+            cdicttype,
+            cdstruct._getvalue(),
+        )
+
+    sig = cdicttype(mi, cdicttyperef)
+    return sig, codegen
+
+
+def _imp_dtor(context, module):
+    """Define the dtor for concurrent dictionary
+    """
+    llvoidptr = context.get_value_type(types.voidptr)
+    llsize = context.get_value_type(types.uintp)
+    fnty = ir.FunctionType(
+        ir.VoidType(),
+        [llvoidptr, llsize, llvoidptr],
+    )
+    fname = '_numba_concurrent_dict_dtor'
+    fn = cgutils.get_or_insert_function(module, fnty, fname)
+
+    if fn.is_declaration:
+        # Set linkage
+        fn.linkage = 'linkonce_odr'
+        # Define
+        builder = ir.IRBuilder(fn.append_basic_block())
+        cdp = builder.bitcast(fn.args[0], ll_cdict_type.as_pointer())
+        cd = builder.load(cdp)
+        free_fnty = ir.FunctionType(ir.VoidType(), [ll_cdict_type])
+        free = cgutils.get_or_insert_function(builder.module, free_fnty,
+                                              'numba_concurrent_dict_free')
+        builder.call(free, [cd])
+        builder.ret_void()
+
+    return fn
+
+
+@intrinsic
+def _concurrent_dict_new(typingctx, keyty, valty, nshards, flags):
+    """Wrap numba_concurrent_dict_new.
+
+    Allocate a new concurrent dictionary of *nshards* shards, each a
+    dictionary of the minimum capacity with the DictFlags *flags*.
+    """
+    resty = types.voidptr
+    sig = resty(keyty, valty, types.intp, types.int32)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(
+            ll_status,
+            [ll_cdict_type.as_pointer(), ll_ssize_t, ll_ssize_t, ll_ssize_t,
+             ll_status],
+        )
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_concurrent_dict_new')
+        # Determine sizeof key and value types
+        ll_key = context.get_data_type(keyty.instance_type)
+        ll_val = context.get_data_type(valty.instance_type)
+        sz_key = context.get_abi_sizeof(ll_key)
+        sz_val = context.get_abi_sizeof(ll_val)
+        refcdp = cgutils.alloca_once(builder, ll_cdict_type, zfill=True)
+        status = builder.call(
+            fn,
+            [refcdp, args[2], ll_ssize_t(sz_key), ll_ssize_t(sz_val),
+             args[3]],
+        )
+        _raise_if_error(
+            context, builder, status,
+            msg="Failed to allocate concurrent dictionary",
+        )
+        return builder.load(refcdp)
+
+    return sig, codegen
+
+
+@intrinsic
+def _make_concurrent_dict(typingctx, keyty, valty, ptr):
+    """Make a concurrent dictionary struct with the given *ptr*
+    """
+    cdict_ty = ConcurrentDictType(keyty.instance_type, valty.instance_type)
+
+    def codegen(context, builder, signature, args):
+        [_, _, ptr] = args
+        ctor = cgutils.create_struct_proxy(cdict_ty)
+        cdstruct = ctor(context, builder)
+        cdstruct.data = ptr
+
+        alloc_size = context.get_abi_sizeof(
+            context.get_value_type(types.voidptr),
+        )
+        dtor = _imp_dtor(context, builder.module)
+        meminfo = context.nrt.meminfo_alloc_dtor(
+            builder,
+            context.get_constant(types.uintp, alloc_size),
+            dtor,
+        )
+
+        data_pointer = context.nrt.meminfo_data(builder, meminfo)
+        data_pointer = builder.bitcast(data_pointer,
+                                       ll_cdict_type.as_pointer())
+        builder.store(ptr, data_pointer)
+
+        cdstruct.meminfo = meminfo
+
+        return cdstruct._getvalue()
+
+    sig = cdict_ty(keyty, valty, ptr)
+    return sig, codegen
+
+
+@intrinsic
+def _cdict_nshards(typingctx, cd):
+    """Wrap numba_concurrent_dict_nshards
+    """
+    sig = types.intp(cd)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(ll_ssize_t, [ll_cdict_type])
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_concurrent_dict_nshards')
+        cdp = _container_get_data(context, builder, sig.args[0], args[0])
+        return builder.call(fn, [cdp])
+
+    return sig, codegen
+
+
+@intrinsic
+def _cdict_shard_at(typingctx, cd, index):
+    """Wrap numba_concurrent_dict_shard_at
+
+    Returns the shard of index *index*.
+    """
+    sig = types.voidptr(cd, types.intp)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(ll_shard_type, [ll_cdict_type, ll_ssize_t])
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_concurrent_dict_shard_at')
+        cdp = _container_get_data(context, builder, sig.args[0], args[0])
+        return builder.call(fn, [cdp, args[1]])
+
+    return sig, codegen
+
+
+@intrinsic
+def _cdict_shard(typingctx, cd, hashval):
+    """Wrap numba_concurrent_dict_shard
+
+    Returns the shard of the keys of hash *hashval*.
+    """
+    sig = types.voidptr(cd, types.intp)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(ll_shard_type, [ll_cdict_type, ll_hash])
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_concurrent_dict_shard')
+        cdp = _container_get_data(context, builder, sig.args[0], args[0])
+        return builder.call(fn, [cdp, args[1]])
+
+    return sig, codegen
+
+
+def _shard_lock_ptr(builder, shard):
+    shard = builder.bitcast(shard, ll_shard_struct.as_pointer())
+    return cgutils.gep_inbounds(builder, shard, 0, 0)
+
+
+def _shard_version_ptr(builder, shard):
+    shard = builder.bitcast(shard, ll_shard_struct.as_pointer())
+    return cgutils.gep_inbounds(builder, shard, 0, 1)
+
+
+def _cpu_relax(builder):
+    """Emit the hint of the CPU that the thread is spinning, if it has one.
+    """
+    machine = platform.machine().lower()
+    if machine in ('i386', 'i586', 'i686', 'x86_64', 'amd64'):
+        fnty = ir.FunctionType(ir.VoidType(), [])
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'llvm.x86.sse2.pause')
+        builder.call(fn, [])
+    elif machine in ('aarch64', 'arm64'):
+        builder.asm(ir.FunctionType(ir.VoidType(), []), 'yield', '', [],
+                    side_effect=True)
+
+
+@intrinsic
+def _shard_lock(typingctx, shard):
+    """Take the lock of *shard*, spinning until it is released.
+
+    A failed attempt waits on relaxed loads of the lock, which keep the cache
+    line of the lock shared, before trying to take it again.  Between two
+    loads it pauses the CPU for a number of times that doubles up to
+    _LOCK_MAX_BACKOFF, so that the waiting threads back off from a lock that
+    stays held.
+    """
+    sig = types.void(types.voidptr)
+
+    def codegen(context, builder, sig, args):
+        lock = _shard_lock_ptr(builder, args[0])
+        backoff = cgutils.alloca_once(builder, ll_lock, name='backoff')
+        builder.store(ll_lock(1), backoff)
+        bb_try = builder.append_basic_block('shard.lock.try')
+        bb_wait = builder.append_basic_block('shard.lock.wait')
+        bb_done = builder.append_basic_block('shard.lock.done')
+        builder.branch(bb_try)
+
+        builder.position_at_end(bb_try)
+        res = builder.cmpxchg(lock, ll_lock(0), ll_lock(1), 'acquire',
+                              'monotonic')
+        builder.cbranch(builder.extract_value(res, 1), bb_done, bb_wait)
+
+        builder.position_at_end(bb_wait)
+        count = builder.load(backoff)
+        with cgutils.for_range(builder, count):
+            _cpu_relax(builder)
+        more = builder.icmp_unsigned('<', count, ll_lock(_LOCK_MAX_BACKOFF))
+        builder.store(builder.select(more, builder.shl(count, ll_lock(1)),
+                                     count), backoff)
+        held = builder.load_atomic(lock, 'monotonic', 4)
+        is_free = builder.icmp_unsigned('==', held, ll_lock(0))
+        builder.cbranch(is_free, bb_try, bb_wait)
+
+        builder.position_at_end(bb_done)
+
+    return sig, codegen
+
+
+@intrinsic
+def _shard_unlock(typingctx, shard):
+    """Release the lock of *shard*.
+    """
+    sig = types.void(types.voidptr)
+
+    def codegen(context, builder, sig, args):
+        lock = _shard_lock_ptr(builder, args[0])
+        builder.store_atomic(ll_lock(0), lock, 'release', 4)
+
+    return sig, codegen
+
+
+@intrinsic
+def _shard_version(typingctx, shard):
+    """Returns the version of *shard*, which changes with every update of
+    its dictionary.  The lock of the shard must be held.
+    """
+    sig = types.uint32(types.voidptr)
+
+    def codegen(context, builder, sig, args):
+        return builder.load(_shard_version_ptr(builder, args[0]))
+
+    return sig, codegen
+
+
+@intrinsic
+def _shard_updated(typingctx, shard):
+    """Move the version of *shard* on after an update of its dictionary.
+    The lock of the shard must be held.
+    """
+    sig = types.void(types.voidptr)
+
+    def codegen(context, builder, sig, args):
+        version = _shard_version_ptr(builder, args[0])
+        builder.store(builder.add(builder.load(version), ll_version(1)),
+                      version)
+
+    return sig, codegen
+
+
+def _shard_load_dict(builder, shard):
+    shard = builder.bitcast(shard, ll_shard_struct.as_pointer())
+    return builder.load(cgutils.gep_inbounds(builder, shard, 0, 2))
+
+
+@intrinsic
+def _shard_dict_ptr(typingctx, shard):
+    """Returns the pointer to the C dict of *shard*.
+    """
+    sig = types.voidptr(types.voidptr)
+
+    def codegen(context, builder, sig, args):
+        return _shard_load_dict(builder, args[0])
+
+    return sig, codegen
+
+
+@intrinsic
+def _shard_dict(typingctx, shard, keyty, valty):
+    """Returns the dictionary of *shard*, as a DictType without a meminfo.
+
+    It is only valid while the lock of the shard is held.
+    """
+    dict_ty = types.DictType(keyty.instance_type, valty.instance_type)
+    sig = dict_ty(types.voidptr, keyty, valty)
+
+    def codegen(context, builder, sig, args):
+        ctor = cgutils.create_struct_proxy(dict_ty)
+        dstruct = ctor(context, builder)
+        # The NRT ignores the refcount operations on a NULL meminfo
+        dstruct.meminfo = cgutils.get_null_value(dstruct.meminfo.type)
+        dstruct.data = _shard_load_dict(builder, args[0])
+        return dstruct._getvalue()
+
+    return sig, codegen
+
+
+@overload(new_concurrent_dict)
+def impl_new_concurrent_dict(key, value, nshards=0, flags=0):
+    """Creates a new concurrent dictionary with *key* and *value* as the type
+    of the dictionary key and value, respectively, *nshards* shards and the
+    DictFlags *flags*.
+    """
+    if any([
+        not isinstance(key, Type),
+        not isinstance(value, Type),
+    ]):
+        raise TypeError("expecting *key* and *value* to be a numba Type")
+
+    keyty, valty = key, value
+    default = default_nshards()
+
+    def imp(key, value, nshards=0, flags=0):
+        if nshards <= 0:
+            nshards = default
+        flags = flags | dictobject._dict_key_flags(keyty)
+        cdp = _concurrent_dict_new(keyty, valty, nshards, flags)
+        cd = _make_concurrent_dict(keyty, valty, cdp)
+        for i in range(_cdict_nshards(cd)):
+            shard = _cdict_shard_at(cd, i)
+            dictobject._dict_set_method_table(_shard_dict_ptr(shard), keyty,
+                                              valty)
+        return cd
+
+    return imp
+
+
+def _raise_on_insert_error(status):
+    """Raise the error of the *status* of a dict insertion, if any.
+    """
+    pass
+
+
+@overload(_raise_on_insert_error)
+def impl_raise_on_insert_error(status):
+    def impl(status):
+        if status == Status.ERR_CMP_FAILED:
+            raise ValueError('key comparison failed')
+        elif status < Status.OK:
+            raise RuntimeError('ConcurrentDict insertion failed unexpectedly')
+
+    return impl
+
+
+@overload(len)
+def impl_len(cd):
+    """len(concurrent dict), which takes the locks of the shards one by one
+    """
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd):
+        n = 0
+        for i in range(_cdict_nshards(cd)):
+            shard = _cdict_shard_at(cd, i)
+            _shard_lock(shard)
+            n += dictobject._dict_length(_shard_dict(shard, keyty, valty))
+            _shard_unlock(shard)
+        return n
+
+    return impl
+
+
+@overload_method(ConcurrentDictType, '__setitem__')
+@overload(operator.setitem)
+def impl_setitem(cd, key, value):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd, key, value):
+        castedkey = _cast(key, keyty)
+        castedval = _cast(value, valty)
+        hashed = hash(castedkey)
+        shard = _cdict_shard(cd, hashed)
+        _shard_lock(shard)
+        d = _shard_dict(shard, keyty, valty)
+        status = dictobject._dict_insert(d, castedkey, hashed, castedval)
+        _shard_updated(shard)
+        _shard_unlock(shard)
+        _raise_on_insert_error(status)
+
+    return impl
+
+
+@overload_method(ConcurrentDictType, 'get')
+def impl_get(cd, key, default=None):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+    keyty, valty = cd.key_type, cd.value_type
+    _sentry_safe_cast_default(default, valty)
+
+    def impl(cd, key, default=None):
+        castedkey = _cast(key, keyty)
+        hashed = hash(castedkey)
+        shard = _cdict_shard(cd, hashed)
+        _shard_lock(shard)
+        d = _shard_dict(shard, keyty, valty)
+        ix, val = dictobject._dict_lookup(d, castedkey, hashed)
+        _shard_unlock(shard)
+        if ix > DKIX.EMPTY:
+            return val
+        return default
+
+    return impl
+
+
+@overload(operator.getitem)
+def impl_getitem(cd, key):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd, key):
+        castedkey = _cast(key, keyty)
+        hashed = hash(castedkey)
+        shard = _cdict_shard(cd, hashed)
+        _shard_lock(shard)
+        d = _shard_dict(shard, keyty, valty)
+        ix, val = dictobject._dict_lookup(d, castedkey, hashed)
+        _shard_unlock(shard)
+        if ix == DKIX.EMPTY:
+            raise KeyError()
+        elif ix < DKIX.EMPTY:
+            raise AssertionError("internal dict error during lookup")
+        else:
+            return _nonoptional(val)
+
+    return impl
+
+
+@overload(operator.contains)
+def impl_contains(cd, k):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd, k):
+        k = _cast(k, keyty)
+        hashed = hash(k)
+        shard = _cdict_shard(cd, hashed)
+        _shard_lock(shard)
+        d = _shard_dict(shard, keyty, valty)
+        ix, val = dictobject._dict_lookup(d, k, hashed)
+        _shard_unlock(shard)
+        return ix > DKIX.EMPTY
+
+    return impl
+
+
+@overload_method(ConcurrentDictType, 'pop')
+def impl_pop(cd, key, default=None):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+    should_raise = isinstance(default, types.Omitted)
+    _sentry_safe_cast_default(default, valty)
+
+    def impl(cd, key, default=None):
+        castedkey = _cast(key, keyty)
+        hashed = hash(castedkey)
+        shard = _cdict_shard(cd, hashed)
+        _shard_lock(shard)
+        d = _shard_dict(shard, keyty, valty)
+        ix, val = dictobject._dict_lookup(d, castedkey, hashed)
+        status = 0
+        if ix > DKIX.EMPTY:
+            status = dictobject._dict_delitem(d, hashed, ix)
+            _shard_updated(shard)
+        _shard_unlock(shard)
+        if ix == DKIX.EMPTY:
+            if should_raise:
+                raise KeyError()
+            else:
+                return default
+        elif ix < DKIX.EMPTY:
+            raise AssertionError("internal dict error during lookup")
+        elif status != Status.OK:
+            raise AssertionError("internal dict error during delitem")
+        return val
+
+    return impl
+
+
+@overload(operator.delitem)
+def impl_delitem(cd, k):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    def impl(cd, k):
+        cd.pop(k)
+    return impl
+
+
+@overload_method(ConcurrentDictType, 'merge')
+def impl_merge(cd, key, value, combine):
+    """cd.merge(key, value, combine)
+
+    Inserts *value* for *key* if it is missing, and otherwise replaces the
+    value *old* of *key* with ``combine(old, value)``, atomically.  Returns
+    the new value of *key*.
+
+    *combine* runs without the lock of the shard of *key*, the new value is
+    stored only if the shard was not updated meanwhile, otherwise *combine*
+    runs again on the latest value.  It may raise, and should have no side
+    effects.
+    """
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd, key, value, combine):
+        castedkey = _cast(key, keyty)
+        castedval = _cast(value, valty)
+        hashed = hash(castedkey)
+        shard = _cdict_shard(cd, hashed)
+        while True:
+            _shard_lock(shard)
+            d = _shard_dict(shard, keyty, valty)
+            ix, old = dictobject._dict_lookup(d, castedkey, hashed)
+            if ix <= DKIX.EMPTY:
+                status = dictobject._dict_insert(d, castedkey, hashed,
+                                                 castedval)
+                _shard_updated(shard)
+                _shard_unlock(shard)
+                _raise_on_insert_error(status)
+                return castedval
+            version = _shard_version(shard)
+            _shard_unlock(shard)
+
+            newval = _cast(combine(_nonoptional(old), castedval), valty)
+
+            _shard_lock(shard)
+            if _shard_version(shard) == version:
+                d = _shard_dict(shard, keyty, valty)
+                status = dictobject._dict_insert(d, castedkey, hashed,
+                                                 newval)
+                _shard_updated(shard)
+                _shard_unlock(shard)
+                _raise_on_insert_error(status)
+                return newval
+            _shard_unlock(shard)
+
+    return impl
+
+
+@overload_method(ConcurrentDictType, 'to_dict')
+def impl_to_dict(cd):
+    """cd.to_dict()
+
+    Returns a typed Dict of the items of *cd*.  The shards are copied one by
+    one under their lock, so the result is a consistent snapshot only if no
+    other thread updates *cd* meanwhile.
+    """
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd):
+        out = dictobject.new_dict(keyty, valty)
+        status = 0
+        for i in range(_cdict_nshards(cd)):
+            shard = _cdict_shard_at(cd, i)
+            _shard_lock(shard)
+            d = _shard_dict(shard, keyty, valty)
+            for k, v in d.items():
+                status = dictobject._dict_insert(out, k, hash(k), v)
+                if status < Status.OK:
+                    break
+            _shard_unlock(shard)
+            _raise_on_insert_error(status)
+        return out
+
+    return impl
+
+
+def _shard_keys(cd, index):
+    """Returns the list of the keys of the shard *index* of *cd*.
+    """
+    pass
+
+
+@overload(_shard_keys)
+def impl_shard_keys(cd, index):
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    keyty, valty = cd.key_type, cd.value_type
+
+    def impl(cd, index):
+        shard = _cdict_shard_at(cd, index)
+        _shard_lock(shard)
+        keys = list(_shard_dict(shard, keyty, valty).keys())
+        _shard_unlock(shard)
+        return keys
+
+    return impl
+
+
+@overload_method(ConcurrentDictType, 'nshards')
+def impl_nshards(cd):
+    """cd.nshards(), the number of shards of *cd*
+    """
+    if not isinstance(cd, ConcurrentDictType):
+        return
+
+    def impl(cd):
+        return _cdict_nshards(cd)
+
+    return impl
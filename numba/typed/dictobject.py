@@ -5,6 +5,7 @@ import ctypes
 import operator
 from enum import IntEnum
 
+import numpy as np
 from llvmlite import ir
 
 from numba import _helperlib
@@ -18,6 +19,7 @@ from numba.core.extending import (
     lower_builtin,
     lower_cast,
     make_attribute_wrapper,
+    register_jitable,
 )
 from numba.core.imputils import iternext_impl, impl_ret_untracked
 from numba.core import types, cgutils
@@ -32,7 +34,9 @@ from numba.core.types import (
 from numba.core.imputils import impl_ret_borrowed, RefType
 from numba.core.errors import TypingError, LoweringError
 from numba.core import typing
+from numba.np import numpy_support
 from numba.typed.typedobjectutils import (_as_bytes, _cast, _nonoptional,
+                                          _sentry_safe_cast,
                                           _sentry_safe_cast_default,
                                           _get_incref_decref,
                                           _get_equal, _container_get_data,)
@@ -57,6 +61,30 @@ class DKIX(IntEnum):
     EMPTY = -1
 
 
+class DictFlags(IntEnum):
+    """Flags of a new dict, see numba_dict_new_flags().
+    """
+    GROUPED = 0x1
+    POD_KEYS = 0x2
+
+
+# The layouts of the hashtable of a dict, and their flags
+_DICT_LAYOUTS = {
+    'compact': 0,
+    'grouped': DictFlags.GROUPED,
+}
+
+
+def _layout_flags(layout):
+    """Returns the dict flags of the hashtable *layout*, a key of
+    _DICT_LAYOUTS.
+    """
+    if layout not in _DICT_LAYOUTS:
+        raise ValueError("the dict layout must be one of %s, got %r"
+                         % (', '.join(map(repr, _DICT_LAYOUTS)), layout))
+    return int(_DICT_LAYOUTS[layout])
+
+
 class Status(IntEnum):
     """Status code for other dict operations.
     """
@@ -69,13 +97,15 @@ class Status(IntEnum):
     ERR_CMP_FAILED = -5
 
 
-def new_dict(key, value):
+def new_dict(key, value, flags=0):
     """Construct a new dict.
 
     Parameters
     ----------
     key, value : TypeRef
         Key type and value type of the new dict.
+    flags : int
+        DictFlags of the new dict.
     """
     # With JIT disabled, ignore all arguments and return a Python dict.
     return dict()
@@ -212,8 +242,8 @@ def _imp_dtor(context, module):
 
 
 @intrinsic
-def _dict_new_minsize(typingctx, keyty, valty):
-    """Wrap numba_dict_new_minsize.
+def _dict_new_minsize(typingctx, keyty, valty, flags):
+    """Wrap numba_dict_new_flags.
 
     Allocate a new dictionary object with the minimum capacity.
 
@@ -221,27 +251,32 @@ def _dict_new_minsize(typingctx, keyty, valty):
     ----------
     keyty, valty: Type
         Type of the key and value, respectively.
+    flags: int32
+        DictFlags of the dictionary.
 
     """
     resty = types.voidptr
-    sig = resty(keyty, valty)
+    sig = resty(keyty, valty, types.int32)
 
     def codegen(context, builder, sig, args):
         fnty = ir.FunctionType(
             ll_status,
-            [ll_dict_type.as_pointer(), ll_ssize_t, ll_ssize_t],
+            [ll_dict_type.as_pointer(), ll_ssize_t, ll_ssize_t, ll_ssize_t,
+             ll_status],
         )
         fn = cgutils.get_or_insert_function(builder.module, fnty,
-                                            'numba_dict_new_minsize')
+                                            'numba_dict_new_flags')
         # Determine sizeof key and value types
         ll_key = context.get_data_type(keyty.instance_type)
         ll_val = context.get_data_type(valty.instance_type)
         sz_key = context.get_abi_sizeof(ll_key)
         sz_val = context.get_abi_sizeof(ll_val)
         refdp = cgutils.alloca_once(builder, ll_dict_type, zfill=True)
+        # a size of 0 is rounded up to the minimum size
         status = builder.call(
             fn,
-            [refdp, ll_ssize_t(sz_key), ll_ssize_t(sz_val)],
+            [refdp, ll_ssize_t(0), ll_ssize_t(sz_key), ll_ssize_t(sz_val),
+             args[2]],
         )
         _raise_if_error(
             context, builder, status,
@@ -253,6 +288,26 @@ def _dict_new_minsize(typingctx, keyty, valty):
     return sig, codegen
 
 
+@intrinsic
+def _dict_key_flags(typingctx, keyty):
+    """Returns the DictFlags implied by the key type *keyty*: POD_KEYS if
+    its keys are plain data, which can be compared bytewise and need no
+    reference counting.
+    """
+    resty = types.int32
+    sig = resty(keyty)
+
+    def codegen(context, builder, sig, args):
+        dm_key = context.data_model_manager[keyty.instance_type]
+        if dm_key.contains_nrt_meminfo():
+            flags = 0
+        else:
+            flags = int(DictFlags.POD_KEYS)
+        return context.get_constant(types.int32, flags)
+
+    return sig, codegen
+
+
 @intrinsic
 def _dict_set_method_table(typingctx, dp, keyty, valty):
     """Wrap numba_dict_set_method_table
@@ -396,6 +451,30 @@ def _dict_length(typingctx, d):
     return sig, codegen
 
 
+@intrinsic
+def _dict_flags(typingctx, d):
+    """Wrap numba_dict_flags
+
+    Returns the DictFlags of the dictionary.
+    """
+    resty = types.int32
+    sig = resty(d)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(
+            ll_status,
+            [ll_dict_type],
+        )
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_dict_flags')
+        [d] = args
+        [td] = sig.args
+        dp = _container_get_data(context, builder, td, d)
+        return builder.call(fn, [dp])
+
+    return sig, codegen
+
+
 @intrinsic
 def _dict_dump(typingctx, d):
     """Dump the dictionary keys and values.
@@ -477,6 +556,91 @@ def _dict_lookup(typingctx, d, key, hashval):
     return sig, codegen
 
 
+@intrinsic
+def _dict_insert_many(typingctx, d, keys, hashes, vals):
+    """Wrap numba_dict_insert_many
+
+    *keys*, *hashes* and *vals* are C-contiguous arrays of the key type,
+    intp and the value type, of the length of *keys*.
+    """
+    resty = types.int32
+    sig = resty(d, keys, hashes, vals)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(
+            ll_status,
+            [ll_dict_type, ll_bytes, ll_bytes, ll_bytes, ll_ssize_t],
+        )
+        [d, keys, hashes, vals] = args
+        [td, tkeys, thashes, tvals] = sig.args
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_dict_insert_many')
+        keys = context.make_array(tkeys)(context, builder, keys)
+        hashes = context.make_array(thashes)(context, builder, hashes)
+        vals = context.make_array(tvals)(context, builder, vals)
+
+        dp = _container_get_data(context, builder, td, d)
+        status = builder.call(
+            fn,
+            [
+                dp,
+                _as_bytes(builder, keys.data),
+                _as_bytes(builder, hashes.data),
+                _as_bytes(builder, vals.data),
+                keys.nitems,
+            ],
+        )
+        return status
+
+    return sig, codegen
+
+
+@intrinsic
+def _dict_lookup_many(typingctx, d, keys, hashes, out_vals, out_found):
+    """Wrap numba_dict_lookup_many
+
+    *keys*, *hashes*, *out_vals* and *out_found* are C-contiguous arrays of
+    the key type, intp, the value type and bool, of the length of *keys*.
+    The values are copied without incref, so the value type must not be
+    reference counted.
+
+    Returns the number of keys found, or a negative Status.
+    """
+    resty = types.intp
+    sig = resty(d, keys, hashes, out_vals, out_found)
+
+    def codegen(context, builder, sig, args):
+        fnty = ir.FunctionType(
+            ll_ssize_t,
+            [ll_dict_type, ll_bytes, ll_bytes, ll_bytes, ll_bytes,
+             ll_ssize_t],
+        )
+        [d, keys, hashes, out_vals, out_found] = args
+        [td, tkeys, thashes, tout_vals, tout_found] = sig.args
+        fn = cgutils.get_or_insert_function(builder.module, fnty,
+                                            'numba_dict_lookup_many')
+        keys = context.make_array(tkeys)(context, builder, keys)
+        hashes = context.make_array(thashes)(context, builder, hashes)
+        out_vals = context.make_array(tout_vals)(context, builder, out_vals)
+        out_found = context.make_array(tout_found)(context, builder,
+                                                   out_found)
+
+        dp = _container_get_data(context, builder, td, d)
+        return builder.call(
+            fn,
+            [
+                dp,
+                _as_bytes(builder, keys.data),
+                _as_bytes(builder, hashes.data),
+                _as_bytes(builder, out_vals.data),
+                _as_bytes(builder, out_found.data),
+                keys.nitems,
+            ],
+        )
+
+    return sig, codegen
+
+
 @intrinsic
 def _dict_popitem(typingctx, d):
     """Wrap numba_dict_popitem
@@ -644,9 +808,10 @@ def _make_dict(typingctx, keyty, valty, ptr):
 
 
 @overload(new_dict)
-def impl_new_dict(key, value):
+def impl_new_dict(key, value, flags=0):
     """Creates a new dictionary with *key* and *value* as the type
-    of the dictionary key and value, respectively.
+    of the dictionary key and value, respectively, and the DictFlags
+    *flags*.
     """
     if any([
         not isinstance(key, Type),
@@ -656,8 +821,8 @@ def impl_new_dict(key, value):
 
     keyty, valty = key, value
 
-    def imp(key, value):
-        dp = _dict_new_minsize(keyty, valty)
+    def imp(key, value, flags=0):
+        dp = _dict_new_minsize(keyty, valty, flags | _dict_key_flags(keyty))
         _dict_set_method_table(dp, keyty, valty)
         d = _make_dict(keyty, valty, dp)
         return d
@@ -857,7 +1022,7 @@ def impl_copy(d):
     key_type, val_type = d.key_type, d.value_type
 
     def impl(d):
-        newd = new_dict(key_type, val_type)
+        newd = new_dict(key_type, val_type, _dict_flags(d))
         for k, v in d.items():
             newd[k] = v
         return newd
@@ -925,6 +1090,133 @@ def ol_dict_update(d, other):
     return impl
 
 
+# The key and value types that the batch operations pass to the C dict as
+# arrays
+_BATCH_TYPES = (types.Number, types.Boolean)
+
+
+def _sentry_batch_array(name, arr):
+    if not (isinstance(arr, types.Array) and arr.ndim == 1):
+        raise TypingError("{} must be a 1d array, got {}".format(name, arr))
+
+
+def _as_batch_array(arr, ty):
+    """Returns the 1d array *arr* as a C-contiguous array of the type *ty*,
+    copying it only if needed.
+    """
+    return np.ascontiguousarray(arr)
+
+
+@overload(_as_batch_array)
+def impl_as_batch_array(arr, ty):
+    ty = ty.instance_type
+    # Same rules as the casts of the keys and values of d[k] = v
+    _sentry_safe_cast(arr.dtype, ty)
+    if arr.dtype == ty and arr.layout == 'C':
+        return lambda arr, ty: arr
+    dtype = numpy_support.as_dtype(ty)
+
+    def impl(arr, ty):
+        out = np.empty(len(arr), dtype)
+        for i in range(len(arr)):
+            out[i] = arr[i]
+        return out
+
+    return impl
+
+
+@register_jitable
+def _batch_hashes(keys):
+    hashes = np.empty(len(keys), np.intp)
+    for i in range(len(keys)):
+        hashes[i] = hash(keys[i])
+    return hashes
+
+
+@overload_method(types.DictType, 'insert_many')
+def impl_insert_many(d, keys, values):
+    """d.insert_many(keys, values)
+
+    Inserts the items of the 1d arrays *keys* and *values*, as
+    ``for k, v in zip(keys, values): d[k] = v`` does.  Dicts of numeric or
+    boolean keys and values insert them in a single call to the C dict.
+    """
+    if not isinstance(d, types.DictType):
+        return
+    _sentry_batch_array('keys', keys)
+    _sentry_batch_array('values', values)
+
+    keyty, valty = d.key_type, d.value_type
+
+    if isinstance(keyty, _BATCH_TYPES) and isinstance(valty, _BATCH_TYPES):
+        def impl(d, keys, values):
+            if len(keys) != len(values):
+                raise ValueError("keys and values must have the same length")
+            ckeys = _as_batch_array(keys, keyty)
+            cvals = _as_batch_array(values, valty)
+            status = _dict_insert_many(d, ckeys, _batch_hashes(ckeys), cvals)
+            if status == Status.OK:
+                return
+            elif status == Status.ERR_NO_MEMORY:
+                raise MemoryError('dict.insert_many failed to grow the dict')
+            elif status == Status.ERR_CMP_FAILED:
+                raise ValueError('key comparison failed')
+            else:
+                raise RuntimeError('dict.insert_many failed unexpectedly')
+    else:
+        def impl(d, keys, values):
+            if len(keys) != len(values):
+                raise ValueError("keys and values must have the same length")
+            for i in range(len(keys)):
+                d[keys[i]] = values[i]
+
+    return impl
+
+
+@overload_method(types.DictType, 'lookup_many')
+def impl_lookup_many(d, keys):
+    """d.lookup_many(keys) -> (values, found)
+
+    Looks up the keys of the 1d array *keys* in a dict of numeric or boolean
+    values.  Returns the array of their values, zero for missing keys, and
+    the boolean array of the keys found.  Dicts of numeric or boolean keys
+    look them up in a single call to the C dict.
+    """
+    if not isinstance(d, types.DictType):
+        return
+    _sentry_batch_array('keys', keys)
+
+    keyty, valty = d.key_type, d.value_type
+    if not isinstance(valty, _BATCH_TYPES):
+        raise TypingError("lookup_many() needs numeric or boolean values, "
+                          "got {}".format(valty))
+    val_dtype = numpy_support.as_dtype(valty)
+
+    if isinstance(keyty, _BATCH_TYPES):
+        def impl(d, keys):
+            ckeys = _as_batch_array(keys, keyty)
+            values = np.empty(len(ckeys), val_dtype)
+            found = np.empty(len(ckeys), np.bool_)
+            status = _dict_lookup_many(d, ckeys, _batch_hashes(ckeys),
+                                       values, found)
+            if status < 0:
+                raise ValueError('key comparison failed')
+            return values, found
+    else:
+        def impl(d, keys):
+            values = np.zeros(len(keys), val_dtype)
+            found = np.zeros(len(keys), np.bool_)
+            for i in range(len(keys)):
+                k = _cast(keys[i], keyty)
+                ix, val = _dict_lookup(d, k, hash(k))
+                if ix > DKIX.EMPTY:
+                    values[i] = _nonoptional(val)
+                    found[i] = True
+            return values, found
+
+    return impl
+
+
 @overload(operator.eq)
 def impl_equal(da, db):
     if not isinstance(da, types.DictType):
@@ -0,0 +1,321 @@
+"""
+Python wrapper that connects CPython interpreter to the numba
+concurrentdictobject.
+"""
+from collections.abc import MutableMapping
+
+from numba.core.types import ConcurrentDictType
+from numba import njit, typeof
+from numba.core import types, config, cgutils
+from numba.core.extending import (
+    box,
+    unbox,
+    NativeValue,
+    overload_classmethod,
+)
+from numba.typed import concurrentdictobject, dictobject
+from numba.typed.typeddict import _typed_layout_flags
+from numba.core.typing import signature
+
+
+@njit
+def _make_concurrent_dict(keyty, valty, nshards, flags):
+    cd = concurrentdictobject.new_concurrent_dict(keyty, valty, nshards, flags)
+    return concurrentdictobject._as_meminfo(cd)
+
+
+@njit
+def _length(cd):
+    return len(cd)
+
+
+@njit
+def _nshards(cd):
+    return cd.nshards()
+
+
+@njit
+def _setitem(cd, key, value):
+    cd[key] = value
+
+
+@njit
+def _getitem(cd, key):
+    return cd[key]
+
+
+@njit
+def _delitem(cd, key):
+    del cd[key]
+
+
+@njit
+def _contains(cd, key):
+    return key in cd
+
+
+@njit
+def _get(cd, key, default):
+    return cd.get(key, default)
+
+
+@njit
+def _merge(cd, key, value, combine):
+    return cd.merge(key, value, combine)
+
+
+@njit
+def _to_dict(cd):
+    return cd.to_dict()
+
+
+@njit
+def _shard_keys(cd, index):
+    return concurrentdictobject._shard_keys(cd, index)
+
+
+def _from_meminfo_ptr(ptr, cdicttype):
+    return ConcurrentDict(meminfo=ptr, cdcttype=cdicttype)
+
+
+class _PyConcurrentDict(dict):
+    """The concurrent dictionary with JIT disabled, a Python dict with the
+    extra methods of ConcurrentDict.
+    """
+
+    def merge(self, key, value, combine):
+        if key in self:
+            value = combine(self[key], value)
+        self[key] = value
+        return value
+
+    def to_dict(self):
+        return dict(self)
+
+    def nshards(self):
+        return 1
+
+
+class ConcurrentDict(MutableMapping):
+    """A typed dictionary usable in Numba compiled functions, whose
+    operations can run concurrently from several threads, e.g. from the
+    iterations of a ``prange`` loop.
+
+    The dictionary is split into shards by the hash of the keys, each a
+    typed dictionary with its own lock, which every operation holds only
+    for the duration of its lookup or insertion.
+
+    Implements the MutableMapping interface.
+    """
+
+    def __new__(cls, cdcttype=None, meminfo=None, nshards=0, flags=0):
+        if config.DISABLE_JIT:
+            return _PyConcurrentDict()
+        else:
+            return object.__new__(cls)
+
+    @classmethod
+    def empty(cls, key_type, value_type, nshards=0, layout='compact'):
+        """Create a new empty ConcurrentDict with *key_type* and
+        *value_type* as the types for the keys and values of the dictionary
+        respectively.
+
+        *nshards* is the number of shards, rounded up to a power of two.
+        The default is four times the number of threads, so that two
+        threads rarely wait on the same shard.  *layout* selects the
+        hashtable of the shards, see ``Dict.empty()``.
+        """
+        if config.DISABLE_JIT:
+            return _PyConcurrentDict()
+        else:
+            flags = dictobject._layout_flags(layout)
+            return cls(cdcttype=ConcurrentDictType(key_type, value_type),
+                       nshards=nshards, flags=flags)
+
+    def __init__(self, cdcttype, meminfo=None, nshards=0, flags=0):
+        """
+        For users, use ``ConcurrentDict.empty()`` to create a dictionary.
+        The arguments are for internal use only.
+
+        Parameters
+        ----------
+        cdcttype : numba.core.types.ConcurrentDictType
+            Used internally for the dictionary type.
+        meminfo : MemInfo
+            Used internally to pass the MemInfo object when boxing.
+        nshards, flags : int
+            Used internally for the shards and flags of a new dictionary.
+        """
+        if not isinstance(cdcttype, ConcurrentDictType):
+            raise TypeError('*cdcttype* must be a ConcurrentDictType')
+        self._dict_type = cdcttype
+        if meminfo is not None:
+            self._opaque = meminfo
+        else:
+            self._opaque = _make_concurrent_dict(cdcttype.key_type,
+                                                 cdcttype.value_type,
+                                                 nshards, flags)
+
+    @property
+    def _numba_type_(self):
+        return self._dict_type
+
+    def __getitem__(self, key):
+        return _getitem(self, key)
+
+    def __setitem__(self, key, value):
+        _setitem(self, key, value)
+
+    def __delitem__(self, key):
+        _delitem(self, key)
+
+    def __iter__(self):
+        # One shard at a time, under its lock
+        for i in range(self.nshards()):
+            yield from _shard_keys(self, i)
+
+    def __len__(self):
+        return _length(self)
+
+    def __contains__(self, key):
+        return _contains(self, key)
+
+    def __str__(self):
+        return str(self.to_dict())
+
+    def __repr__(self):
+        return "{prefix}({body})".format(prefix=str(self._dict_type),
+                                         body=str(self))
+
+    def get(self, key, default=None):
+        return _get(self, key, default)
+
+    def merge(self, key, value, combine):
+        """Set *value* for *key* if it is missing, and otherwise replace the
+        value *old* of *key* with ``combine(old, value)``, atomically.
+        Returns the new value of *key*.
+
+        *combine* must be a jitted function.  It runs without any lock
+        held, possibly more than once if other threads update the shard of
+        *key* meanwhile, so it should have no side effects.
+        """
+        return _merge(self, key, value, combine)
+
+    def to_dict(self):
+        """Returns a typed Dict of the items of the dictionary.
+        """
+        return _to_dict(self)
+
+    def nshards(self):
+        """Returns the number of shards of the dictionary.
+        """
+        return _nshards(self)
+
+
+@overload_classmethod(types.ConcurrentDictType, 'empty')
+def typedconcurrentdict_empty(cls, key_type, value_type, nshards=0,
+                              layout='compact'):
+    if cls.instance_type is not ConcurrentDictType:
+        return
+
+    flags = _typed_layout_flags(layout)
+
+    def impl(cls, key_type, value_type, nshards=0, layout='compact'):
+        return concurrentdictobject.new_concurrent_dict(key_type, value_type,
+                                                        nshards, flags)
+
+    return impl
+
+
+@box(types.ConcurrentDictType)
+def box_concurrentdicttype(typ, val, c):
+    context = c.context
+    builder = c.builder
+
+    ctor = cgutils.create_struct_proxy(typ)
+    cdstruct = ctor(context, builder, value=val)
+    # Returns the plain MemInfo
+    boxed_meminfo = c.box(
+        types.MemInfoPointer(types.voidptr),
+        cdstruct.meminfo,
+    )
+
+    modname = c.context.insert_const_string(
+        c.builder.module, 'numba.typed.typedconcurrentdict',
+    )
+    typedcdict_mod = c.pyapi.import_module_noblock(modname)
+    fmp_fn = c.pyapi.object_getattr_string(typedcdict_mod,
+                                           '_from_meminfo_ptr')
+
+    cdicttype_obj = c.pyapi.unserialize(c.pyapi.serialize_object(typ))
+
+    result_var = builder.alloca(c.pyapi.pyobj)
+    builder.store(cgutils.get_null_value(c.pyapi.pyobj), result_var)
+    with builder.if_then(cgutils.is_not_null(builder, cdicttype_obj)):
+        res = c.pyapi.call_function_objargs(
+            fmp_fn, (boxed_meminfo, cdicttype_obj),
+        )
+        c.pyapi.decref(fmp_fn)
+        c.pyapi.decref(typedcdict_mod)
+        c.pyapi.decref(boxed_meminfo)
+        builder.store(res, result_var)
+    return builder.load(result_var)
+
+
+@unbox(types.ConcurrentDictType)
+def unbox_concurrentdicttype(typ, val, c):
+    context = c.context
+
+    # Check that `type(val) is ConcurrentDict`
+    cdict_type = c.pyapi.unserialize(c.pyapi.serialize_object(ConcurrentDict))
+    valtype = c.pyapi.object_type(val)
+    same_type = c.builder.icmp_unsigned("==", valtype, cdict_type)
+
+    with c.builder.if_else(same_type) as (then, orelse):
+        with then:
+            miptr = c.pyapi.object_getattr_string(val, '_opaque')
+
+            mip_type = types.MemInfoPointer(types.voidptr)
+            native = c.unbox(mip_type, miptr)
+
+            mi = native.value
+
+            argtypes = mip_type, typeof(typ)
+
+            def convert(mi, typ):
+                return concurrentdictobject._from_meminfo(mi, typ)
+
+            sig = signature(typ, *argtypes)
+            nil_typeref = context.get_constant_null(argtypes[1])
+            args = (mi, nil_typeref)
+            is_error, cdobj = c.pyapi.call_jit_code(convert, sig, args)
+            # decref here because we are stealing a reference.
+            c.context.nrt.decref(c.builder, typ, cdobj)
+
+            c.pyapi.decref(miptr)
+            bb_unboxed = c.builder.basic_block
+
+        with orelse:
+            # Raise error on incorrect type
+            c.pyapi.err_format(
+                "PyExc_TypeError",
+                "can't unbox a %S as a %S",
+                valtype, cdict_type,
+            )
+            bb_else = c.builder.basic_block
+
+    # Phi nodes to gather the output
+    cdobj_res = c.builder.phi(cdobj.type)
+    is_error_res = c.builder.phi(is_error.type)
+
+    cdobj_res.add_incoming(cdobj, bb_unboxed)
+    cdobj_res.add_incoming(cdobj.type(None), bb_else)
+
+    is_error_res.add_incoming(is_error, bb_unboxed)
+    is_error_res.add_incoming(cgutils.true_bit, bb_else)
+
+    # cleanup
+    c.pyapi.decref(cdict_type)
+    c.pyapi.decref(valtype)
+
+    return NativeValue(cdobj_res, is_error=is_error_res)
@@ -2,6 +2,9 @@
 Python wrapper that connects CPython interpreter to the numba dictobject.
 """
 from collections.abc import MutableMapping
+
+import numpy as np
+
 from numba.core.types import DictType
 from numba.core.imputils import numba_typeref_ctor
 from numba import njit, typeof
@@ -19,8 +22,8 @@ from numba.core.typing import signature
 
 
 @njit
-def _make_dict(keyty, valty):
-    return dictobject._as_meminfo(dictobject.new_dict(keyty, valty))
+def _make_dict(keyty, valty, flags):
+    return dictobject._as_meminfo(dictobject.new_dict(keyty, valty, flags))
 
 
 @njit
@@ -73,6 +76,16 @@ def _copy(d):
     return d.copy()
 
 
+@njit
+def _insert_many(d, keys, values):
+    d.insert_many(keys, values)
+
+
+@njit
+def _lookup_many(d, keys):
+    return d.lookup_many(keys)
+
+
 def _from_meminfo_ptr(ptr, dicttype):
     d = Dict(meminfo=ptr, dcttype=dicttype)
     return d
@@ -91,14 +104,35 @@ class Dict(MutableMapping):
             return object.__new__(cls)
 
     @classmethod
-    def empty(cls, key_type, value_type):
+    def empty(cls, key_type, value_type, layout='compact'):
         """Create a new empty Dict with *key_type* and *value_type*
         as the types for the keys and values of the dictionary respectively.
+
+        *layout* selects the hashtable of the dictionary: ``'compact'`` (the
+        default) probes it slot by slot as CPython does, ``'grouped'``
+        probes it 16 slots at a time through a byte of hash bits per slot,
+        which makes lookups in large dictionaries touch less memory.
         """
         if config.DISABLE_JIT:
             return dict()
         else:
-            return cls(dcttype=DictType(key_type, value_type))
+            flags = dictobject._layout_flags(layout)
+            return cls(dcttype=DictType(key_type, value_type), flags=flags)
+
+    @classmethod
+    def from_arrays(cls, keys, values, layout='compact'):
+        """Create a new Dict of the items of the 1d arrays *keys* and
+        *values*, as ``dict(zip(keys, values))`` does.  The key and value
+        types are the dtypes of the arrays.  See ``empty()`` for *layout*.
+        """
+        if config.DISABLE_JIT:
+            return dict(zip(keys, values))
+        else:
+            keys = np.asarray(keys)
+            values = np.asarray(values)
+            d = cls.empty(typeof(keys).dtype, typeof(values).dtype, layout)
+            d.insert_many(keys, values)
+            return d
 
     def __init__(self, **kwargs):
         """
@@ -111,20 +145,22 @@ class Dict(MutableMapping):
             Used internally for the dictionary type.
         meminfo : MemInfo; keyword-only
             Used internally to pass the MemInfo object when boxing.
+        flags : int; keyword-only
+            Used internally for the flags of a new dictionary.
         """
         if kwargs:
             self._dict_type, self._opaque = self._parse_arg(**kwargs)
         else:
             self._dict_type = None
 
-    def _parse_arg(self, dcttype, meminfo=None):
+    def _parse_arg(self, dcttype, meminfo=None, flags=0):
         if not isinstance(dcttype, DictType):
             raise TypeError('*dcttype* must be a DictType')
 
         if meminfo is not None:
             opaque = meminfo
         else:
-            opaque = _make_dict(dcttype.key_type, dcttype.value_type)
+            opaque = _make_dict(dcttype.key_type, dcttype.value_type, flags)
         return dcttype, opaque
 
     @property
@@ -207,18 +243,76 @@ class Dict(MutableMapping):
     def copy(self):
         return _copy(self)
 
+    def insert_many(self, keys, values):
+        """Insert the items of the 1d arrays *keys* and *values*, as
+        ``for k, v in zip(keys, values): d[k] = v`` does.
+        """
+        keys = np.asarray(keys)
+        values = np.asarray(values)
+        if not self._typed:
+            self._dict_type, self._opaque = self._parse_arg(DictType(
+                typeof(keys).dtype, typeof(values).dtype))
+        _insert_many(self, keys, values)
+
+    def lookup_many(self, keys):
+        """Look up the keys of the 1d array *keys*.  Returns the array of
+        their values, zero for missing keys, and the boolean array of the
+        keys found.
+        """
+        if not self._typed:
+            raise TypeError("lookup_many() needs the value type of the Dict, "
+                            "insert an item first or create it with "
+                            "Dict.empty()")
+        return _lookup_many(self, keys)
+
 
 @overload_classmethod(types.DictType, 'empty')
-def typeddict_empty(cls, key_type, value_type):
+def typeddict_empty(cls, key_type, value_type, layout='compact'):
     if cls.instance_type is not DictType:
         return
 
-    def impl(cls, key_type, value_type):
-        return dictobject.new_dict(key_type, value_type)
+    flags = _typed_layout_flags(layout)
+
+    def impl(cls, key_type, value_type, layout='compact'):
+        return dictobject.new_dict(key_type, value_type, flags)
 
     return impl
 
 
+@overload_classmethod(types.DictType, 'from_arrays')
+def typeddict_from_arrays(cls, keys, values, layout='compact'):
+    if cls.instance_type is not DictType:
+        return
+
+    dictobject._sentry_batch_array('keys', keys)
+    dictobject._sentry_batch_array('values', values)
+    flags = _typed_layout_flags(layout)
+    key_type, value_type = keys.dtype, values.dtype
+
+    def impl(cls, keys, values, layout='compact'):
+        d = dictobject.new_dict(key_type, value_type, flags)
+        d.insert_many(keys, values)
+        return d
+
+    return impl
+
+
+def _typed_layout_flags(layout):
+    """Returns the dict flags of the type of a *layout* argument, which must
+    be a constant string.
+    """
+    if isinstance(layout, types.Omitted):
+        layout = layout.value
+    elif isinstance(layout, types.StringLiteral):
+        layout = layout.literal_value
+    else:
+        raise errors.TypingError("the dict layout must be a constant string")
+    try:
+        return dictobject._layout_flags(layout)
+    except ValueError as e:
+        raise errors.TypingError(str(e))
+
+
 @box(types.DictType)
 def box_dicttype(typ, val, c):
     context = c.context
@@ -274,8 +274,14 @@ def get_ext_modules():
                 sources=[
                     'numba/np/ufunc/tbbpool.cpp',
                     'numba/np/ufunc/gufunc_scheduler.cpp',
+                    'numba/np/ufunc/thread_affinity.cpp',
+                    'numba/np/ufunc/parallel_async.cpp',
+                    'numba/np/ufunc/parallel_profile.cpp',
                 ],
-                depends=['numba/np/ufunc/workqueue.h'],
+                depends=['numba/np/ufunc/workqueue.h',
+                         'numba/np/ufunc/thread_affinity.h',
+                         'numba/np/ufunc/parallel_async.h',
+                         'numba/np/ufunc/parallel_profile.h'],
                 include_dirs=[os.path.join(tbb_root, 'include')],
                 extra_compile_args=cpp11flags,
                 libraries=['tbb'],  # TODO: if --debug or -g, use 'tbb_debug'
@@ -303,8 +309,14 @@ def get_ext_modules():
             sources=[
                 'numba/np/ufunc/omppool.cpp',
                 'numba/np/ufunc/gufunc_scheduler.cpp',
+                'numba/np/ufunc/thread_affinity.cpp',
+                'numba/np/ufunc/parallel_async.cpp',
+                'numba/np/ufunc/parallel_profile.cpp',
             ],
-            depends=['numba/np/ufunc/workqueue.h'],
+            depends=['numba/np/ufunc/workqueue.h',
+                     'numba/np/ufunc/thread_affinity.h',
+                     'numba/np/ufunc/parallel_async.h',
+                     'numba/np/ufunc/parallel_profile.h'],
             extra_compile_args=ompcompileflags + cpp11flags,
             extra_link_args=omplinkflags,
         )
@@ -318,8 +330,14 @@ def get_ext_modules():
     ext_np_ufunc_workqueue_backend = Extension(
         name='numba.np.ufunc.workqueue',
         sources=['numba/np/ufunc/workqueue.c',
-                 'numba/np/ufunc/gufunc_scheduler.cpp'],
-        depends=['numba/np/ufunc/workqueue.h'])
+                 'numba/np/ufunc/gufunc_scheduler.cpp',
+                 'numba/np/ufunc/thread_affinity.cpp',
+                 'numba/np/ufunc/parallel_async.cpp',
+                 'numba/np/ufunc/parallel_profile.cpp'],
+        depends=['numba/np/ufunc/workqueue.h',
+                 'numba/np/ufunc/thread_affinity.h',
+                 'numba/np/ufunc/parallel_async.h',
+                 'numba/np/ufunc/parallel_profile.h'])
     ext_np_ufunc_backends.append(ext_np_ufunc_workqueue_backend)
 
     ext_mviewbuf = Extension(name='numba.mviewbuf',